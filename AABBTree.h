@@ -0,0 +1,203 @@
+#ifndef _MESHLIB_AABB_TREE_H_
+#define _MESHLIB_AABB_TREE_H_
+
+#include <vector>
+#include <algorithm>
+
+#include "..\MeshLib\core\Geometry\Point.h"
+
+#include "MeshArrays.h"
+#include "ImplicitSurface.h"
+
+namespace MeshLib
+{
+	/*!
+	* \brief CAABBTree, bounding volume hierarchy of axis aligned boxes over the elements of a mesh
+	* \details The elements are reordered so that every node covers the contiguous range
+	* \details m_order[first] ... m_order[first + count - 1] of element indices.
+	*/
+	class CAABBTree
+	{
+	public:
+		struct CNode
+		{
+			CPoint m_min;
+			CPoint m_max;
+			int m_left;		//!< child nodes, -1 for a leaf
+			int m_right;
+			int m_first;	//!< range of m_order covered by the node
+			int m_count;
+		};
+
+		// a range of m_order, all of its elements are on the same side unless the range is uncertain
+		typedef std::pair<int, int> CRange;
+
+		CAABBTree() { m_leafSize = 8; };
+		~CAABBTree() {};
+
+		void clear() { m_nodes.clear(); m_order.clear(); };
+
+		// build the tree over the elements of the arrays
+		void build(const CMeshArrays & arrays);
+
+		/*!
+		* Split the elements by the side of the surface they are on.
+		* \param outside ranges whose elements are entirely cut away
+		* \param inside ranges whose elements are entirely kept
+		* \param uncertain ranges of leaves close to the surface, their vertices need to be evaluated
+		*/
+		void classify(const CImplicitSurface & surface, std::vector<CRange> & outside, std::vector<CRange> & inside, std::vector<CRange> & uncertain) const;
+
+		// element indices in tree order
+		std::vector<int> m_order;
+		std::vector<CNode> m_nodes;
+
+	protected:
+		int _build(int first, int count);
+
+		std::vector<CPoint> m_boxMin;
+		std::vector<CPoint> m_boxMax;
+		std::vector<CPoint> m_centers;
+
+		int m_leafSize;
+	};
+
+	inline void CAABBTree::build(const CMeshArrays & arrays)
+	{
+		clear();
+
+		int nElements = (int)arrays.numElements();
+		if (nElements == 0)
+		{
+			return;
+		}
+
+		m_boxMin.resize(nElements);
+		m_boxMax.resize(nElements);
+		m_centers.resize(nElements);
+		m_order.resize(nElements);
+
+		int nv = arrays.m_verticesPerElement;
+		for (int e = 0; e < nElements; e++)
+		{
+			CPoint vmin(1e+10, 1e+10, 1e+10);
+			CPoint vmax(-1e+10, -1e+10, -1e+10);
+			for (int k = 0; k < nv; k++)
+			{
+				int v = arrays.m_elements[e * nv + k];
+				CPoint p(arrays.m_x[v], arrays.m_y[v], arrays.m_z[v]);
+				for (int j = 0; j < 3; j++)
+				{
+					vmin[j] = std::min(vmin[j], p[j]);
+					vmax[j] = std::max(vmax[j], p[j]);
+				}
+			}
+			m_boxMin[e] = vmin;
+			m_boxMax[e] = vmax;
+			m_centers[e] = (vmin + vmax) / 2.0;
+			m_order[e] = e;
+		}
+
+		m_nodes.reserve(2 * nElements / m_leafSize + 1);
+		_build(0, nElements);
+
+		// the boxes are only needed while building
+		std::vector<CPoint>().swap(m_boxMin);
+		std::vector<CPoint>().swap(m_boxMax);
+		std::vector<CPoint>().swap(m_centers);
+	};
+
+	inline int CAABBTree::_build(int first, int count)
+	{
+		int index = (int)m_nodes.size();
+		m_nodes.push_back(CNode());
+
+		CPoint vmin(1e+10, 1e+10, 1e+10);
+		CPoint vmax(-1e+10, -1e+10, -1e+10);
+		CPoint cmin(1e+10, 1e+10, 1e+10);
+		CPoint cmax(-1e+10, -1e+10, -1e+10);
+		for (int i = first; i < first + count; i++)
+		{
+			int e = m_order[i];
+			for (int j = 0; j < 3; j++)
+			{
+				vmin[j] = std::min(vmin[j], m_boxMin[e][j]);
+				vmax[j] = std::max(vmax[j], m_boxMax[e][j]);
+				cmin[j] = std::min(cmin[j], m_centers[e][j]);
+				cmax[j] = std::max(cmax[j], m_centers[e][j]);
+			}
+		}
+
+		CNode node;
+		node.m_min = vmin;
+		node.m_max = vmax;
+		node.m_first = first;
+		node.m_count = count;
+		node.m_left = -1;
+		node.m_right = -1;
+
+		if (count > m_leafSize)
+		{
+			// median split along the longest extent of the element centers
+			int axis = 0;
+			CPoint extent = cmax - cmin;
+			if (extent[1] > extent[axis]) axis = 1;
+			if (extent[2] > extent[axis]) axis = 2;
+
+			int half = count / 2;
+			std::vector<CPoint> & centers = m_centers;
+			std::nth_element(m_order.begin() + first, m_order.begin() + first + half, m_order.begin() + first + count,
+				[&centers, axis](int a, int b) { return centers[a][axis] < centers[b][axis]; });
+
+			node.m_left = _build(first, half);
+			node.m_right = _build(first + half, count - half);
+		}
+
+		m_nodes[index] = node;
+		return index;
+	};
+
+	inline void CAABBTree::classify(const CImplicitSurface & surface, std::vector<CRange> & outside, std::vector<CRange> & inside, std::vector<CRange> & uncertain) const
+	{
+		outside.clear();
+		inside.clear();
+		uncertain.clear();
+
+		if (m_nodes.empty())
+		{
+			return;
+		}
+
+		std::vector<int> stack;
+		stack.push_back(0);
+
+		while (!stack.empty())
+		{
+			const CNode & node = m_nodes[stack.back()];
+			stack.pop_back();
+
+			double lo, hi;
+			surface.range(node.m_min, node.m_max, lo, hi);
+
+			if (lo >= 0)
+			{
+				outside.push_back(CRange(node.m_first, node.m_count));
+			}
+			else if (hi < 0)
+			{
+				inside.push_back(CRange(node.m_first, node.m_count));
+			}
+			else if (node.m_left < 0)
+			{
+				uncertain.push_back(CRange(node.m_first, node.m_count));
+			}
+			else
+			{
+				stack.push_back(node.m_left);
+				stack.push_back(node.m_right);
+			}
+		}
+	};
+};
+
+#endif
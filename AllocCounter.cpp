@@ -0,0 +1,59 @@
+#include "AllocCounter.h"
+
+#include <stdlib.h>
+#include <new>
+
+#ifdef _DEBUG
+
+// every thread counts its own, the cut worker does not show up in the frames of the GUI thread
+static __declspec(thread) size_t allocations = 0;
+
+void * operator new(size_t size)
+{
+	allocations++;
+	void * p = malloc(size > 0 ? size : 1);
+	if (p == NULL)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void * operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void * p)
+{
+	free(p);
+}
+
+void operator delete[](void * p)
+{
+	free(p);
+}
+
+size_t AllocCounter::count()
+{
+	return allocations;
+}
+
+bool AllocCounter::enabled()
+{
+	return true;
+}
+
+#else
+
+size_t AllocCounter::count()
+{
+	return 0;
+}
+
+bool AllocCounter::enabled()
+{
+	return false;
+}
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef AllocCounter_H
+#define AllocCounter_H
+
+#include <stddef.h>
+
+/*!
+* \brief AllocCounter, counts the calls of operator new of every thread
+* \details Debug builds replace the global operator new and delete, release builds keep those of the runtime and
+* \details count nothing. Take count() before and after a piece of work on the same thread, the difference is the
+* \details number of heap allocations it made.
+*/
+class AllocCounter
+{
+public:
+	// allocations made by the calling thread so far, always 0 when not enabled
+	static size_t count();
+
+	// operator new is counted in this build
+	static bool enabled();
+};
+
+#endif
@@ -0,0 +1,402 @@
+#include "BatchRenderer.h"
+#include "AllocCounter.h"
+
+#include <QCoreApplication>
+
+#include <stdlib.h>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+
+BatchRenderer::BatchRenderer()
+{
+	width = 1600;
+	height = 1200;
+}
+
+BatchRenderer::~BatchRenderer()
+{
+}
+
+int BatchRenderer::run(const QStringList & arguments)
+{
+	std::string jobFile;
+	int workers = 1;
+	int part = 0, parts = 1;
+	bool isCheck = false;
+	std::string checkMesh;
+
+	for (int i = 1; i < arguments.size(); i++)
+	{
+		QString arg = arguments[i];
+		bool hasValue = (i + 1 < arguments.size());
+
+		if (arg == "--batch" && hasValue)
+		{
+			jobFile = arguments[++i].toStdString();
+		}
+		else if (arg == "--jobs" && hasValue)
+		{
+			workers = std::max(1, arguments[++i].toInt());
+		}
+		else if (arg == "--size" && hasValue)
+		{
+			if (!parseSize(arguments[++i].toStdString(), width, height))
+			{
+				fprintf(stderr, "Error in the image size %s\n", arguments[i].toStdString().c_str());
+				return 1;
+			}
+		}
+		else if (arg == "--part" && hasValue)
+		{
+			part = arguments[++i].toInt();
+		}
+		else if (arg == "--parts" && hasValue)
+		{
+			parts = std::max(1, arguments[++i].toInt());
+		}
+		else if (arg == "--check-allocations")
+		{
+			// the mesh is optional, an empty scene still draws the overlay
+			isCheck = true;
+			if (hasValue && !arguments[i + 1].startsWith("--"))
+			{
+				checkMesh = arguments[++i].toStdString();
+			}
+		}
+	}
+
+	if (isCheck)
+	{
+		return checkAllocations(checkMesh);
+	}
+
+	if (workers > 1)
+	{
+		return runWorkers(arguments, workers);
+	}
+
+	std::vector<Job> jobs;
+	if (!readJobs(jobFile, jobs))
+	{
+		return 1;
+	}
+
+	// the widget is never shown, it only provides the GL context
+	VolViewer viewer;
+
+	int failed = 0;
+	for (size_t j = 0; j < jobs.size(); j++)
+	{
+		if ((int)(j % parts) != part)
+		{
+			continue;
+		}
+
+		if (!render(viewer, jobs[j]))
+		{
+			failed++;
+		}
+	}
+
+	viewer.newScene();
+	return (failed > 0) ? 1 : 0;
+}
+
+int BatchRenderer::runWorkers(const QStringList & arguments, int workers)
+{
+	// the workers get the same arguments, with their share of the jobs instead of the number of jobs
+	QStringList workerArguments;
+	for (int i = 1; i < arguments.size(); i++)
+	{
+		if (arguments[i] == "--jobs")
+		{
+			i++;
+			continue;
+		}
+		workerArguments << arguments[i];
+	}
+
+	std::vector<QProcess*> processes;
+	for (int w = 0; w < workers; w++)
+	{
+		QProcess * process = new QProcess();
+		process->setProcessChannelMode(QProcess::ForwardedChannels);
+		process->start(QCoreApplication::applicationFilePath(), QStringList(workerArguments) << "--part" << QString::number(w) << "--parts" << QString::number(workers));
+		processes.push_back(process);
+	}
+
+	int exitCode = 0;
+	for (size_t w = 0; w < processes.size(); w++)
+	{
+		QProcess * process = processes[w];
+		if (!process->waitForFinished(-1) || process->exitStatus() != QProcess::NormalExit || process->exitCode() != 0)
+		{
+			fprintf(stderr, "Error in batch worker %d\n", (int)w);
+			exitCode = 1;
+		}
+		delete process;
+	}
+
+	return exitCode;
+}
+
+bool BatchRenderer::readJobs(const std::string & filename, std::vector<Job> & jobs)
+{
+	std::fstream is(filename.c_str(), std::fstream::in);
+	if (is.fail())
+	{
+		fprintf(stderr, "Error in opening file %s\n", filename.c_str());
+		return false;
+	}
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(is, line))
+	{
+		lineNumber++;
+
+		std::istringstream tokens(line);
+		Job job;
+		job.line = lineNumber;
+		job.width = width;
+		job.height = height;
+
+		if (!(tokens >> job.mesh) || job.mesh[0] == '#')
+		{
+			continue;
+		}
+
+		if (!(tokens >> job.output))
+		{
+			fprintf(stderr, "Error in job file %s line %d, no output image\n", filename.c_str(), lineNumber);
+			return false;
+		}
+
+		std::string option;
+		while (tokens >> option)
+		{
+			size_t eq = option.find('=');
+			std::string key = option.substr(0, eq);
+			std::string value = (eq == std::string::npos) ? "" : option.substr(eq + 1);
+
+			if (key == "view")
+			{
+				job.view = value;
+			}
+			else if (key == "cut")
+			{
+				job.cut = value;
+			}
+			else if (key == "mode")
+			{
+				job.mode = value;
+			}
+			else if (key == "size" && parseSize(value, job.width, job.height))
+			{
+			}
+			else
+			{
+				fprintf(stderr, "Error in job file %s line %d, unknown option %s\n", filename.c_str(), lineNumber, option.c_str());
+				return false;
+			}
+		}
+
+		jobs.push_back(job);
+	}
+
+	is.close();
+	return true;
+}
+
+bool BatchRenderer::render(VolViewer & viewer, const Job & job)
+{
+	std::string ext = QFileInfo(QString::fromStdString(job.mesh)).suffix().toStdString();
+	if (ext != "tet" && ext != "t" && ext != "hm")
+	{
+		fprintf(stderr, "Error in line %d, %s is not a tet or hex mesh\n", job.line, job.mesh.c_str());
+		return false;
+	}
+
+	if (!QFileInfo(QString::fromStdString(job.mesh)).exists())
+	{
+		fprintf(stderr, "Error in opening file %s\n", job.mesh.c_str());
+		return false;
+	}
+
+	viewer.newScene();
+	viewer.loadFile(job.mesh.c_str(), ext);
+
+	if (!job.mode.empty())
+	{
+		DRAW_MODE drawMode;
+		if (!parseMode(job.mode, drawMode))
+		{
+			fprintf(stderr, "Error in line %d, unknown mode %s\n", job.line, job.mode.c_str());
+			return false;
+		}
+		viewer.setDrawMode(drawMode);
+	}
+
+	if (!job.cut.empty() && !applyCut(viewer, job.cut))
+	{
+		fprintf(stderr, "Error in line %d, unknown cut %s\n", job.line, job.cut.c_str());
+		return false;
+	}
+
+	if (!job.view.empty() && !viewer.setViewPreset(job.view))
+	{
+		fprintf(stderr, "Error in line %d, unknown view %s\n", job.line, job.view.c_str());
+		return false;
+	}
+
+	QImage image = viewer.renderImage(job.width, job.height);
+	if (image.isNull() || !image.save(QString::fromStdString(job.output)))
+	{
+		fprintf(stderr, "Error in writing file %s\n", job.output.c_str());
+		return false;
+	}
+
+	// a second frame of the same view uploads nothing, in a debug build it must not allocate either
+	if (AllocCounter::enabled())
+	{
+		viewer.renderImage(job.width, job.height);
+		if (viewer.stats().lastAllocations() > 0)
+		{
+			fprintf(stderr, "Error in line %d, a steady state frame allocated %d times\n", job.line, (int)viewer.stats().lastAllocations());
+			return false;
+		}
+	}
+
+	std::cout << "Rendered " << job.output << std::endl;
+	return true;
+}
+
+int BatchRenderer::checkAllocations(const std::string & mesh)
+{
+	if (!AllocCounter::enabled())
+	{
+		fprintf(stderr, "Error in checking allocations, they are only counted by debug builds\n");
+		return 1;
+	}
+
+	VolViewer viewer;
+	if (!mesh.empty())
+	{
+		std::string ext = QFileInfo(QString::fromStdString(mesh)).suffix().toStdString();
+		if ((ext != "tet" && ext != "t" && ext != "hm") || !QFileInfo(QString::fromStdString(mesh)).exists())
+		{
+			fprintf(stderr, "Error in opening file %s\n", mesh.c_str());
+			return 1;
+		}
+		viewer.loadFile(mesh.c_str(), ext);
+	}
+
+	// the overlay and its log line are drawn by every frame as well
+	viewer.statsOn();
+
+	static const char * modes[] = { "points", "wireframe", "flatlines", "flat", "smooth", "shrink", "boundary", "section" };
+	int failed = 0;
+	for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++)
+	{
+		DRAW_MODE drawMode;
+		parseMode(modes[m], drawMode);
+		viewer.setDrawMode(drawMode);
+
+		// the first frame builds the buffers of the mode, the second one draws the same view again
+		viewer.renderImage(width, height);
+		viewer.renderImage(width, height);
+		size_t allocations = viewer.stats().lastAllocations();
+		if (allocations > 0)
+		{
+			fprintf(stderr, "Error in mode %s, a steady state frame allocated %d times\n", modes[m], (int)allocations);
+			failed++;
+		}
+		else
+		{
+			std::cout << "No allocations in mode " << modes[m] << std::endl;
+		}
+	}
+
+	viewer.newScene();
+	return (failed > 0) ? 1 : 0;
+}
+
+bool BatchRenderer::parseSize(const std::string & size, int & width, int & height)
+{
+	int w = 0, h = 0;
+	char x = 0;
+	std::istringstream is(size);
+	if (!(is >> w >> x >> h) || (x != 'x' && x != 'X') || w <= 0 || h <= 0)
+	{
+		return false;
+	}
+
+	width = w;
+	height = h;
+	return true;
+}
+
+bool BatchRenderer::parseMode(const std::string & mode, DRAW_MODE & drawMode)
+{
+	if (mode == "points") drawMode = DRAW_MODE::POINTS;
+	else if (mode == "wireframe") drawMode = DRAW_MODE::WIREFRAME;
+	else if (mode == "flatlines") drawMode = DRAW_MODE::FLATLINES;
+	else if (mode == "flat") drawMode = DRAW_MODE::FLAT;
+	else if (mode == "smooth") drawMode = DRAW_MODE::SMOOTH;
+	else if (mode == "shrink") drawMode = DRAW_MODE::SHRINK;
+	else if (mode == "boundary") drawMode = DRAW_MODE::BOUNDARY;
+	else if (mode == "section") drawMode = DRAW_MODE::SECTION;
+	else return false;
+
+	return true;
+}
+
+bool BatchRenderer::applyCut(VolViewer & viewer, const std::string & cut)
+{
+	// x, y or z alone cuts through the middle of the box
+	if (cut == "x")
+	{
+		viewer.xCut();
+		return true;
+	}
+	if (cut == "y")
+	{
+		viewer.yCut();
+		return true;
+	}
+	if (cut == "z")
+	{
+		viewer.zCut();
+		return true;
+	}
+
+	size_t colon = cut.find(':');
+	if (colon == std::string::npos)
+	{
+		return false;
+	}
+
+	std::string axis = cut.substr(0, colon);
+	double d = atof(cut.substr(colon + 1).c_str());
+
+	CPoint normal;
+	if (axis == "x") normal = CPoint(1, 0, 0);
+	else if (axis == "y") normal = CPoint(0, 1, 0);
+	else if (axis == "z") normal = CPoint(0, 0, 1);
+	else
+	{
+		std::string components = axis;
+		std::replace(components.begin(), components.end(), ',', ' ');
+		std::istringstream is(components);
+		if (!(is >> normal[0] >> normal[1] >> normal[2]) || normal.norm() == 0)
+		{
+			return false;
+		}
+	}
+
+	viewer.setCutPlane(normal, d);
+	return true;
+}
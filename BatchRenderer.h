@@ -0,0 +1,61 @@
+#pragma once
+#include <QStringList>
+#include <QProcess>
+#include <QFileInfo>
+#include <QImage>
+
+#include <string>
+#include <vector>
+
+#include "VolViewer.h"
+
+/*!
+* \brief BatchRenderer, renders meshes into image files from the command line without showing a window
+* \details VolumeViewerQt --batch jobs.txt [--jobs n] [--size WxH]
+* \details Every line of the job file renders one image, blank lines and lines starting with # are skipped:
+* \details   mesh output [view=front|back|left|right|top|bottom|iso] [cut=x|y|z[:d] or cut=nx,ny,nz:d]
+* \details               [mode=points|wireframe|flatlines|flat|smooth|shrink|boundary|section] [size=WxH]
+* \details The format of the image follows the extension of output. With --jobs n the lines are dealt out
+* \details to n worker processes of the same executable, which render into framebuffer objects.
+* \details A debug build renders every job twice and fails it if the second frame allocates on the heap.
+* \details VolumeViewerQt --check-allocations [mesh] [--size WxH] does the same for every mode with the statistics
+* \details overlay on, without a job file.
+*/
+class BatchRenderer
+{
+public:
+	BatchRenderer();
+	~BatchRenderer();
+
+	// run the batch given by the arguments of the application, returns the exit code of the process
+	int run(const QStringList & arguments);
+
+private:
+	struct Job
+	{
+		int line;
+		std::string mesh;
+		std::string output;
+		std::string view;
+		std::string cut;
+		std::string mode;
+		int width;
+		int height;
+	};
+
+	bool readJobs(const std::string & filename, std::vector<Job> & jobs);
+	bool render(VolViewer & viewer, const Job & job);
+	// render every mode twice, returns the exit code, 1 if a second frame allocated
+	int checkAllocations(const std::string & mesh);
+
+	// start the worker processes and wait for all of them, returns the exit code
+	int runWorkers(const QStringList & arguments, int workers);
+
+	static bool parseSize(const std::string & size, int & width, int & height);
+	static bool parseMode(const std::string & mode, DRAW_MODE & drawMode);
+	static bool applyCut(VolViewer & viewer, const std::string & cut);
+
+	// image size of the jobs without their own
+	int width;
+	int height;
+};
@@ -0,0 +1,170 @@
+#include "Camera.h"
+
+#ifndef PI
+#define PI 3.14159265358979323846
+#endif
+
+
+Quaternion Quaternion::fromAxisAngle(const CPoint & axis, double angle)
+{
+	double len = axis.norm();
+	if (len == 0)
+	{
+		return Quaternion();
+	}
+
+	double s = sin(angle / 2.0) / len;
+	return Quaternion(cos(angle / 2.0), axis[0] * s, axis[1] * s, axis[2] * s);
+}
+
+Quaternion Quaternion::operator*(const Quaternion & q) const
+{
+	return Quaternion(
+		w * q.w - x * q.x - y * q.y - z * q.z,
+		w * q.x + x * q.w + y * q.z - z * q.y,
+		w * q.y - x * q.z + y * q.w + z * q.x,
+		w * q.z + x * q.y - y * q.x + z * q.w);
+}
+
+void Quaternion::normalize()
+{
+	double len = sqrt(w * w + x * x + y * y + z * z);
+	if (len == 0)
+	{
+		w = 1;
+		x = y = z = 0;
+		return;
+	}
+	w /= len;
+	x /= len;
+	y /= len;
+	z /= len;
+}
+
+void Quaternion::toMatrix(double r[9]) const
+{
+	r[0] = 1 - 2 * (y * y + z * z);
+	r[1] = 2 * (x * y - w * z);
+	r[2] = 2 * (x * z + w * y);
+	r[3] = 2 * (x * y + w * z);
+	r[4] = 1 - 2 * (x * x + z * z);
+	r[5] = 2 * (y * z - w * x);
+	r[6] = 2 * (x * z - w * y);
+	r[7] = 2 * (y * z + w * x);
+	r[8] = 1 - 2 * (x * x + y * y);
+}
+
+Camera::Camera()
+{
+	m_pivot = CPoint(0, 0, 0);
+	m_offset = CPoint(0, 0, -1);
+	m_fovy = 45.0;
+	m_aspect = 1.0;
+	m_zNear = 0.01;
+	m_zFar = 100.0;
+	m_viewport[0] = m_viewport[1] = 0;
+	m_viewport[2] = m_viewport[3] = 1;
+}
+
+void Camera::lookAt(const CPoint & pivot, double distance)
+{
+	m_pivot = pivot;
+	m_offset = CPoint(0, 0, -distance);
+	m_rotation = Quaternion();
+}
+
+void Camera::setPerspective(double fovy, double aspect, double zNear, double zFar)
+{
+	m_fovy = fovy;
+	m_aspect = aspect;
+	m_zNear = zNear;
+	m_zFar = zFar;
+}
+
+void Camera::setViewport(int x, int y, int width, int height)
+{
+	m_viewport[0] = x;
+	m_viewport[1] = y;
+	m_viewport[2] = width;
+	m_viewport[3] = height;
+}
+
+void Camera::rotate(const CPoint & axis, double angle)
+{
+	// the pivot stays where it is on the screen, only the rotation changes
+	m_rotation = Quaternion::fromAxisAngle(axis, angle * PI / 180.0) * m_rotation;
+	m_rotation.normalize();
+}
+
+void Camera::translate(const CPoint & v)
+{
+	m_offset = m_offset - v;
+}
+
+void Camera::modelView(double m[16]) const
+{
+	double r[9];
+	m_rotation.toMatrix(r);
+
+	// R p + (offset - R pivot)
+	for (int i = 0; i < 3; i++)
+	{
+		double rp = r[3 * i] * m_pivot[0] + r[3 * i + 1] * m_pivot[1] + r[3 * i + 2] * m_pivot[2];
+		for (int j = 0; j < 3; j++)
+		{
+			m[4 * j + i] = r[3 * i + j];
+		}
+		m[12 + i] = m_offset[i] - rp;
+		m[4 * i + 3] = 0;
+	}
+	m[15] = 1;
+}
+
+void Camera::projection(double m[16]) const
+{
+	// the matrix of gluPerspective
+	double f = 1.0 / tan(m_fovy / 2.0 * PI / 180.0);
+	for (int i = 0; i < 16; i++)
+	{
+		m[i] = 0;
+	}
+	m[0] = f / m_aspect;
+	m[5] = f;
+	m[10] = (m_zFar + m_zNear) / (m_zNear - m_zFar);
+	m[11] = -1;
+	m[14] = 2 * m_zFar * m_zNear / (m_zNear - m_zFar);
+}
+
+void Camera::viewport(int v[4]) const
+{
+	for (int i = 0; i < 4; i++)
+	{
+		v[i] = m_viewport[i];
+	}
+}
+
+CPoint Camera::unproject(double winX, double winY, double winZ) const
+{
+	// normalized device coordinates
+	double xn = 2.0 * (winX - m_viewport[0]) / m_viewport[2] - 1.0;
+	double yn = 2.0 * (winY - m_viewport[1]) / m_viewport[3] - 1.0;
+	double zn = 2.0 * winZ - 1.0;
+
+	// invert the perspective, the depth first
+	double f = 1.0 / tan(m_fovy / 2.0 * PI / 180.0);
+	double a = (m_zFar + m_zNear) / (m_zNear - m_zFar);
+	double b = 2 * m_zFar * m_zNear / (m_zNear - m_zFar);
+	double ze = -b / (zn + a);
+	CPoint eye(-xn * ze * m_aspect / f, -yn * ze / f, ze);
+
+	// and the view, R^T (eye - offset) + pivot
+	double r[9];
+	m_rotation.toMatrix(r);
+	CPoint d = eye - m_offset;
+	CPoint p;
+	for (int j = 0; j < 3; j++)
+	{
+		p[j] = r[j] * d[0] + r[3 + j] * d[1] + r[6 + j] * d[2] + m_pivot[j];
+	}
+	return p;
+}
@@ -0,0 +1,77 @@
+#ifndef Camera_H
+#define Camera_H
+
+#include <math.h>
+
+#include "..\MeshLib\core\Geometry\Point.h"
+
+using namespace MeshLib;
+
+/*!
+* \brief Quaternion, a rotation as the unit quaternion w + x i + y j + z k
+*/
+class Quaternion
+{
+public:
+	Quaternion() : w(1), x(0), y(0), z(0) {};
+	Quaternion(double w, double x, double y, double z) : w(w), x(x), y(y), z(z) {};
+
+	// rotation by angle radians about axis
+	static Quaternion fromAxisAngle(const CPoint & axis, double angle);
+
+	// the rotation of other followed by this one
+	Quaternion operator*(const Quaternion & other) const;
+
+	// back to unit length, the products drift away from it
+	void normalize();
+
+	// the rotation matrix, row major
+	void toMatrix(double r[9]) const;
+
+	double w, x, y, z;
+};
+
+/*!
+* \brief Camera, the view and the projection of the viewer, kept on the CPU
+* \details A point p of the scene is at R (p - pivot) + offset in eye coordinates, with R the rotation of the quaternion.
+* \details Rotations turn the scene about the pivot, translations move the eye. The matrices are built from this state
+* \details in the column major layout of OpenGL, so the viewer loads them once per frame and never reads them back.
+*/
+class Camera
+{
+public:
+	Camera();
+
+	// look at the pivot from distance along the z axis, without rotation
+	void lookAt(const CPoint & pivot, double distance);
+	void setPerspective(double fovy, double aspect, double zNear, double zFar);
+	void setViewport(int x, int y, int width, int height);
+
+	// rotate the scene by angle degrees about an axis in eye coordinates through the pivot
+	void rotate(const CPoint & axis, double angle);
+	// move the eye by v in eye coordinates
+	void translate(const CPoint & v);
+
+	void modelView(double m[16]) const;
+	void projection(double m[16]) const;
+	void viewport(int v[4]) const;
+
+	// the point of the scene at the window coordinates, winZ is 0 on the near plane and 1 on the far plane
+	CPoint unproject(double winX, double winY, double winZ) const;
+
+	// distance of the pivot in front of the eye
+	double pivotDepth() const { return -m_offset[2]; };
+
+protected:
+	CPoint m_pivot;
+	CPoint m_offset;
+	Quaternion m_rotation;
+
+	double m_fovy;
+	double m_aspect;
+	double m_zNear;
+	double m_zFar;
+	int m_viewport[4];
+};
+
+#endif
@@ -0,0 +1,450 @@
+#ifndef _MESHLIB_CROSS_SECTION_H_
+#define _MESHLIB_CROSS_SECTION_H_
+
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <fstream>
+#include <emmintrin.h>
+
+#include "..\MeshLib\core\Geometry\Point.h"
+#include "..\MeshLib\core\Geometry\Point2.h"
+#include "..\MeshLib\core\Geometry\plane.h"
+
+#include "MeshArrays.h"
+
+namespace MeshLib
+{
+	/*!
+	* \brief CSectionPoint, a corner of a cross section polygon
+	* \details The point lies on the mesh edge (m_v0, m_v1), or on the vertex m_v0 if both are equal.
+	* \details Neighboring elements produce the same key for a shared edge, which welds the polygons on export.
+	*/
+	struct CSectionPoint
+	{
+		CPoint  m_position;
+		CPoint2 m_uv;
+		int m_v0;
+		int m_v1;
+	};
+
+	/*!
+	* \brief CCrossSection, the exact intersection of a volume mesh with a plane
+	* \details Every element cut by the plane contributes one convex polygon, the corners of polygon i
+	* \details are m_points[m_polygonStart[i]] ... m_points[m_polygonStart[i + 1] - 1], counter clockwise around m_normal.
+	*/
+	class CCrossSection
+	{
+	public:
+		CCrossSection() { clear(); };
+		~CCrossSection() {};
+
+		// an empty section belongs to no plane
+		void clear()
+		{
+			m_normal = CPoint(0, 0, 0);
+			m_d = 0;
+			m_points.clear();
+			m_polygonStart.clear();
+			m_polygonStart.push_back(0);
+			m_polygonGroup.clear();
+		};
+
+		size_t numPolygons() const { return m_polygonGroup.size(); };
+
+		void swap(CCrossSection & other)
+		{
+			std::swap(m_normal, other.m_normal);
+			std::swap(m_d, other.m_d);
+			m_points.swap(other.m_points);
+			m_polygonStart.swap(other.m_polygonStart);
+			m_polygonGroup.swap(other.m_polygonGroup);
+		};
+
+		// write the section as a triangle mesh, polygons are split into fans
+		void _write_m(const char * output);
+		// write the section polygons as they are
+		void _write_obj(const char * output);
+
+	public:
+		//!< the plane the section was computed for
+		CPoint m_normal;
+		double m_d;
+
+		std::vector<CSectionPoint> m_points;
+		std::vector<int> m_polygonStart;
+		std::vector<int> m_polygonGroup;
+
+	protected:
+		// give every welded corner a 1-based id, in the order of first use
+		int _weld(std::vector<int> & ids);
+	};
+
+	/*!
+	* \brief CSliceKernel, computes the cross section of a mesh stored in CMeshArrays
+	* \details The signed distances of the vertices are evaluated two at a time with SSE2, the elements are
+	* \details then tested in batches of four for a sign change, and only the straddling ones are intersected.
+	*/
+	class CSliceKernel
+	{
+	public:
+		void slice(const CMeshArrays & arrays, CPlane & plane, CCrossSection & section);
+
+	protected:
+		void _distances(const CMeshArrays & arrays, CPlane & plane);
+		// bit k is set if element first + k has vertices on both sides of the plane
+		int _straddleMask(const CMeshArrays & arrays, size_t first);
+		void _sliceElement(const CMeshArrays & arrays, size_t element, CCrossSection & section);
+
+		std::vector<double> m_distances;
+
+		// corners of the element being sliced, and their angles around the section normal
+		std::vector<CSectionPoint> m_corners;
+		std::vector<std::pair<double, int> > m_order;
+
+		// in plane basis, m_axisU ^ m_axisV == normal
+		CPoint m_axisU;
+		CPoint m_axisV;
+	};
+
+	inline int CCrossSection::_weld(std::vector<int> & ids)
+	{
+		std::map<std::pair<int, int>, int> keys;
+		ids.resize(m_points.size());
+
+		int nextId = 1;
+		for (size_t i = 0; i < m_points.size(); i++)
+		{
+			CSectionPoint & sp = m_points[i];
+			std::pair<int, int> key(std::min(sp.m_v0, sp.m_v1), std::max(sp.m_v0, sp.m_v1));
+			std::map<std::pair<int, int>, int>::iterator kIter = keys.find(key);
+			if (kIter == keys.end())
+			{
+				keys.insert(std::pair<std::pair<int, int>, int>(key, nextId));
+				ids[i] = nextId++;
+			}
+			else
+			{
+				ids[i] = kIter->second;
+			}
+		}
+
+		return nextId - 1;
+	};
+
+	inline void CCrossSection::_write_m(const char * output)
+	{
+		std::fstream _os(output, std::fstream::out);
+		if (_os.fail())
+		{
+			fprintf(stderr, "Error is opening file %s\n", output);
+			return;
+		}
+
+		std::vector<int> ids;
+		int nVertices = _weld(ids);
+
+		std::vector<bool> written(nVertices + 1, false);
+		for (size_t i = 0; i < m_points.size(); i++)
+		{
+			if (written[ids[i]])
+			{
+				continue;
+			}
+			written[ids[i]] = true;
+
+			CSectionPoint & sp = m_points[i];
+			_os << "Vertex " << ids[i] << " " << sp.m_position << " {uv=(" << sp.m_uv[0] << " " << sp.m_uv[1] << ")}" << std::endl;
+		}
+
+		int faceid = 1;
+		for (size_t f = 0; f < numPolygons(); f++)
+		{
+			int first = m_polygonStart[f];
+			for (int k = first + 1; k + 1 < m_polygonStart[f + 1]; k++)
+			{
+				_os << "Face " << faceid++ << " " << ids[first] << " " << ids[k] << " " << ids[k + 1] << std::endl;
+			}
+		}
+
+		_os.close();
+	};
+
+	inline void CCrossSection::_write_obj(const char * output)
+	{
+		std::fstream _os(output, std::fstream::out);
+		if (_os.fail())
+		{
+			fprintf(stderr, "Error is opening file %s\n", output);
+			return;
+		}
+
+		std::vector<int> ids;
+		int nVertices = _weld(ids);
+
+		_os << "# Generated by VolumeViewerQt" << std::endl;
+
+		std::vector<bool> written(nVertices + 1, false);
+		std::vector<int> order;
+		for (size_t i = 0; i < m_points.size(); i++)
+		{
+			if (!written[ids[i]])
+			{
+				written[ids[i]] = true;
+				order.push_back((int)i);
+			}
+		}
+
+		// ids are assigned in the order of first use, so the i-th written vertex has id i + 1
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			_os << "v " << m_points[order[i]].m_position << std::endl;
+		}
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			CPoint2 & uv = m_points[order[i]].m_uv;
+			_os << "vt " << uv[0] << " " << uv[1] << std::endl;
+		}
+
+		for (size_t f = 0; f < numPolygons(); f++)
+		{
+			_os << "f ";
+			for (int k = m_polygonStart[f]; k < m_polygonStart[f + 1]; k++)
+			{
+				_os << ids[k] << "/" << ids[k] << " ";
+			}
+			_os << std::endl;
+		}
+
+		_os.close();
+	};
+
+	inline void CSliceKernel::slice(const CMeshArrays & arrays, CPlane & plane, CCrossSection & section)
+	{
+		section.clear();
+
+		CPoint n = plane.normal();
+		section.m_normal = n;
+		section.m_d = plane.d();
+
+		// any axis not parallel to the normal spans the plane together with it
+		CPoint axis(1, 0, 0);
+		if (fabs(n[1]) < fabs(n[0]) && fabs(n[1]) <= fabs(n[2])) axis = CPoint(0, 1, 0);
+		else if (fabs(n[2]) < fabs(n[0]) && fabs(n[2]) < fabs(n[1])) axis = CPoint(0, 0, 1);
+		m_axisU = n ^ axis;
+		m_axisU /= m_axisU.norm();
+		m_axisV = n ^ m_axisU;
+
+		if (arrays.numElements() == 0)
+		{
+			return;
+		}
+
+		_distances(arrays, plane);
+
+		size_t nElements = arrays.numElements();
+		size_t e = 0;
+		for (; e + 4 <= nElements; e += 4)
+		{
+			int mask = _straddleMask(arrays, e);
+			if (mask == 0)
+			{
+				continue;
+			}
+
+			for (int k = 0; k < 4; k++)
+			{
+				if (mask & (1 << k))
+				{
+					_sliceElement(arrays, e + k, section);
+				}
+			}
+		}
+
+		// the remaining elements
+		for (; e < nElements; e++)
+		{
+			const int * ev = &arrays.m_elements[e * arrays.m_verticesPerElement];
+			double lo = m_distances[ev[0]];
+			double hi = lo;
+			for (int k = 1; k < arrays.m_verticesPerElement; k++)
+			{
+				lo = std::min(lo, m_distances[ev[k]]);
+				hi = std::max(hi, m_distances[ev[k]]);
+			}
+			if (lo < 0 && hi >= 0)
+			{
+				_sliceElement(arrays, e, section);
+			}
+		}
+	};
+
+	inline void CSliceKernel::_distances(const CMeshArrays & arrays, CPlane & plane)
+	{
+		size_t nVertices = arrays.numVertices();
+		m_distances.resize(nVertices);
+
+		CPoint n = plane.normal();
+		double d = plane.d();
+
+		// same expression as CPlane::side, so the section agrees with the outside() labels of _cut
+		const double * px = &arrays.m_x[0];
+		const double * py = &arrays.m_y[0];
+		const double * pz = &arrays.m_z[0];
+		double * dist = &m_distances[0];
+
+		__m128d nx = _mm_set1_pd(n[0]);
+		__m128d ny = _mm_set1_pd(n[1]);
+		__m128d nz = _mm_set1_pd(n[2]);
+		__m128d dd = _mm_set1_pd(d);
+
+		size_t i = 0;
+		for (; i + 2 <= nVertices; i += 2)
+		{
+			__m128d s = _mm_mul_pd(_mm_loadu_pd(px + i), nx);
+			s = _mm_add_pd(s, _mm_mul_pd(_mm_loadu_pd(py + i), ny));
+			s = _mm_add_pd(s, _mm_mul_pd(_mm_loadu_pd(pz + i), nz));
+			_mm_storeu_pd(dist + i, _mm_sub_pd(s, dd));
+		}
+		for (; i < nVertices; i++)
+		{
+			dist[i] = px[i] * n[0] + py[i] * n[1] + pz[i] * n[2] - d;
+		}
+	};
+
+	inline int CSliceKernel::_straddleMask(const CMeshArrays & arrays, size_t first)
+	{
+		int nv = arrays.m_verticesPerElement;
+		const int * e0 = &arrays.m_elements[first * nv];
+		const int * e1 = e0 + nv;
+		const int * e2 = e1 + nv;
+		const int * e3 = e2 + nv;
+		const double * dist = &m_distances[0];
+
+		// lanes hold the elements (first, first + 1) and (first + 2, first + 3)
+		__m128d lo01 = _mm_set_pd(dist[e1[0]], dist[e0[0]]);
+		__m128d lo23 = _mm_set_pd(dist[e3[0]], dist[e2[0]]);
+		__m128d hi01 = lo01;
+		__m128d hi23 = lo23;
+
+		for (int k = 1; k < nv; k++)
+		{
+			__m128d d01 = _mm_set_pd(dist[e1[k]], dist[e0[k]]);
+			__m128d d23 = _mm_set_pd(dist[e3[k]], dist[e2[k]]);
+			lo01 = _mm_min_pd(lo01, d01);
+			hi01 = _mm_max_pd(hi01, d01);
+			lo23 = _mm_min_pd(lo23, d23);
+			hi23 = _mm_max_pd(hi23, d23);
+		}
+
+		// a vertex on the plane counts as outside, the same as in _cut
+		__m128d zero = _mm_setzero_pd();
+		int m01 = _mm_movemask_pd(_mm_and_pd(_mm_cmplt_pd(lo01, zero), _mm_cmpge_pd(hi01, zero)));
+		int m23 = _mm_movemask_pd(_mm_and_pd(_mm_cmplt_pd(lo23, zero), _mm_cmpge_pd(hi23, zero)));
+
+		return m01 | (m23 << 2);
+	};
+
+	inline void CSliceKernel::_sliceElement(const CMeshArrays & arrays, size_t element, CCrossSection & section)
+	{
+		static const int tetEdges[6][2] = { { 0, 1 }, { 0, 2 }, { 0, 3 }, { 1, 2 }, { 1, 3 }, { 2, 3 } };
+		static const int hexEdges[12][2] = { { 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 0 },
+											 { 4, 5 }, { 5, 6 }, { 6, 7 }, { 7, 4 },
+											 { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 } };
+
+		int nv = arrays.m_verticesPerElement;
+		const int * ev = &arrays.m_elements[element * nv];
+		const int (*edges)[2] = (nv == 4) ? tetEdges : hexEdges;
+		int nEdges = (nv == 4) ? 6 : 12;
+
+		m_corners.clear();
+
+		for (int k = 0; k < nEdges; k++)
+		{
+			int a = ev[edges[k][0]];
+			int b = ev[edges[k][1]];
+			double da = m_distances[a];
+			double db = m_distances[b];
+
+			// the edge crosses if exactly one end is inside, orient it from inside to outside
+			if ((da < 0) == (db < 0))
+			{
+				continue;
+			}
+			if (db < 0)
+			{
+				std::swap(a, b);
+				std::swap(da, db);
+			}
+
+			CSectionPoint sp;
+			if (db == 0)
+			{
+				// the outside end lies on the plane, several edges may end here
+				sp.m_v0 = b;
+				sp.m_v1 = b;
+			}
+			else
+			{
+				sp.m_v0 = a;
+				sp.m_v1 = b;
+			}
+
+			bool duplicate = false;
+			for (size_t c = 0; c < m_corners.size(); c++)
+			{
+				if (m_corners[c].m_v0 == sp.m_v0 && m_corners[c].m_v1 == sp.m_v1)
+				{
+					duplicate = true;
+					break;
+				}
+			}
+			if (duplicate)
+			{
+				continue;
+			}
+
+			double t = da / (da - db);
+			sp.m_position = CPoint(arrays.m_x[a] + t * (arrays.m_x[b] - arrays.m_x[a]),
+				arrays.m_y[a] + t * (arrays.m_y[b] - arrays.m_y[a]),
+				arrays.m_z[a] + t * (arrays.m_z[b] - arrays.m_z[a]));
+			sp.m_uv = CPoint2(arrays.m_u[a] + t * (arrays.m_u[b] - arrays.m_u[a]),
+				arrays.m_v[a] + t * (arrays.m_v[b] - arrays.m_v[a]));
+
+			m_corners.push_back(sp);
+		}
+
+		// the element only touches the plane
+		if (m_corners.size() < 3)
+		{
+			return;
+		}
+
+		// the section of a convex element is convex, sort the corners by angle around their center
+		CPoint center(0, 0, 0);
+		for (size_t c = 0; c < m_corners.size(); c++)
+		{
+			center += m_corners[c].m_position;
+		}
+		center /= (double)m_corners.size();
+
+		m_order.clear();
+		for (size_t c = 0; c < m_corners.size(); c++)
+		{
+			CPoint r = m_corners[c].m_position - center;
+			m_order.push_back(std::pair<double, int>(atan2(r * m_axisV, r * m_axisU), (int)c));
+		}
+		std::sort(m_order.begin(), m_order.end());
+
+		for (size_t c = 0; c < m_order.size(); c++)
+		{
+			section.m_points.push_back(m_corners[m_order[c].second]);
+		}
+		section.m_polygonStart.push_back((int)section.m_points.size());
+		section.m_polygonGroup.push_back(arrays.m_groups[element]);
+	};
+};
+
+#endif
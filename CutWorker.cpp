@@ -0,0 +1,346 @@
+#include "CutWorker.h"
+#include "AllocCounter.h"
+
+CutWorker::CutWorker(QObject * _parent) : QThread(_parent)
+{
+	isPending = false;
+	isRunning = false;
+	isReady = false;
+	isStopping = false;
+	pendingSurface = NULL;
+	cutMs = -1;
+	proxyMs = -1;
+	cutAllocations = 0;
+	proxyAllocations = 0;
+	proxySwaps = 0;
+
+	isProxyPending = false;
+	isBuildingProxy = false;
+	isProxyReady = false;
+	isProxyCancelled = false;
+}
+
+CutWorker::~CutWorker()
+{
+	stop();
+	delete pendingSurface;
+}
+
+void CutWorker::requestCut(const CPlane & plane, const std::vector<TMeshLib::CVTMesh*> & tmeshes, const std::vector<HMeshLib::CVHMesh*> & hmeshes)
+{
+	CPlane p = plane;
+	requestCut(CImplicitPlane(p), tmeshes, hmeshes);
+}
+
+void CutWorker::requestCut(const CImplicitSurface & surface, const std::vector<TMeshLib::CVTMesh*> & tmeshes, const std::vector<HMeshLib::CVHMesh*> & hmeshes)
+{
+	QMutexLocker locker(&mutex);
+
+	// an older request which has not been started yet is simply overwritten
+	delete pendingSurface;
+	pendingSurface = surface.clone();
+	pendingTMeshes = tmeshes;
+	pendingHMeshes = hmeshes;
+	isPending = true;
+
+	// the proxies of the current surfaces are about to be outdated
+	isProxyCancelled = true;
+
+	condition.wakeAll();
+}
+
+void CutWorker::requestProxy(const std::vector<TMeshLib::CVTMesh*> & tmeshes, const std::vector<HMeshLib::CVHMesh*> & hmeshes)
+{
+	QMutexLocker locker(&mutex);
+
+	// the proxies which still match their surface are kept
+	proxyTMeshes.clear();
+	proxyHMeshes.clear();
+	for (size_t t = 0; t < tmeshes.size(); t++)
+	{
+		if (tmeshes[t]->m_proxy.m_cutVersion != tmeshes[t]->cutVersion() || tmeshes[t]->m_proxy.m_geometryVersion != tmeshes[t]->geometryVersion())
+		{
+			proxyTMeshes.push_back(tmeshes[t]);
+		}
+	}
+	for (size_t h = 0; h < hmeshes.size(); h++)
+	{
+		if (hmeshes[h]->m_proxy.m_cutVersion != hmeshes[h]->cutVersion() || hmeshes[h]->m_proxy.m_geometryVersion != hmeshes[h]->geometryVersion())
+		{
+			proxyHMeshes.push_back(hmeshes[h]);
+		}
+	}
+	isProxyPending = !proxyTMeshes.empty() || !proxyHMeshes.empty();
+
+	condition.wakeAll();
+}
+
+bool CutWorker::swapBuffers()
+{
+	QMutexLocker locker(&mutex);
+
+	if (isProxyReady)
+	{
+		swapProxyBuffers();
+		isProxyReady = false;
+		condition.wakeAll();
+	}
+
+	if (!isReady)
+	{
+		return false;
+	}
+
+	swapMeshBuffers();
+	isReady = false;
+	condition.wakeAll();
+
+	return true;
+}
+
+double CutWorker::lastCutMs()
+{
+	QMutexLocker locker(&mutex);
+	return cutMs;
+}
+
+double CutWorker::lastProxyMs()
+{
+	QMutexLocker locker(&mutex);
+	return proxyMs;
+}
+
+size_t CutWorker::lastCutAllocations()
+{
+	QMutexLocker locker(&mutex);
+	return cutAllocations;
+}
+
+size_t CutWorker::lastProxyAllocations()
+{
+	QMutexLocker locker(&mutex);
+	return proxyAllocations;
+}
+
+int CutWorker::proxySwapCount()
+{
+	QMutexLocker locker(&mutex);
+	return proxySwaps;
+}
+
+void CutWorker::waitForIdle()
+{
+	QMutexLocker locker(&mutex);
+
+	// the meshes may be modified or deleted afterwards, no proxy is built from them anymore
+	isProxyPending = false;
+	isProxyCancelled = true;
+
+	while (isPending || isRunning || isReady || isBuildingProxy || isProxyReady)
+	{
+		if (isProxyReady)
+		{
+			swapProxyBuffers();
+			isProxyReady = false;
+			condition.wakeAll();
+			continue;
+		}
+
+		if (isReady)
+		{
+			swapMeshBuffers();
+			isReady = false;
+			condition.wakeAll();
+		}
+		else
+		{
+			condition.wait(&mutex);
+		}
+	}
+
+	// the swaps above queue the proxies again
+	isProxyPending = false;
+	proxyTMeshes.clear();
+	proxyHMeshes.clear();
+}
+
+void CutWorker::stop()
+{
+	{
+		QMutexLocker locker(&mutex);
+		isStopping = true;
+		isPending = false;
+		condition.wakeAll();
+	}
+
+	wait();
+}
+
+void CutWorker::swapMeshBuffers()
+{
+	for (size_t t = 0; t < currentTMeshes.size(); t++)
+	{
+		currentTMeshes[t]->_swapCutBuffers();
+	}
+
+	for (size_t h = 0; h < currentHMeshes.size(); h++)
+	{
+		currentHMeshes[h]->_swapCutBuffers();
+	}
+
+	// the new surfaces get their proxies once nothing else is queued
+	proxyTMeshes = currentTMeshes;
+	proxyHMeshes = currentHMeshes;
+	isProxyPending = true;
+
+	currentTMeshes.clear();
+	currentHMeshes.clear();
+}
+
+void CutWorker::swapProxyBuffers()
+{
+	for (size_t t = 0; t < builtTMeshes.size(); t++)
+	{
+		builtTMeshes[t]->m_proxy.swap(builtTMeshes[t]->m_proxyBack);
+	}
+
+	for (size_t h = 0; h < builtHMeshes.size(); h++)
+	{
+		builtHMeshes[h]->m_proxy.swap(builtHMeshes[h]->m_proxyBack);
+	}
+
+	builtTMeshes.clear();
+	builtHMeshes.clear();
+	proxySwaps++;
+}
+
+bool CutWorker::buildProxies()
+{
+	// no swap happens while the worker is busy, so the visible face lists stay put
+	for (size_t t = 0; t < builtTMeshes.size(); t++)
+	{
+		TMeshLib::CVTMesh * tmesh = builtTMeshes[t];
+		if (tmesh->isFiber() || tmesh->m_pHFaces_Below.size() < proxyMinFaces)
+		{
+			// small surfaces are drawn as they are
+			tmesh->m_proxyBack.clear();
+		}
+		else if (!tmesh->_buildProxy(proxyResolution, &isProxyCancelled, tmesh->m_proxyBack))
+		{
+			return false;
+		}
+	}
+
+	for (size_t h = 0; h < builtHMeshes.size(); h++)
+	{
+		HMeshLib::CVHMesh * hmesh = builtHMeshes[h];
+		if (hmesh->m_pHFaces_Below.size() < proxyMinFaces)
+		{
+			hmesh->m_proxyBack.clear();
+		}
+		else if (!hmesh->_buildProxy(proxyResolution, &isProxyCancelled, hmesh->m_proxyBack))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void CutWorker::run()
+{
+	QMutexLocker locker(&mutex);
+
+	while (true)
+	{
+		// the back buffers are reused, so a new cut only starts once the last one is swapped in,
+		// and the proxies wait for the cuts
+		bool canCut = isPending && !isReady;
+		bool canBuildProxy = isProxyPending && !isPending && !isReady && !isProxyReady;
+		while (!isStopping && !canCut && !canBuildProxy)
+		{
+			condition.wait(&mutex);
+			canCut = isPending && !isReady;
+			canBuildProxy = isProxyPending && !isPending && !isReady && !isProxyReady;
+		}
+
+		if (isStopping)
+		{
+			break;
+		}
+
+		if (!canCut)
+		{
+			isProxyPending = false;
+			isProxyCancelled = false;
+			isBuildingProxy = true;
+			builtTMeshes.swap(proxyTMeshes);
+			builtHMeshes.swap(proxyHMeshes);
+			proxyTMeshes.clear();
+			proxyHMeshes.clear();
+
+			locker.unlock();
+			QElapsedTimer proxyTimer;
+			proxyTimer.start();
+			size_t allocationsBefore = AllocCounter::count();
+			bool isComplete = buildProxies();
+			size_t allocations = AllocCounter::count() - allocationsBefore;
+			double elapsed = proxyTimer.nsecsElapsed() / 1e6;
+			locker.relock();
+
+			isBuildingProxy = false;
+			if (isComplete)
+			{
+				proxyMs = elapsed;
+				proxyAllocations = allocations;
+			}
+			// a cancelled build is dropped, the next cut queues it again
+			isProxyReady = isComplete && !isProxyCancelled;
+			if (!isProxyReady)
+			{
+				builtTMeshes.clear();
+				builtHMeshes.clear();
+			}
+			condition.wakeAll();
+			continue;
+		}
+
+		CImplicitSurface * surface = pendingSurface;
+		pendingSurface = NULL;
+		currentTMeshes = pendingTMeshes;
+		currentHMeshes = pendingHMeshes;
+		isPending = false;
+		isRunning = true;
+
+		locker.unlock();
+
+		QElapsedTimer cutTimer;
+		cutTimer.start();
+		size_t allocationsBefore = AllocCounter::count();
+
+		for (size_t t = 0; t < currentTMeshes.size(); t++)
+		{
+			currentTMeshes[t]->_cutBack(*surface);
+		}
+
+		for (size_t h = 0; h < currentHMeshes.size(); h++)
+		{
+			currentHMeshes[h]->_cutBack(*surface);
+		}
+
+		delete surface;
+
+		size_t allocations = AllocCounter::count() - allocationsBefore;
+		double elapsed = cutTimer.nsecsElapsed() / 1e6;
+
+		locker.relock();
+
+		cutMs = elapsed;
+		cutAllocations = allocations;
+		isRunning = false;
+		isReady = true;
+		condition.wakeAll();
+
+		emit cutReady();
+	}
+}
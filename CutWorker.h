@@ -0,0 +1,117 @@
+#pragma once
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+
+#include <vector>
+
+#include "ViewerTFiberMesh.h"
+#include "ViewerHMesh.h"
+
+using namespace MeshLib;
+
+/*! \brief This class computes the cuts of the volumes on a background thread
+* \details Requests are coalesced: only the latest plane position is computed, intermediate ones are dropped.
+* \details The result is written into the back buffers of the meshes, and swapped with the visible face lists
+* \details by swapBuffers(), which the viewer calls on the GUI thread at the beginning of every frame.
+* \details Along with the lists the cut writes the faces that entered and left them, so the surface buffers patch only those.
+* \details Once a cut is swapped in and nothing else is queued, the worker builds the coarse proxies of the visible
+* \details surfaces, the next request cancels them. They are swapped in by swapBuffers() as well.
+*/
+
+class CutWorker :
+	public QThread
+{
+	Q_OBJECT
+
+public:
+	CutWorker(QObject * _parent = 0);
+	~CutWorker();
+
+	/// Queue a cut of the meshes, replacing any request which has not been started yet.
+	void requestCut(const CPlane & plane, const std::vector<TMeshLib::CVTMesh*> & tmeshes, const std::vector<HMeshLib::CVHMesh*> & hmeshes);
+
+	/// Queue a cut along an implicit surface, the surface is copied.
+	void requestCut(const CImplicitSurface & surface, const std::vector<TMeshLib::CVTMesh*> & tmeshes, const std::vector<HMeshLib::CVHMesh*> & hmeshes);
+
+	/// Queue the proxies of the current visible surfaces, for meshes cut on the GUI thread.
+	void requestProxy(const std::vector<TMeshLib::CVTMesh*> & tmeshes, const std::vector<HMeshLib::CVHMesh*> & hmeshes);
+
+	/// Swap in the latest completed cut and proxies. Returns true if the visible face lists changed.
+	bool swapBuffers();
+
+	/// Block until every queued cut is computed and swapped in, the meshes can be modified afterwards.
+	/// Proxies being built are cancelled.
+	void waitForIdle();
+
+	/// Stop the thread, pending requests are discarded.
+	void stop();
+
+	/// Time in milliseconds the last cut and the last proxy build took on the worker thread, -1 before the first one.
+	double lastCutMs();
+	double lastProxyMs();
+
+	/// Heap allocations of the last cut and the last proxy build, 0 if AllocCounter is not enabled.
+	size_t lastCutAllocations();
+	size_t lastProxyAllocations();
+
+	/// Number of proxy builds swapped in so far, the viewer updates the statistics of the proxies when it changes.
+	int proxySwapCount();
+
+signals:
+
+	/// Emitted from the worker thread when a cut is ready to be swapped in.
+	void cutReady();
+
+protected:
+	void run();
+
+private:
+	void swapMeshBuffers();
+	void swapProxyBuffers();
+
+	// build the proxies of builtTMeshes and builtHMeshes into their back buffers, called without the lock
+	bool buildProxies();
+
+	// cells along the longest side of the proxy grid, and the smallest surface worth a proxy
+	static const int proxyResolution = 96;
+	static const size_t proxyMinFaces = 200000;
+
+	QMutex mutex;
+	QWaitCondition condition;
+
+	bool isPending;
+	bool isRunning;
+	bool isReady;
+	bool isStopping;
+
+	double cutMs;
+	double proxyMs;
+	size_t cutAllocations;
+	size_t proxyAllocations;
+	int proxySwaps;
+
+	// owned copy of the surface of the pending request
+	CImplicitSurface * pendingSurface;
+	std::vector<TMeshLib::CVTMesh*> pendingTMeshes;
+	std::vector<HMeshLib::CVHMesh*> pendingHMeshes;
+
+	// meshes of the cut being computed, or waiting to be swapped in
+	std::vector<TMeshLib::CVTMesh*> currentTMeshes;
+	std::vector<HMeshLib::CVHMesh*> currentHMeshes;
+
+	bool isProxyPending;
+	bool isBuildingProxy;
+	bool isProxyReady;
+	// read by the worker while building, set by the GUI thread to give up early
+	volatile bool isProxyCancelled;
+
+	// meshes whose proxies are queued
+	std::vector<TMeshLib::CVTMesh*> proxyTMeshes;
+	std::vector<HMeshLib::CVHMesh*> proxyHMeshes;
+
+	// meshes whose proxies are being built, or waiting to be swapped in
+	std::vector<TMeshLib::CVTMesh*> builtTMeshes;
+	std::vector<HMeshLib::CVHMesh*> builtHMeshes;
+};
@@ -42,6 +42,10 @@ void ExportDialog::accept()
 	else if (onlyCut->isChecked()) {
 		r = 4;
 	}
+	else if (onlySection->isChecked())
+	{
+		r = 5;
+	}
 
 	done(r);
 };
@@ -53,6 +57,7 @@ QGroupBox * ExportDialog::createExportGroup()
 	onlyBelow = new QRadioButton(tr("The Below Surface"));
 	onlyAbove = new QRadioButton(tr("The Above Surface"));
 	onlyCut = new QRadioButton(tr("The Cut Surface"));
+	onlySection = new QRadioButton(tr("The Exact Cross Section"));
 	whole->setChecked(true);
 
 	QVBoxLayout * vbox = new QVBoxLayout();
@@ -60,6 +65,7 @@ QGroupBox * ExportDialog::createExportGroup()
 	vbox->addWidget(onlyBelow);
 	vbox->addWidget(onlyAbove);
 	vbox->addWidget(onlyCut);
+	vbox->addWidget(onlySection);
 	vbox->addStretch(1);
 	exportGroup->setLayout(vbox);
 
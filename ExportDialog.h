@@ -28,5 +28,6 @@ private:
 	QRadioButton * onlyBelow;
 	QRadioButton * onlyAbove;
 	QRadioButton * onlyCut;
+	QRadioButton * onlySection;
 };
 
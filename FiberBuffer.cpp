@@ -0,0 +1,280 @@
+#include "FiberBuffer.h"
+
+#include <stddef.h>
+#include <math.h>
+#include <algorithm>
+#include <random>
+
+
+FiberBuffer::FiberBuffer() : vertexBuffer(QGLBuffer::VertexBuffer)
+{
+	multiDrawArrays = NULL;
+	isLoaded = false;
+	drawnPoints = 0;
+	lastUpload = 0;
+
+	for (int k = 0; k < numLevels; k++)
+	{
+		tolerances[k] = 0;
+	}
+
+	vertexBuffer.setUsagePattern(QGLBuffer::StaticDraw);
+}
+
+FiberBuffer::~FiberBuffer()
+{
+	vertexBuffer.destroy();
+}
+
+bool FiberBuffer::update(TMeshLib::CVTMesh * mesh)
+{
+	lastUpload = 0;
+	if (isLoaded)
+	{
+		return false;
+	}
+	isLoaded = true;
+
+	multiDrawArrays = (MultiDrawArrays)QGLContext::currentContext()->getProcAddress("glMultiDrawArrays");
+
+	std::list<TMeshLib::CFiber*> & fibers = mesh->fibers();
+
+	// the colors follow the order of the fibers in the file
+	std::uniform_real_distribution<double> unif(0.0, 1.0);
+	std::default_random_engine dre;
+
+	std::vector<TMeshLib::CFiber*> order;
+	std::vector<GLubyte> colors;
+	CPoint vmin(1e+10, 1e+10, 1e+10);
+	CPoint vmax(-1e+10, -1e+10, -1e+10);
+	for (std::list<TMeshLib::CFiber*>::iterator fIter = fibers.begin(); fIter != fibers.end(); fIter++)
+	{
+		order.push_back(*fIter);
+		for (int j = 0; j < 3; j++)
+		{
+			colors.push_back((GLubyte)(unif(dre) * 255.0));
+		}
+
+		std::list<CPoint> & pointList = (*fIter)->points();
+		for (std::list<CPoint>::iterator pIter = pointList.begin(); pIter != pointList.end(); pIter++)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				vmin[j] = std::min(vmin[j], (*pIter)[j]);
+				vmax[j] = std::max(vmax[j], (*pIter)[j]);
+			}
+		}
+	}
+
+	// level 0 is exact, every further level allows four times the deviation of the one before
+	double diagonal = order.empty() ? 1.0 : (vmax - vmin).norm();
+	for (int k = 1; k < numLevels; k++)
+	{
+		tolerances[k] = diagonal * 0.0005 * pow(4.0, k - 1);
+	}
+
+	std::vector<int> sorted(order.size());
+	for (size_t f = 0; f < sorted.size(); f++)
+	{
+		sorted[f] = (int)f;
+	}
+	std::stable_sort(sorted.begin(), sorted.end(), [&order](int a, int b) { return order[a]->points().size() > order[b]->points().size(); });
+
+	std::vector<Vertex> vertices;
+	std::vector<CPoint> points;
+	std::vector<int> kept;
+
+	levelFirsts.clear();
+	levelCounts.clear();
+	fiberLength.clear();
+	fiberCenter.clear();
+	fiberRadius.clear();
+
+	for (size_t i = 0; i < sorted.size(); i++)
+	{
+		int f = sorted[i];
+		std::list<CPoint> & pointList = order[f]->points();
+		points.assign(pointList.begin(), pointList.end());
+
+		CPoint center(0, 0, 0);
+		for (size_t p = 0; p < points.size(); p++)
+		{
+			center = center + points[p];
+		}
+		if (!points.empty())
+		{
+			center = center / (double)points.size();
+		}
+		double radius = 0;
+		for (size_t p = 0; p < points.size(); p++)
+		{
+			radius = std::max(radius, (points[p] - center).norm());
+		}
+
+		fiberLength.push_back((GLsizei)points.size());
+		fiberCenter.push_back(center);
+		fiberRadius.push_back(radius);
+
+		for (int k = 0; k < numLevels; k++)
+		{
+			simplify(points, tolerances[k], kept);
+
+			// a level that drops no further point shares the vertices of the level before
+			if (k > 0 && (GLsizei)kept.size() == levelCounts.back())
+			{
+				levelFirsts.push_back(levelFirsts.back());
+				levelCounts.push_back(levelCounts.back());
+				continue;
+			}
+
+			levelFirsts.push_back((GLint)vertices.size());
+			levelCounts.push_back((GLsizei)kept.size());
+			for (size_t p = 0; p < kept.size(); p++)
+			{
+				Vertex v;
+				for (int j = 0; j < 3; j++)
+				{
+					v.position[j] = (GLfloat)points[kept[p]][j];
+					v.color[j] = colors[3 * f + j];
+				}
+				v.color[3] = 255;
+				vertices.push_back(v);
+			}
+		}
+	}
+
+	if (!vertexBuffer.isCreated())
+	{
+		vertexBuffer.create();
+	}
+	vertexBuffer.bind();
+	vertexBuffer.allocate(vertices.empty() ? NULL : &vertices[0], (int)(vertices.size() * sizeof(Vertex)));
+	vertexBuffer.release();
+	lastUpload = vertices.size() * sizeof(Vertex);
+
+	drawFirsts.reserve(fiberLength.size());
+	drawCounts.reserve(fiberLength.size());
+
+	return true;
+}
+
+void FiberBuffer::simplify(const std::vector<CPoint> & points, double tolerance, std::vector<int> & kept)
+{
+	kept.clear();
+	int n = (int)points.size();
+	if (n <= 2 || tolerance <= 0)
+	{
+		for (int p = 0; p < n; p++)
+		{
+			kept.push_back(p);
+		}
+		return;
+	}
+
+	std::vector<bool> keep(n, false);
+	keep[0] = keep[n - 1] = true;
+
+	// split the spans at their farthest point until every point is within the tolerance of its span
+	std::vector<std::pair<int, int> > spans;
+	spans.push_back(std::pair<int, int>(0, n - 1));
+	while (!spans.empty())
+	{
+		int a = spans.back().first;
+		int b = spans.back().second;
+		spans.pop_back();
+
+		CPoint d = points[b] - points[a];
+		double length = d.norm();
+
+		int farthest = -1;
+		double maxDistance = tolerance;
+		for (int p = a + 1; p < b; p++)
+		{
+			CPoint r = points[p] - points[a];
+			double distance = (length > 0) ? (d ^ r).norm() / length : r.norm();
+			if (distance > maxDistance)
+			{
+				maxDistance = distance;
+				farthest = p;
+			}
+		}
+
+		if (farthest >= 0)
+		{
+			keep[farthest] = true;
+			spans.push_back(std::pair<int, int>(a, farthest));
+			spans.push_back(std::pair<int, int>(farthest, b));
+		}
+	}
+
+	for (int p = 0; p < n; p++)
+	{
+		if (keep[p]) kept.push_back(p);
+	}
+}
+
+GLsizei FiberBuffer::numDrawn(int minLength) const
+{
+	// the lengths are sorted descending
+	std::vector<GLsizei>::const_iterator end = std::lower_bound(fiberLength.begin(), fiberLength.end(), (GLsizei)minLength, [](GLsizei count, GLsizei length) { return count >= length; });
+	return (GLsizei)(end - fiberLength.begin());
+}
+
+void FiberBuffer::draw(int minLength, const GLdouble * modelView, const GLdouble * projection, const GLint * viewport)
+{
+	GLsizei drawn = numDrawn(minLength);
+	if (drawn == 0)
+	{
+		drawnPoints = 0;
+		return;
+	}
+
+	// pixels covered by a unit length at clip w = 1, the projection is column major
+	double pixelScale = projection[5] * viewport[3] / 2.0;
+
+	drawFirsts.clear();
+	drawCounts.clear();
+	drawnPoints = 0;
+	for (GLsizei f = 0; f < drawn; f++)
+	{
+		const CPoint & c = fiberCenter[f];
+		double zEye = modelView[2] * c[0] + modelView[6] * c[1] + modelView[10] * c[2] + modelView[14];
+		double w = projection[11] * zEye + projection[15];
+
+		// the nearest point of the fiber sets the scale, w is the eye distance for a perspective projection
+		w = std::max(fabs(w) - fabs(projection[11]) * fiberRadius[f], 1e-6);
+		double pixelsPerUnit = pixelScale / w;
+
+		int level = 0;
+		while (level + 1 < numLevels && tolerances[level + 1] * pixelsPerUnit < 1.0)
+		{
+			level++;
+		}
+
+		drawFirsts.push_back(levelFirsts[f * numLevels + level]);
+		drawCounts.push_back(levelCounts[f * numLevels + level]);
+		drawnPoints += drawCounts.back();
+	}
+
+	vertexBuffer.bind();
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(3, GL_FLOAT, sizeof(Vertex), (const GLvoid*)offsetof(Vertex, position));
+	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), (const GLvoid*)offsetof(Vertex, color));
+
+	if (multiDrawArrays != NULL)
+	{
+		multiDrawArrays(GL_LINE_STRIP, &drawFirsts[0], &drawCounts[0], drawn);
+	}
+	else
+	{
+		for (GLsizei f = 0; f < drawn; f++)
+		{
+			glDrawArrays(GL_LINE_STRIP, drawFirsts[f], drawCounts[f]);
+		}
+	}
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	vertexBuffer.release();
+}
@@ -0,0 +1,85 @@
+#ifndef FiberBuffer_H
+#define FiberBuffer_H
+
+#include <QGLBuffer>
+#include <QGLContext>
+
+#include <vector>
+
+#include "OpenGLHeader.h"
+#include "ViewerTFiberMesh.h"
+
+using namespace MeshLib;
+
+/*!
+* \brief FiberBuffer, the fibers of a mesh as polylines in one vertex buffer
+* \details The fibers are uploaded once, sorted by their number of points, longest first, each with a random color
+* \details drawn when it is loaded, so the colors do not change between frames or with the filter.
+* \details The fibers shorter than the minimal length are a suffix of the draw list, which is drawn with one multi draw call.
+* \details Every fiber is stored at numLevels resolutions, simplified by Douglas-Peucker with growing tolerances, and each
+* \details frame draws the coarsest level whose tolerance projects to less than a pixel.
+*/
+class FiberBuffer
+{
+public:
+	struct Vertex
+	{
+		GLfloat position[3];
+		GLubyte color[4];
+	};
+
+	FiberBuffer();
+	~FiberBuffer();
+
+	// upload the fibers of the mesh, only the first call does any work
+	bool update(TMeshLib::CVTMesh * mesh);
+
+	// draw the fibers with at least minLength points, at the level of detail of the view
+	void draw(int minLength, const GLdouble * modelView, const GLdouble * projection, const GLint * viewport);
+
+	size_t numFibers() const { return fiberCenter.size(); };
+
+	// number of points drawn by the last frame
+	size_t numDrawnPoints() const { return drawnPoints; };
+
+	// bytes sent to the GPU by the last update
+	size_t uploadedBytes() const { return lastUpload; };
+
+	static const int numLevels = 6;
+
+private:
+	// number of fibers with at least minLength points, they come first in the draw list
+	GLsizei numDrawn(int minLength) const;
+
+	// indices of the points of the polyline kept by Douglas-Peucker with the given tolerance
+	static void simplify(const std::vector<CPoint> & points, double tolerance, std::vector<int> & kept);
+
+	typedef void (APIENTRY * MultiDrawArrays)(GLenum mode, const GLint * first, const GLsizei * count, GLsizei primcount);
+
+	QGLBuffer vertexBuffer;
+
+	// first vertex and number of vertices of every fiber at every level, level 0 is the full fiber
+	std::vector<GLint> levelFirsts;
+	std::vector<GLsizei> levelCounts;
+	// the points of every fiber, sorted descending
+	std::vector<GLsizei> fiberLength;
+	// bounding sphere of every fiber
+	std::vector<CPoint> fiberCenter;
+	std::vector<double> fiberRadius;
+
+	// the tolerance of every level
+	double tolerances[numLevels];
+
+	// the draw list of the current frame
+	std::vector<GLint> drawFirsts;
+	std::vector<GLsizei> drawCounts;
+	size_t drawnPoints;
+
+	size_t lastUpload;
+
+	// glMultiDrawArrays is not part of the OpenGL 1.1 headers, it is looked up in the context
+	MultiDrawArrays multiDrawArrays;
+	bool isLoaded;
+};
+
+#endif
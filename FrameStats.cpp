@@ -0,0 +1,317 @@
+#include "FrameStats.h"
+#include "AllocCounter.h"
+
+#include <math.h>
+#include <string.h>
+#include <fstream>
+#include <algorithm>
+
+
+FrameStats::FrameStats()
+{
+	frames.resize(windowSize);
+	sortedMs.reserve(windowSize);
+	first = 0;
+	count = 0;
+	beginFrame();
+}
+
+void FrameStats::beginFrame()
+{
+	current.ms = 0;
+	current.triangles = 0;
+	current.points = 0;
+	current.lines = 0;
+	current.uploaded = 0;
+	current.allocations = 0;
+	std::fill(currentMeshMs.begin(), currentMeshMs.end(), -1.0);
+	allocationsBefore = AllocCounter::count();
+}
+
+void FrameStats::endFrame(double ms)
+{
+	current.ms = ms;
+	current.allocations = AllocCounter::count() - allocationsBefore;
+
+	// a full ring overwrites its oldest frame
+	size_t slot = (first + count) % windowSize;
+	if (count == windowSize)
+	{
+		first = (first + 1) % windowSize;
+	}
+	else
+	{
+		count++;
+	}
+
+	frames[slot] = current;
+	std::copy(currentMeshMs.begin(), currentMeshMs.end(), meshTimes.begin() + slot * meshLabels.size());
+}
+
+void FrameStats::addMesh(const char * label, double ms)
+{
+	size_t m = 0;
+	while (m < meshLabels.size() && meshLabels[m] != label)
+	{
+		m++;
+	}
+
+	if (m == meshLabels.size())
+	{
+		// a new mesh gets a column, the frames before did not draw it
+		std::vector<double> times(windowSize * (m + 1), -1.0);
+		for (size_t s = 0; s < windowSize; s++)
+		{
+			std::copy(meshTimes.begin() + s * m, meshTimes.begin() + (s + 1) * m, times.begin() + s * (m + 1));
+		}
+		meshTimes.swap(times);
+		meshLabels.push_back(label);
+		currentMeshMs.push_back(-1.0);
+	}
+
+	currentMeshMs[m] = std::max(currentMeshMs[m], 0.0) + ms;
+}
+
+void FrameStats::setOperation(const char * name, double ms, size_t allocations)
+{
+	for (size_t o = 0; o < operations.size(); o++)
+	{
+		if (operations[o].name == name)
+		{
+			operations[o].ms = ms;
+			operations[o].allocations = allocations;
+			return;
+		}
+	}
+
+	Operation operation = { name, ms, allocations };
+	operations.push_back(operation);
+}
+
+void FrameStats::setValue(const char * name, double value)
+{
+	for (size_t v = 0; v < values.size(); v++)
+	{
+		if (values[v].name == name)
+		{
+			values[v].value = value;
+			return;
+		}
+	}
+
+	Value named = { name, value };
+	values.push_back(named);
+}
+
+std::vector<std::string> FrameStats::names() const
+{
+	std::vector<std::string> result;
+	result.push_back("frame_ms");
+	result.push_back("triangles");
+	result.push_back("points");
+	result.push_back("lines");
+	result.push_back("upload_bytes");
+	result.push_back("allocations");
+
+	for (size_t m = 0; m < meshLabels.size(); m++)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			if (meshMs(i, m) >= 0)
+			{
+				result.push_back(meshLabels[m] + "_ms");
+				break;
+			}
+		}
+	}
+	return result;
+}
+
+std::vector<double> FrameStats::series(const std::string & name) const
+{
+	// a mesh only counts in the frames which drew it
+	size_t mesh = std::find(meshLabels.begin(), meshLabels.end(), name.substr(0, name.size() - 3)) - meshLabels.begin();
+
+	std::vector<double> samples;
+	for (size_t i = 0; i < count; i++)
+	{
+		const Frame & f = frame(i);
+		if (name == "frame_ms") samples.push_back(f.ms);
+		else if (name == "triangles") samples.push_back((double)f.triangles);
+		else if (name == "points") samples.push_back((double)f.points);
+		else if (name == "lines") samples.push_back((double)f.lines);
+		else if (name == "upload_bytes") samples.push_back((double)f.uploaded);
+		else if (name == "allocations") samples.push_back((double)f.allocations);
+		else if (mesh < meshLabels.size() && meshMs(i, mesh) >= 0)
+		{
+			samples.push_back(meshMs(i, mesh));
+		}
+	}
+
+	std::sort(samples.begin(), samples.end());
+	return samples;
+}
+
+double FrameStats::percentile(const std::vector<double> & sorted, double p)
+{
+	if (sorted.empty())
+	{
+		return 0;
+	}
+
+	// nearest rank
+	size_t rank = (size_t)ceil(p * sorted.size());
+	return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+}
+
+size_t FrameStats::summary(char lines[][lineLength], size_t maxLines)
+{
+	size_t n = 0;
+	if (count == 0 || maxLines == 0)
+	{
+		return n;
+	}
+
+	const Frame & last = frame(count - 1);
+
+	// the scratch keeps its capacity of windowSize, sorting in place does not allocate
+	sortedMs.clear();
+	for (size_t i = 0; i < count; i++)
+	{
+		sortedMs.push_back(frame(i).ms);
+	}
+	std::sort(sortedMs.begin(), sortedMs.end());
+
+	sprintf(lines[n++], "frame %.2f ms   p50 %.2f  p95 %.2f  p99 %.2f  (%d frames)", last.ms,
+		percentile(sortedMs, 0.5), percentile(sortedMs, 0.95), percentile(sortedMs, 0.99), (int)count);
+
+	if (n < maxLines)
+	{
+		sprintf(lines[n++], "triangles %lu  points %lu  lines %lu  upload %lu bytes",
+			(unsigned long)last.triangles, (unsigned long)last.points, (unsigned long)last.lines, (unsigned long)last.uploaded);
+	}
+
+	if (n < maxLines && AllocCounter::enabled())
+	{
+		sprintf(lines[n++], "allocations %lu", (unsigned long)last.allocations);
+	}
+
+	for (size_t m = 0; m < meshLabels.size() && n < maxLines; m++)
+	{
+		if (meshMs(count - 1, m) >= 0)
+		{
+			sprintf(lines[n++], "%.200s %.2f ms", meshLabels[m].c_str(), meshMs(count - 1, m));
+		}
+	}
+
+	for (size_t o = 0; o < operations.size() && n < maxLines; o++)
+	{
+		if (AllocCounter::enabled())
+		{
+			sprintf(lines[n++], "last %.160s %.1f ms  %lu allocations", operations[o].name.c_str(), operations[o].ms,
+				(unsigned long)operations[o].allocations);
+		}
+		else
+		{
+			sprintf(lines[n++], "last %.200s %.1f ms", operations[o].name.c_str(), operations[o].ms);
+		}
+	}
+
+	for (size_t v = 0; v < values.size() && n < maxLines; v++)
+	{
+		sprintf(lines[n++], "%.200s %.3f", values[v].name.c_str(), values[v].value);
+	}
+
+	return n;
+}
+
+void FrameStats::logLine(char * line, size_t size) const
+{
+	// every part is formatted into a small piece first and only copied while it fits
+	char part[lineLength];
+	size_t length = 0;
+	line[0] = '\0';
+	if (count == 0 || size == 0)
+	{
+		return;
+	}
+
+	const Frame & last = frame(count - 1);
+	sprintf(part, "frame %g ms triangles %lu points %lu lines %lu upload %lu", last.ms, (unsigned long)last.triangles,
+		(unsigned long)last.points, (unsigned long)last.lines, (unsigned long)last.uploaded);
+	appendPart(line, size, length, part);
+
+	if (AllocCounter::enabled())
+	{
+		sprintf(part, " allocations %lu", (unsigned long)last.allocations);
+		appendPart(line, size, length, part);
+	}
+
+	for (size_t m = 0; m < meshLabels.size(); m++)
+	{
+		if (meshMs(count - 1, m) >= 0)
+		{
+			sprintf(part, " %.200s %g ms", meshLabels[m].c_str(), meshMs(count - 1, m));
+			appendPart(line, size, length, part);
+		}
+	}
+}
+
+void FrameStats::appendPart(char * line, size_t size, size_t & length, const char * part)
+{
+	size_t n = strlen(part);
+	if (length + n + 1 > size)
+	{
+		return;
+	}
+	memcpy(line + length, part, n + 1);
+	length += n;
+}
+
+bool FrameStats::writeCSV(const char * filename) const
+{
+	std::fstream _os(filename, std::fstream::out);
+	if (_os.fail())
+	{
+		fprintf(stderr, "Error is opening file %s\n", filename);
+		return false;
+	}
+
+	_os << "quantity,frames,mean,p50,p95,p99,max" << std::endl;
+
+	std::vector<std::string> quantities = names();
+	for (size_t q = 0; q < quantities.size(); q++)
+	{
+		std::vector<double> samples = series(quantities[q]);
+		double sum = 0;
+		for (size_t i = 0; i < samples.size(); i++)
+		{
+			sum += samples[i];
+		}
+
+		_os << quantities[q] << "," << samples.size() << "," << (samples.empty() ? 0 : sum / samples.size()) << ","
+			<< percentile(samples, 0.5) << "," << percentile(samples, 0.95) << "," << percentile(samples, 0.99) << ","
+			<< (samples.empty() ? 0 : samples.back()) << std::endl;
+	}
+
+	// the operations have a single time, it fills every column
+	for (size_t o = 0; o < operations.size(); o++)
+	{
+		double ms = operations[o].ms;
+		_os << operations[o].name << "_ms,1," << ms << "," << ms << "," << ms << "," << ms << "," << ms << std::endl;
+		if (AllocCounter::enabled())
+		{
+			size_t n = operations[o].allocations;
+			_os << operations[o].name << "_allocations,1," << n << "," << n << "," << n << "," << n << "," << n << std::endl;
+		}
+	}
+
+	for (size_t v = 0; v < values.size(); v++)
+	{
+		double value = values[v].value;
+		_os << values[v].name << ",1," << value << "," << value << "," << value << "," << value << "," << value << std::endl;
+	}
+
+	_os.close();
+	return true;
+}
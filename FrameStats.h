@@ -0,0 +1,112 @@
+#ifndef FrameStats_H
+#define FrameStats_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/*!
+* \brief FrameStats, where the time of the viewer goes, frame by frame
+* \details Every frame records the time spent in paintGL in total and per mesh, the triangles, points and
+* \details vertices of lines submitted, the bytes uploaded to the GPU and the heap allocations of the GUI thread. The
+* \details last windowSize frames are kept for the rolling percentiles. Besides the frames, the time and allocations
+* \details of the last load, cut and export are kept by name, and so are a few values describing the last result of an
+* \details operation.
+* \details Recording a frame does not allocate once its meshes and names are known: the frames are a ring of windowSize
+* \details slots and the times of the meshes a table with a column per mesh. Neither does formatting the overlay and the
+* \details log line, they are written into buffers of the caller and the percentiles are sorted in a kept scratch.
+*/
+class FrameStats
+{
+public:
+	FrameStats();
+
+	// start counting a new frame
+	void beginFrame();
+	// close the frame with its total time
+	void endFrame(double ms);
+
+	void addMesh(const char * label, double ms);
+	void addTriangles(size_t n) { current.triangles += n; };
+	void addPoints(size_t n) { current.points += n; };
+	void addLines(size_t n) { current.lines += n; };
+	void addUpload(size_t bytes) { current.uploaded += bytes; };
+
+	void setOperation(const char * name, double ms, size_t allocations);
+	void setValue(const char * name, double value);
+
+	// the room for a line of the overlay, its terminating zero included
+	static const size_t lineLength = 256;
+	// write the lines of the overlay, the last frame and the percentiles of the window, returns their number
+	size_t summary(char lines[][lineLength], size_t maxLines);
+	// write one line per frame for the log stream, cut short at size
+	void logLine(char * line, size_t size) const;
+
+	// p50, p95 and p99 of every quantity over the window, and the time of the operations
+	bool writeCSV(const char * filename) const;
+
+	size_t numFrames() const { return count; };
+	// heap allocations of the last frame, 0 if AllocCounter is not enabled
+	size_t lastAllocations() const { return count == 0 ? 0 : frames[(first + count - 1) % windowSize].allocations; };
+
+	static const size_t windowSize = 1000;
+
+private:
+	struct Frame
+	{
+		double ms;
+		size_t triangles;
+		size_t points;
+		size_t lines;
+		size_t uploaded;
+		size_t allocations;
+	};
+
+	struct Operation
+	{
+		std::string name;
+		double ms;
+		size_t allocations;
+	};
+
+	struct Value
+	{
+		std::string name;
+		double value;
+	};
+
+	// the frame of the window, 0 is the oldest
+	const Frame & frame(size_t i) const { return frames[(first + i) % windowSize]; };
+	// the time of mesh m in frame i of the window, negative if the frame did not draw it
+	double meshMs(size_t i, size_t m) const { return meshTimes[((first + i) % windowSize) * meshLabels.size() + m]; };
+
+	// the values of a quantity over the window, sorted
+	std::vector<double> series(const std::string & name) const;
+	static double percentile(const std::vector<double> & sorted, double p);
+	// copy part to the end of line if it fits in size with the terminating zero
+	static void appendPart(char * line, size_t size, size_t & length, const char * part);
+
+	// the quantities in the order of the CSV, the meshes follow
+	std::vector<std::string> names() const;
+
+	// the frame times sorted for the percentiles of the overlay
+	std::vector<double> sortedMs;
+
+	Frame current;
+	std::vector<double> currentMeshMs;
+	size_t allocationsBefore;
+
+	// ring of windowSize frames, count of them recorded starting at first
+	std::vector<Frame> frames;
+	size_t first;
+	size_t count;
+
+	// the labels of the meshes in order of appearance, and a row of their times for every slot of the ring
+	std::vector<std::string> meshLabels;
+	std::vector<double> meshTimes;
+
+	std::vector<Operation> operations;
+	std::vector<Value> values;
+};
+
+#endif
@@ -0,0 +1,389 @@
+#include "GlyphBuffer.h"
+
+#include <stddef.h>
+#include <math.h>
+#include <algorithm>
+#include <unordered_set>
+
+// the arrow along x from 0 to 1, as line segments
+static const GLfloat arrowTemplate[10][3] = {
+	{ 0.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f },
+	{ 1.0f, 0.0f, 0.0f }, { 0.75f, 0.1f, 0.0f },
+	{ 1.0f, 0.0f, 0.0f }, { 0.75f, -0.1f, 0.0f },
+	{ 1.0f, 0.0f, 0.0f }, { 0.75f, 0.0f, 0.1f },
+	{ 1.0f, 0.0f, 0.0f }, { 0.75f, 0.0f, -0.1f } };
+
+static const char * glyphVertexShader =
+	"#version 120\n"
+	"attribute vec3 corner;\n"
+	"attribute vec3 origin;\n"
+	"attribute vec3 vector;\n"
+	"uniform float unitLength;\n"
+	"uniform float maxMagnitude;\n"
+	"varying vec3 color;\n"
+	"void main()\n"
+	"{\n"
+	"	float m = length(vector);\n"
+	"	vec3 d = vector / max(m, 1e-12);\n"
+	"	vec3 u = normalize(cross(d, abs(d.x) < 0.9 ? vec3(1.0, 0.0, 0.0) : vec3(0.0, 1.0, 0.0)));\n"
+	"	vec3 w = cross(d, u);\n"
+	"	vec3 p = origin + unitLength * m * (corner.x * d + corner.y * u + corner.z * w);\n"
+	"	color = mix(vec3(0.0, 0.3, 1.0), vec3(1.0, 0.1, 0.0), clamp(m / maxMagnitude, 0.0, 1.0));\n"
+	"	gl_Position = gl_ModelViewProjectionMatrix * vec4(p, 1.0);\n"
+	"}\n";
+
+static const char * glyphFragmentShader =
+	"#version 120\n"
+	"varying vec3 color;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_FragColor = vec4(color, 1.0);\n"
+	"}\n";
+
+
+GlyphBuffer::GlyphBuffer() : arrowBuffer(QGLBuffer::VertexBuffer), instanceBuffer(QGLBuffer::VertexBuffer), expandedBuffer(QGLBuffer::VertexBuffer)
+{
+	program = NULL;
+	drawArraysInstanced = NULL;
+	unitLengthLocation = -1;
+	maxMagnitudeLocation = -1;
+	cornerLocation = -1;
+	originLocation = -1;
+	vectorLocation = -1;
+	vertexAttribDivisor = NULL;
+	isInstanced = false;
+
+	maxMagnitude = 1.0;
+	glyphSpacing = 16.0;
+	expandedLevel = -1;
+	expandedVertices = 0;
+	drawnGlyphs = 0;
+	lastUpload = 0;
+	geometryVersion = -1;
+
+	for (int l = 0; l < numLevels; l++)
+	{
+		levelEnd[l] = 0;
+		cellSize[l] = 1.0;
+	}
+}
+
+GlyphBuffer::~GlyphBuffer()
+{
+	delete program;
+	arrowBuffer.destroy();
+	instanceBuffer.destroy();
+	expandedBuffer.destroy();
+}
+
+bool GlyphBuffer::update(TMeshLib::CVTMesh * mesh)
+{
+	lastUpload = 0;
+	if (mesh->geometryVersion() == geometryVersion)
+	{
+		return false;
+	}
+	geometryVersion = mesh->geometryVersion();
+
+	if (!instanceBuffer.isCreated())
+	{
+		isInstanced = initInstancing();
+		instanceBuffer.create();
+		expandedBuffer.create();
+	}
+
+	instances.clear();
+	maxMagnitude = 0;
+	boxMin = CPoint(1e+10, 1e+10, 1e+10);
+	boxMax = CPoint(-1e+10, -1e+10, -1e+10);
+
+	for (TMeshLib::CVTMesh::MeshTetIterator tIter(mesh); !tIter.end(); tIter++)
+	{
+		TMeshLib::CViewerTet * pT = *tIter;
+
+		CPoint vector = pT->vector();
+		if (vector.norm() < 1.0)
+		{
+			continue;
+		}
+
+		CPoint tetCentral(0.0, 0.0, 0.0);
+		for (int j = 0; j < 4; j++)
+		{
+			tetCentral = tetCentral + 0.25 * mesh->TetVertex(pT, j)->position();
+		}
+
+		Instance instance;
+		for (int j = 0; j < 3; j++)
+		{
+			instance.origin[j] = (GLfloat)tetCentral[j];
+			instance.vector[j] = (GLfloat)vector[j];
+			boxMin[j] = std::min(boxMin[j], tetCentral[j]);
+			boxMax[j] = std::max(boxMax[j], tetCentral[j]);
+		}
+		instances.push_back(instance);
+		maxMagnitude = std::max(maxMagnitude, vector.norm());
+	}
+
+	subsample();
+
+	instanceBuffer.bind();
+	instanceBuffer.allocate(instances.empty() ? NULL : &instances[0], (int)(instances.size() * sizeof(Instance)));
+	instanceBuffer.release();
+	lastUpload += instances.size() * sizeof(Instance);
+
+	expandedLevel = -1;
+	return true;
+}
+
+void GlyphBuffer::subsample()
+{
+	size_t n = instances.size();
+
+	std::vector<double> magnitude(n);
+	std::vector<int> byMagnitude(n);
+	for (size_t i = 0; i < n; i++)
+	{
+		const GLfloat * v = instances[i].vector;
+		magnitude[i] = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		byMagnitude[i] = (int)i;
+	}
+	std::sort(byMagnitude.begin(), byMagnitude.end(), [&magnitude](int a, int b) { return magnitude[a] > magnitude[b]; });
+
+	// the level every glyph first appears in, the finest level takes all of them
+	std::vector<int> level(n, numLevels - 1);
+	double extent = std::max(std::max(boxMax[0] - boxMin[0], boxMax[1] - boxMin[1]), boxMax[2] - boxMin[2]);
+	extent = std::max(extent, 1e-12);
+
+	std::unordered_set<long long> taken;
+	for (int l = 0; l < numLevels; l++)
+	{
+		cellSize[l] = extent / (4 << l);
+		if (l == numLevels - 1)
+		{
+			break;
+		}
+
+		taken.clear();
+		for (size_t k = 0; k < n; k++)
+		{
+			// glyphs of coarser levels occupy their cells first, then the largest glyph of every free cell is added
+			int i = byMagnitude[k];
+			long long key = 0;
+			for (int j = 0; j < 3; j++)
+			{
+				key = key * 2097152 + (long long)((instances[i].origin[j] - boxMin[j]) / cellSize[l]);
+			}
+
+			if (level[i] < l)
+			{
+				taken.insert(key);
+			}
+		}
+		for (size_t k = 0; k < n; k++)
+		{
+			int i = byMagnitude[k];
+			if (level[i] < l)
+			{
+				continue;
+			}
+
+			long long key = 0;
+			for (int j = 0; j < 3; j++)
+			{
+				key = key * 2097152 + (long long)((instances[i].origin[j] - boxMin[j]) / cellSize[l]);
+			}
+
+			if (taken.find(key) == taken.end())
+			{
+				taken.insert(key);
+				level[i] = l;
+			}
+		}
+	}
+
+	std::vector<int> order(n);
+	for (size_t i = 0; i < n; i++)
+	{
+		order[i] = (int)i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&level](int a, int b) { return level[a] < level[b]; });
+
+	std::vector<Instance> sorted(n);
+	for (size_t i = 0; i < n; i++)
+	{
+		sorted[i] = instances[order[i]];
+	}
+	instances.swap(sorted);
+
+	for (int l = 0; l < numLevels; l++)
+	{
+		levelEnd[l] = std::upper_bound(order.begin(), order.end(), l, [&level](int value, int i) { return value < level[i]; }) - order.begin();
+	}
+}
+
+bool GlyphBuffer::initInstancing()
+{
+	const QGLContext * context = QGLContext::currentContext();
+
+	drawArraysInstanced = (DrawArraysInstanced)context->getProcAddress("glDrawArraysInstanced");
+	if (drawArraysInstanced == NULL)
+	{
+		drawArraysInstanced = (DrawArraysInstanced)context->getProcAddress("glDrawArraysInstancedARB");
+	}
+	vertexAttribDivisor = (VertexAttribDivisor)context->getProcAddress("glVertexAttribDivisor");
+	if (vertexAttribDivisor == NULL)
+	{
+		vertexAttribDivisor = (VertexAttribDivisor)context->getProcAddress("glVertexAttribDivisorARB");
+	}
+
+	if (drawArraysInstanced == NULL || vertexAttribDivisor == NULL || !QGLShaderProgram::hasOpenGLShaderPrograms())
+	{
+		return false;
+	}
+
+	program = new QGLShaderProgram();
+	if (!program->addShaderFromSourceCode(QGLShader::Vertex, glyphVertexShader) ||
+		!program->addShaderFromSourceCode(QGLShader::Fragment, glyphFragmentShader) ||
+		!program->link())
+	{
+		std::cout << "glyph shader: " << program->log().toStdString() << std::endl;
+		delete program;
+		program = NULL;
+		return false;
+	}
+	unitLengthLocation = program->uniformLocation("unitLength");
+	maxMagnitudeLocation = program->uniformLocation("maxMagnitude");
+	cornerLocation = program->attributeLocation("corner");
+	originLocation = program->attributeLocation("origin");
+	vectorLocation = program->attributeLocation("vector");
+
+	arrowBuffer.create();
+	arrowBuffer.bind();
+	arrowBuffer.allocate(arrowTemplate, sizeof(arrowTemplate));
+	arrowBuffer.release();
+
+	return true;
+}
+
+int GlyphBuffer::chooseLevel(const GLdouble * modelView, const GLdouble * projection, const GLint * viewport) const
+{
+	CPoint c = (boxMin + boxMax) / 2.0;
+	double zEye = modelView[2] * c[0] + modelView[6] * c[1] + modelView[10] * c[2] + modelView[14];
+	double w = std::max(fabs(projection[11] * zEye + projection[15]), 1e-6);
+	double pixelsPerUnit = projection[5] * viewport[3] / 2.0 / w;
+
+	int level = 0;
+	while (level + 1 < numLevels && cellSize[level + 1] * pixelsPerUnit >= glyphSpacing)
+	{
+		level++;
+	}
+	return level;
+}
+
+void GlyphBuffer::draw(const GLdouble * modelView, const GLdouble * projection, const GLint * viewport)
+{
+	drawnGlyphs = 0;
+	if (instances.empty())
+	{
+		return;
+	}
+
+	int level = chooseLevel(modelView, projection, viewport);
+	drawnGlyphs = levelEnd[level];
+	if (isInstanced)
+	{
+		drawInstanced(level);
+	}
+	else
+	{
+		drawExpanded(level);
+	}
+}
+
+void GlyphBuffer::drawInstanced(int level)
+{
+	program->bind();
+	program->setUniformValue(unitLengthLocation, (GLfloat)(0.9 * cellSize[level] / maxMagnitude));
+	program->setUniformValue(maxMagnitudeLocation, (GLfloat)maxMagnitude);
+
+	arrowBuffer.bind();
+	program->enableAttributeArray(cornerLocation);
+	program->setAttributeBuffer(cornerLocation, GL_FLOAT, 0, 3);
+
+	instanceBuffer.bind();
+	program->enableAttributeArray(originLocation);
+	program->enableAttributeArray(vectorLocation);
+	program->setAttributeBuffer(originLocation, GL_FLOAT, offsetof(Instance, origin), 3, sizeof(Instance));
+	program->setAttributeBuffer(vectorLocation, GL_FLOAT, offsetof(Instance, vector), 3, sizeof(Instance));
+	vertexAttribDivisor(originLocation, 1);
+	vertexAttribDivisor(vectorLocation, 1);
+
+	drawArraysInstanced(GL_LINES, 0, 10, (GLsizei)levelEnd[level]);
+
+	vertexAttribDivisor(originLocation, 0);
+	vertexAttribDivisor(vectorLocation, 0);
+	program->disableAttributeArray(cornerLocation);
+	program->disableAttributeArray(originLocation);
+	program->disableAttributeArray(vectorLocation);
+	instanceBuffer.release();
+	program->release();
+}
+
+void GlyphBuffer::drawExpanded(int level)
+{
+	if (level != expandedLevel)
+	{
+		// the same arrows the shader would produce
+		double unitLength = 0.9 * cellSize[level] / maxMagnitude;
+		expanded.resize(levelEnd[level] * 10);
+		for (size_t i = 0; i < levelEnd[level]; i++)
+		{
+			const Instance & instance = instances[i];
+			CPoint origin(instance.origin[0], instance.origin[1], instance.origin[2]);
+			CPoint vector(instance.vector[0], instance.vector[1], instance.vector[2]);
+			double m = vector.norm();
+			CPoint d = vector / m;
+			CPoint u = d ^ (fabs(d[0]) < 0.9 ? CPoint(1, 0, 0) : CPoint(0, 1, 0));
+			u = u / u.norm();
+			CPoint w = d ^ u;
+
+			double t = std::min(m / maxMagnitude, 1.0);
+			GLubyte color[4] = { (GLubyte)(255 * t), (GLubyte)(255 * (0.3 - 0.2 * t)), (GLubyte)(255 * (1.0 - t)), 255 };
+
+			for (int k = 0; k < 10; k++)
+			{
+				const GLfloat * c = arrowTemplate[k];
+				CPoint p = origin + (d * c[0] + u * c[1] + w * c[2]) * (unitLength * m);
+				ExpandedVertex & v = expanded[i * 10 + k];
+				for (int j = 0; j < 3; j++)
+				{
+					v.position[j] = (GLfloat)p[j];
+				}
+				for (int j = 0; j < 4; j++)
+				{
+					v.color[j] = color[j];
+				}
+			}
+		}
+
+		expandedBuffer.bind();
+		expandedBuffer.allocate(expanded.empty() ? NULL : &expanded[0], (int)(expanded.size() * sizeof(ExpandedVertex)));
+		expandedBuffer.release();
+		expandedVertices = expanded.size();
+		lastUpload += expanded.size() * sizeof(ExpandedVertex);
+		expandedLevel = level;
+	}
+
+	expandedBuffer.bind();
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(3, GL_FLOAT, sizeof(ExpandedVertex), (const GLvoid*)offsetof(ExpandedVertex, position));
+	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(ExpandedVertex), (const GLvoid*)offsetof(ExpandedVertex, color));
+
+	glDrawArrays(GL_LINES, 0, (GLsizei)expandedVertices);
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	expandedBuffer.release();
+}
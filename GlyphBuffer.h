@@ -0,0 +1,106 @@
+#ifndef GlyphBuffer_H
+#define GlyphBuffer_H
+
+#include <QGLBuffer>
+#include <QGLContext>
+#include <QGLShaderProgram>
+
+#include <vector>
+
+#include "OpenGLHeader.h"
+#include "ViewerTFiberMesh.h"
+
+using namespace MeshLib;
+
+/*!
+* \brief GlyphBuffer, arrow glyphs of the per-tet vector field of a mesh
+* \details The centroids and vectors are computed once into an instance buffer, and one arrow template is drawn
+* \details per instance. The shader scales the arrow with the magnitude and colors it from blue to red.
+* \details The instances are ordered by subsampling level: level l keeps at most one glyph, the largest, per cell of
+* \details a grid which halves with every level, so a prefix of the buffer is an even subsample. Each frame draws
+* \details the densest level whose cells are still glyphSpacing pixels apart.
+* \details Without instancing the glyphs of the current level are expanded on the CPU, only when the level changes.
+*/
+class GlyphBuffer
+{
+public:
+	struct Instance
+	{
+		GLfloat origin[3];
+		GLfloat vector[3];
+	};
+
+	GlyphBuffer();
+	~GlyphBuffer();
+
+	// compute the glyphs of the mesh, again whenever its geometry version changes
+	bool update(TMeshLib::CVTMesh * mesh);
+
+	void draw(const GLdouble * modelView, const GLdouble * projection, const GLint * viewport);
+
+	size_t numGlyphs() const { return instances.size(); };
+
+	// glyphs drawn by the last frame, each one is five lines
+	size_t numDrawnGlyphs() const { return drawnGlyphs; };
+	// bytes sent to the GPU by the last update and draw
+	size_t uploadedBytes() const { return lastUpload; };
+
+	static const int numLevels = 8;
+
+private:
+	// sort the instances by the level they first appear in
+	void subsample();
+
+	// the densest level whose cells are at least glyphSpacing pixels wide
+	int chooseLevel(const GLdouble * modelView, const GLdouble * projection, const GLint * viewport) const;
+
+	bool initInstancing();
+	void drawInstanced(int level);
+	void drawExpanded(int level);
+
+	typedef void (APIENTRY * DrawArraysInstanced)(GLenum mode, GLint first, GLsizei count, GLsizei primcount);
+	typedef void (APIENTRY * VertexAttribDivisor)(GLuint index, GLuint divisor);
+
+	std::vector<Instance> instances;
+
+	// instances[0, levelEnd[l]) are drawn at level l, whose cells have the width cellSize[l]
+	size_t levelEnd[numLevels];
+	double cellSize[numLevels];
+	double maxMagnitude;
+	CPoint boxMin, boxMax;
+
+	// pixels between the glyphs
+	double glyphSpacing;
+
+	QGLBuffer arrowBuffer;
+	QGLBuffer instanceBuffer;
+	QGLShaderProgram * program;
+
+	DrawArraysInstanced drawArraysInstanced;
+	VertexAttribDivisor vertexAttribDivisor;
+	bool isInstanced;
+	// the uniforms and attributes of the program, looked up once when it is linked
+	int unitLengthLocation;
+	int maxMagnitudeLocation;
+	int cornerLocation;
+	int originLocation;
+	int vectorLocation;
+
+	// the glyphs expanded on the CPU when instancing is not available
+	struct ExpandedVertex
+	{
+		GLfloat position[3];
+		GLubyte color[4];
+	};
+	std::vector<ExpandedVertex> expanded;
+	QGLBuffer expandedBuffer;
+	int expandedLevel;
+	size_t expandedVertices;
+
+	size_t drawnGlyphs;
+	size_t lastUpload;
+
+	int geometryVersion;
+};
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef _MESHLIB_GROUP_COLORS_H_
+#define _MESHLIB_GROUP_COLORS_H_
+
+namespace MeshLib
+{
+	/*!
+	* \brief CGroupColors, the color lookup table of the tet groups and of the selection
+	* \details Groups 0 and 1 are orange, 2 magenta and 3 cyan, the groups after them cycle through a few more colors.
+	* \details The colors are RGBA bytes, they go to glColor4ubv and into the vertex buffers as they are.
+	*/
+	class CGroupColors
+	{
+	public:
+		static const unsigned char * color(int group)
+		{
+			static const unsigned char table[8][4] = {
+				{ 255, 128, 0, 255 }, { 255, 128, 0, 255 }, { 242, 13, 242, 255 }, { 13, 242, 242, 255 },
+				{ 128, 230, 51, 255 }, { 230, 204, 26, 255 }, { 153, 102, 230, 255 }, { 230, 77, 77, 255 } };
+			return table[group < 0 ? 0 : group % 8];
+		};
+
+		static const unsigned char * selected()
+		{
+			static const unsigned char blue[4] = { 0, 128, 255, 255 };
+			return blue;
+		};
+	};
+};
+
+#endif
@@ -0,0 +1,60 @@
+#include "GroupPanel.h"
+
+
+GroupPanel::GroupPanel(QWidget * _parent) : QDialog(_parent)
+{
+	list = new QListWidget();
+
+	QPushButton * showAllButton = new QPushButton(tr("Show All"));
+
+	connect(list, SIGNAL(itemChanged(QListWidgetItem *)), this, SLOT(itemChanged(QListWidgetItem *)));
+	connect(showAllButton, SIGNAL(clicked()), this, SLOT(showAll()));
+
+	QHBoxLayout * controls = new QHBoxLayout();
+	controls->addStretch(1);
+	controls->addWidget(showAllButton);
+
+	QVBoxLayout * layout = new QVBoxLayout();
+	layout->addWidget(list, 1);
+	layout->addLayout(controls);
+	setLayout(layout);
+
+	setWindowTitle(tr("Groups"));
+	resize(240, 320);
+};
+
+GroupPanel::~GroupPanel()
+{
+};
+
+void GroupPanel::setGroups(const std::set<int> & groups, const std::set<int> & hidden)
+{
+	// filling the list must not toggle anything
+	list->blockSignals(true);
+	list->clear();
+	for (std::set<int>::const_iterator gIter = groups.begin(); gIter != groups.end(); gIter++)
+	{
+		const unsigned char * c = CGroupColors::color(*gIter);
+		QPixmap swatch(16, 16);
+		swatch.fill(QColor(c[0], c[1], c[2]));
+
+		QListWidgetItem * item = new QListWidgetItem(QIcon(swatch), tr("Group %1").arg(*gIter), list);
+		item->setData(Qt::UserRole, *gIter);
+		item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+		item->setCheckState(hidden.count(*gIter) ? Qt::Unchecked : Qt::Checked);
+	}
+	list->blockSignals(false);
+};
+
+void GroupPanel::showAll()
+{
+	for (int i = 0; i < list->count(); i++)
+	{
+		list->item(i)->setCheckState(Qt::Checked);
+	}
+};
+
+void GroupPanel::itemChanged(QListWidgetItem * item)
+{
+	emit groupToggled(item->data(Qt::UserRole).toInt(), item->checkState() == Qt::Checked);
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include <QDialog>
+#include <QLayout>
+#include <QListWidget>
+#include <QPushButton>
+#include <QPixmap>
+
+#include <set>
+
+#include "GroupColors.h"
+
+using namespace MeshLib;
+
+/*!
+* \brief GroupPanel, shows or hides the groups of the loaded meshes
+*/
+class GroupPanel :
+	public QDialog
+{
+	Q_OBJECT
+
+public:
+	GroupPanel(QWidget * _parent = 0);
+	~GroupPanel();
+
+	// list the groups, checked unless hidden
+	void setGroups(const std::set<int> & groups, const std::set<int> & hidden);
+
+signals:
+	void groupToggled(int group, bool visible);
+
+public slots:
+	void showAll();
+
+private slots:
+	void itemChanged(QListWidgetItem * item);
+
+private:
+	QListWidget * list;
+};
@@ -0,0 +1,206 @@
+#ifndef _MESHLIB_IMPLICIT_SURFACE_H_
+#define _MESHLIB_IMPLICIT_SURFACE_H_
+
+#include <math.h>
+#include <algorithm>
+
+#include "..\MeshLib\core\Geometry\Point.h"
+#include "..\MeshLib\core\Geometry\plane.h"
+
+namespace MeshLib
+{
+	/*!
+	* \brief CImplicitSurface, the surface a volume is cut along
+	* \details value(p) >= 0 means p is cut away, the same convention as CPlane::side.
+	* \details range() bounds the value over a box, which lets the element tree skip whole subtrees.
+	* \details An inverted surface cuts away the other side.
+	*/
+	class CImplicitSurface
+	{
+	public:
+		CImplicitSurface() { m_inverted = false; };
+		virtual ~CImplicitSurface() {};
+
+		virtual CImplicitSurface * clone() const = 0;
+
+		double value(const CPoint & p) const
+		{
+			double f = _value(p);
+			return m_inverted ? -f : f;
+		};
+
+		// conservative bounds [lo, hi] of value() over the box [boxMin, boxMax]
+		void range(const CPoint & boxMin, const CPoint & boxMax, double & lo, double & hi) const
+		{
+			_range(boxMin, boxMax, lo, hi);
+			if (m_inverted)
+			{
+				double t = lo;
+				lo = -hi;
+				hi = -t;
+			}
+		};
+
+		// true if the surface is the plane p, only planes have an exact cross section
+		virtual bool isPlane(CPlane & p) const { return false; };
+
+		bool & inverted() { return m_inverted; };
+
+	protected:
+		virtual double _value(const CPoint & p) const = 0;
+		virtual void _range(const CPoint & boxMin, const CPoint & boxMax, double & lo, double & hi) const = 0;
+
+		// range of n * p over the box
+		static void _dotRange(const CPoint & n, const CPoint & boxMin, const CPoint & boxMax, double & lo, double & hi)
+		{
+			lo = hi = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				double a = n[k] * boxMin[k];
+				double b = n[k] * boxMax[k];
+				lo += std::min(a, b);
+				hi += std::max(a, b);
+			}
+		};
+
+		bool m_inverted;
+	};
+
+	/*!
+	* \brief CImplicitPlane, n * p - d, the half space above the plane is cut away
+	*/
+	class CImplicitPlane : public CImplicitSurface
+	{
+	public:
+		CImplicitPlane(CPlane & p) { m_normal = p.normal(); m_d = p.d(); };
+
+		CImplicitSurface * clone() const { return new CImplicitPlane(*this); };
+
+		bool isPlane(CPlane & p) const
+		{
+			if (m_inverted)
+			{
+				p = CPlane(CPoint(0, 0, 0) - m_normal, -m_d);
+			}
+			else
+			{
+				p = CPlane(m_normal, m_d);
+			}
+			return true;
+		};
+
+	protected:
+		double _value(const CPoint & p) const { return m_normal * p - m_d; };
+
+		void _range(const CPoint & boxMin, const CPoint & boxMax, double & lo, double & hi) const
+		{
+			_dotRange(m_normal, boxMin, boxMax, lo, hi);
+			lo -= m_d;
+			hi -= m_d;
+		};
+
+		CPoint m_normal;
+		double m_d;
+	};
+
+	/*!
+	* \brief CImplicitSphere, |p - c| - r, everything outside the ball is cut away
+	* \details It also serves the cut around a user picked point.
+	*/
+	class CImplicitSphere : public CImplicitSurface
+	{
+	public:
+		CImplicitSphere(const CPoint & center, double radius) { m_center = center; m_radius = radius; };
+
+		CImplicitSurface * clone() const { return new CImplicitSphere(*this); };
+
+	protected:
+		double _value(const CPoint & p) const { return (p - m_center).norm() - m_radius; };
+
+		void _range(const CPoint & boxMin, const CPoint & boxMax, double & lo, double & hi) const
+		{
+			CPoint nearest, farthest;
+			for (int k = 0; k < 3; k++)
+			{
+				nearest[k] = std::max(boxMin[k], std::min(m_center[k], boxMax[k]));
+				farthest[k] = (m_center[k] - boxMin[k] > boxMax[k] - m_center[k]) ? boxMin[k] : boxMax[k];
+			}
+			lo = (nearest - m_center).norm() - m_radius;
+			hi = (farthest - m_center).norm() - m_radius;
+		};
+
+		CPoint m_center;
+		double m_radius;
+	};
+
+	/*!
+	* \brief CImplicitCylinder, distance to the axis minus r, everything outside the infinite cylinder is cut away
+	*/
+	class CImplicitCylinder : public CImplicitSurface
+	{
+	public:
+		CImplicitCylinder(const CPoint & origin, const CPoint & axis, double radius)
+		{
+			m_origin = origin;
+			m_axis = axis / axis.norm();
+			m_radius = radius;
+		};
+
+		CImplicitSurface * clone() const { return new CImplicitCylinder(*this); };
+
+	protected:
+		double _distance(const CPoint & p) const
+		{
+			CPoint r = p - m_origin;
+			return (r - m_axis * (r * m_axis)).norm();
+		};
+
+		double _value(const CPoint & p) const { return _distance(p) - m_radius; };
+
+		void _range(const CPoint & boxMin, const CPoint & boxMax, double & lo, double & hi) const
+		{
+			// bound the box by its circumscribed ball
+			CPoint center = (boxMin + boxMax) / 2.0;
+			double ballRadius = (boxMax - boxMin).norm() / 2.0;
+			double d = _distance(center);
+			lo = std::max(0.0, d - ballRadius) - m_radius;
+			hi = d + ballRadius - m_radius;
+		};
+
+		CPoint m_origin;
+		CPoint m_axis;
+		double m_radius;
+	};
+
+	/*!
+	* \brief CImplicitSlab, the slab d0 <= n * p <= d1 is kept, everything outside is cut away
+	*/
+	class CImplicitSlab : public CImplicitSurface
+	{
+	public:
+		CImplicitSlab(const CPoint & normal, double d0, double d1) { m_normal = normal; m_d0 = d0; m_d1 = d1; };
+
+		CImplicitSurface * clone() const { return new CImplicitSlab(*this); };
+
+	protected:
+		double _value(const CPoint & p) const
+		{
+			double s = m_normal * p;
+			return std::max(m_d0 - s, s - m_d1);
+		};
+
+		void _range(const CPoint & boxMin, const CPoint & boxMax, double & lo, double & hi) const
+		{
+			double sLo, sHi;
+			_dotRange(m_normal, boxMin, boxMax, sLo, sHi);
+			lo = std::max(m_d0 - sHi, sLo - m_d1);
+			hi = std::max(m_d0 - sLo, sHi - m_d1);
+		};
+
+		CPoint m_normal;
+		double m_d0;
+		double m_d1;
+	};
+};
+
+#endif
@@ -86,6 +86,34 @@ void MainWindow::createActions()
 	exportVisibleMeshAction->setStatusTip(tr("export the visible surface of the tet mesh as a mesh file"));
 	connect(exportVisibleMeshAction, SIGNAL(triggered()), viewer, SLOT(exportVisibleMesh()));
 
+	profileAction = new QAction(tr("&Profile"), this);
+	profileAction->setText(tr("Profile"));
+	profileAction->setStatusTip(tr("Plot the cross section area and the volume along an axis"));
+	connect(profileAction, SIGNAL(triggered()), viewer, SLOT(showProfile()));
+
+	groupsAction = new QAction(tr("&Groups"), this);
+	groupsAction->setText(tr("Groups"));
+	groupsAction->setStatusTip(tr("Show or hide the groups of the meshes"));
+	connect(groupsAction, SIGNAL(triggered()), viewer, SLOT(showGroups()));
+
+	frameTimeAction = new QAction(tr("&Frame Time"), this);
+	frameTimeAction->setText(tr("Frame Time"));
+	frameTimeAction->setStatusTip(tr("Compare the frame time of the immediate mode and the buffered drawing"));
+	connect(frameTimeAction, SIGNAL(triggered()), viewer, SLOT(compareFrameTimes()));
+
+	statsControl = new checkableAction(this);
+	statsControl->setText(tr("Frame Stats"));
+	statsControl->setStatusTip(tr("Show the time and the work of every frame, and log them to the console"));
+	statsControl->setCheckable(true);
+	statsControl->setChecked(false);
+	connect(statsControl, SIGNAL(actionCheck()), viewer, SLOT(statsOn()));
+	connect(statsControl, SIGNAL(actionUncheck()), viewer, SLOT(statsOff()));
+
+	exportStatsAction = new QAction(tr("&Export Stats"), this);
+	exportStatsAction->setText(tr("Export Stats"));
+	exportStatsAction->setStatusTip(tr("Save the p50, p95 and p99 of the frame statistics as a CSV file"));
+	connect(exportStatsAction, SIGNAL(triggered()), viewer, SLOT(exportFrameStats()));
+
 	screenshotAction = new QAction(tr("&Screenshot"), this);
 	screenshotAction->setIcon(QIcon(":/icons/images/screenshot.png"));
 	screenshotAction->setShortcut(QKeySequence(Qt::CTRL + Qt::SHIFT + Qt::Key_4));
@@ -178,6 +206,21 @@ void MainWindow::createActions()
 	viewFlat->setChecked(false);
 	connect(viewFlat, SIGNAL(triggered()), this, SLOT(showFlat()));
 
+	viewSmooth = new QAction(tr("&Smooth"), this);
+	viewSmooth->setIcon(QIcon(":/icons/images/smooth.png"));
+	viewSmooth->setText(tr("Draw Smooth"));
+	viewSmooth->setStatusTip(tr("Smooth"));
+	viewSmooth->setCheckable(true);
+	viewSmooth->setChecked(false);
+	connect(viewSmooth, SIGNAL(triggered()), this, SLOT(showSmooth()));
+
+	viewShrink = new QAction(tr("S&hrink"), this);
+	viewShrink->setText(tr("Shrink"));
+	viewShrink->setStatusTip(tr("Draw the elements shrunk toward their centroids"));
+	viewShrink->setCheckable(true);
+	viewShrink->setChecked(false);
+	connect(viewShrink, SIGNAL(triggered()), this, SLOT(showShrink()));
+
 	viewBoundary = new QAction(tr("&Boundary"), this);
 	viewBoundary->setIcon(QIcon(":/icons/images/boundary.png"));
 	viewBoundary->setText(tr("Draw Boundary Faces"));
@@ -194,6 +237,14 @@ void MainWindow::createActions()
 	viewVector->setChecked(false);
 	connect(viewVector, SIGNAL(triggered()), this, SLOT(showVector()));
 
+	viewSection = new QAction(tr("&Section"), this);
+	viewSection->setIcon(QIcon(":/icons/images/cut.png"));
+	viewSection->setText(tr("Draw Exact Cross Section"));
+	viewSection->setStatusTip(tr("Section"));
+	viewSection->setCheckable(true);
+	viewSection->setChecked(false);
+	connect(viewSection, SIGNAL(triggered()), this, SLOT(showSection()));
+
 	viewTexture = new QAction(tr("&Texture"), this);
 	viewTexture->setIcon(QIcon(":/icons/images/texture.png"));
 	viewTexture->setText(tr("Draw Texture"));
@@ -234,6 +285,42 @@ void MainWindow::createActions()
 	zCut->setChecked(false);
 	connect(zCut, SIGNAL(triggered()), viewer, SLOT(zCut()));
 
+	sphereCut = new QAction(tr("&Sphere"), this);
+	sphereCut->setText(tr("Sphere"));
+	sphereCut->setStatusTip(tr("Keep a Ball around the Center of the Volume"));
+	sphereCut->setCheckable(true);
+	sphereCut->setChecked(false);
+	connect(sphereCut, SIGNAL(triggered()), viewer, SLOT(sphereCut()));
+
+	cylinderCut = new QAction(tr("&Cylinder"), this);
+	cylinderCut->setText(tr("Cylinder"));
+	cylinderCut->setStatusTip(tr("Keep a Cylinder along the Normal of the Cut Plane"));
+	cylinderCut->setCheckable(true);
+	cylinderCut->setChecked(false);
+	connect(cylinderCut, SIGNAL(triggered()), viewer, SLOT(cylinderCut()));
+
+	slabCut = new QAction(tr("S&lab"), this);
+	slabCut->setText(tr("Slab"));
+	slabCut->setStatusTip(tr("Keep a Slab around the Cut Plane"));
+	slabCut->setCheckable(true);
+	slabCut->setChecked(false);
+	connect(slabCut, SIGNAL(triggered()), viewer, SLOT(slabCut()));
+
+	pointCut = new QAction(tr("&Point"), this);
+	pointCut->setText(tr("Point"));
+	pointCut->setStatusTip(tr("Keep a Ball around the Selected Vertex"));
+	pointCut->setCheckable(true);
+	pointCut->setChecked(false);
+	connect(pointCut, SIGNAL(triggered()), viewer, SLOT(pointCut()));
+
+	invertCut = new checkableAction(this);
+	invertCut->setText(tr("Invert"));
+	invertCut->setStatusTip(tr("Cut away the other Side"));
+	invertCut->setCheckable(true);
+	invertCut->setChecked(false);
+	connect(invertCut, SIGNAL(actionCheck()), viewer, SLOT(invertCutOn()));
+	connect(invertCut, SIGNAL(actionUncheck()), viewer, SLOT(invertCutOff()));
+
 	plusMove = new QAction(tr("&+Move"), this);
 	plusMove->setIcon(QIcon(":/icons/images/plus.png"));
 	plusMove->setText(tr("Move the Cut Plane plus 0.5"));
@@ -253,6 +340,11 @@ void MainWindow::createToolbar()
 	fileToolbar->addAction(saveAction);
 	fileToolbar->addAction(exportVisibleMeshAction);
 	fileToolbar->addAction(screenshotAction);
+	fileToolbar->addAction(profileAction);
+	fileToolbar->addAction(groupsAction);
+	fileToolbar->addAction(frameTimeAction);
+	fileToolbar->addAction(statsControl);
+	fileToolbar->addAction(exportStatsAction);
 	
 	editToolbar = addToolBar(tr("&Edit"));
 	editToolbar->addAction(selectAction);
@@ -268,15 +360,23 @@ void MainWindow::createToolbar()
 	viewToolbar->addAction(viewWireframe);
 	viewToolbar->addAction(viewFlatlines);
 	viewToolbar->addAction(viewFlat);
+	viewToolbar->addAction(viewSmooth);
+	viewToolbar->addAction(viewShrink);
 	viewToolbar->addAction(viewBoundary);
 	viewToolbar->addAction(viewTexture);
 	viewToolbar->addAction(viewTextureModulate);
 	viewToolbar->addAction(viewVector);
+	viewToolbar->addAction(viewSection);
 	viewToolbar->addAction(rotationControl);
 	
 	viewToolbar->addAction(xCut);
 	viewToolbar->addAction(yCut);
 	viewToolbar->addAction(zCut);
+	viewToolbar->addAction(sphereCut);
+	viewToolbar->addAction(cylinderCut);
+	viewToolbar->addAction(slabCut);
+	viewToolbar->addAction(pointCut);
+	viewToolbar->addAction(invertCut);
 	viewToolbar->addAction(plusMove);
 	viewToolbar->addAction(minusMove);
 
@@ -286,15 +386,22 @@ void MainWindow::createToolbar()
 	drawModeGroup->addAction(viewWireframe);
 	drawModeGroup->addAction(viewFlatlines);
 	drawModeGroup->addAction(viewFlat);
+	drawModeGroup->addAction(viewSmooth);
+	drawModeGroup->addAction(viewShrink);
 	drawModeGroup->addAction(viewBoundary);
 	drawModeGroup->addAction(viewTexture);
 	drawModeGroup->addAction(viewTextureModulate);
 	drawModeGroup->addAction(viewVector);
+	drawModeGroup->addAction(viewSection);
 
 	cutGroup = new QActionGroup(this);
 	cutGroup->addAction(xCut);
 	cutGroup->addAction(yCut);
 	cutGroup->addAction(zCut);
+	cutGroup->addAction(sphereCut);
+	cutGroup->addAction(cylinderCut);
+	cutGroup->addAction(slabCut);
+	cutGroup->addAction(pointCut);
 }
 
 void MainWindow::showPoints()
@@ -317,6 +424,17 @@ void MainWindow::showFlat()
 	viewer->setDrawMode(DRAW_MODE::FLAT);
 }
 
+void MainWindow::showSmooth()
+{
+	viewer->setDrawMode(DRAW_MODE::SMOOTH);
+}
+
+void MainWindow::showShrink()
+{
+	viewer->setDrawMode(DRAW_MODE::SHRINK);
+	viewer->showShrink();
+}
+
 void MainWindow::showBoundary()
 {
 	viewer->setDrawMode(DRAW_MODE::BOUNDARY);
@@ -337,4 +455,9 @@ void MainWindow::showTextureModulate()
 void MainWindow::showVector()
 {
 	viewer->setDrawMode(DRAW_MODE::VECTOR);
+}
+
+void MainWindow::showSection()
+{
+	viewer->setDrawMode(DRAW_MODE::SECTION);
 }
\ No newline at end of file
@@ -41,10 +41,13 @@ private:
 	QAction * viewWireframe;
 	QAction * viewFlatlines;
 	QAction * viewFlat;
+	QAction * viewSmooth;
+	QAction * viewShrink;
 	QAction * viewTexture;
 	QAction * viewTextureModulate;
 	QAction * viewBoundary;
 	QAction * viewVector;
+	QAction * viewSection;
 
 	QToolBar * fileToolbar;
 	QToolBar * viewToolbar;
@@ -57,11 +60,21 @@ private:
 	QAction * clearSelected;
 	QAction * mergeAction;
 	QAction * mergeSamePointAction;
+	QAction * profileAction;
+	QAction * groupsAction;
+	QAction * frameTimeAction;
+	checkableAction * statsControl;
+	QAction * exportStatsAction;
 
 	QAction * xCut;
 	QAction * yCut;
 	QAction * zCut;
+	QAction * sphereCut;
+	QAction * cylinderCut;
+	QAction * slabCut;
+	QAction * pointCut;
 	QActionGroup * cutGroup;
+	checkableAction * invertCut;
 	
 	QAction * plusMove;
 	QAction * minusMove;
@@ -76,6 +89,10 @@ private slots:
 
 	void showFlat();
 
+	void showSmooth();
+
+	void showShrink();
+
 	void showTexture();
 
 	void showTextureModulate();
@@ -83,6 +100,8 @@ private slots:
 	void showBoundary();
 
 	void showVector();
+
+	void showSection();
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,45 @@
+#ifndef _MESHLIB_MESH_ARRAYS_H_
+#define _MESHLIB_MESH_ARRAYS_H_
+
+#include <vector>
+
+namespace MeshLib
+{
+	/*!
+	* \brief CMeshArrays, contiguous copy of the vertex data and the element connectivity of a volume mesh
+	* \details The halfface data structure keeps its elements in linked lists, which is slow to stream through.
+	* \details Kernels which touch every vertex or element work on these arrays instead, vertices are
+	* \details addressed by their index(), which is the position in the arrays.
+	*/
+	class CMeshArrays
+	{
+	public:
+		CMeshArrays() { m_verticesPerElement = 0; };
+		~CMeshArrays() {};
+
+		void clear()
+		{
+			m_x.clear(); m_y.clear(); m_z.clear();
+			m_u.clear(); m_v.clear();
+			m_elements.clear();
+			m_groups.clear();
+		};
+
+		size_t numVertices() const { return m_x.size(); };
+		size_t numElements() const { return m_verticesPerElement == 0 ? 0 : m_elements.size() / m_verticesPerElement; };
+
+		//!< vertex positions, structure of arrays
+		std::vector<double> m_x, m_y, m_z;
+		//!< vertex texture coordinates
+		std::vector<double> m_u, m_v;
+
+		//!< m_verticesPerElement vertex indices per element, in the order of TetVertex/HexVertex
+		std::vector<int> m_elements;
+		//!< group of every element
+		std::vector<int> m_groups;
+		//!< 4 for tets, 8 for hexes
+		int m_verticesPerElement;
+	};
+};
+
+#endif
@@ -0,0 +1,99 @@
+#include "PointBuffer.h"
+
+
+PointBuffer::PointBuffer() : vertexBuffer(QGLBuffer::VertexBuffer), indexBuffer(QGLBuffer::IndexBuffer)
+{
+	points = 0;
+	lastUpload = 0;
+	geometryVersion = -1;
+	selectionVersion = -1;
+
+	vertexBuffer.setUsagePattern(QGLBuffer::StaticDraw);
+	indexBuffer.setUsagePattern(QGLBuffer::DynamicDraw);
+}
+
+PointBuffer::~PointBuffer()
+{
+	vertexBuffer.destroy();
+	indexBuffer.destroy();
+}
+
+bool PointBuffer::update(TMeshLib::CVTMesh * mesh)
+{
+	return update<TMeshLib::CVTMesh>(mesh);
+}
+
+bool PointBuffer::update(HMeshLib::CVHMesh * mesh)
+{
+	return update<HMeshLib::CVHMesh>(mesh);
+}
+
+void PointBuffer::uploadPositions(const CMeshArrays & arrays)
+{
+	if (!vertexBuffer.isCreated())
+	{
+		vertexBuffer.create();
+		indexBuffer.create();
+	}
+
+	points = arrays.numVertices();
+	positions.resize(3 * points);
+	for (size_t v = 0; v < points; v++)
+	{
+		positions[3 * v] = (GLfloat)arrays.m_x[v];
+		positions[3 * v + 1] = (GLfloat)arrays.m_y[v];
+		positions[3 * v + 2] = (GLfloat)arrays.m_z[v];
+	}
+
+	vertexBuffer.bind();
+	vertexBuffer.allocate(positions.empty() ? NULL : &positions[0], (int)(positions.size() * sizeof(GLfloat)));
+	vertexBuffer.release();
+	lastUpload += positions.size() * sizeof(GLfloat);
+
+	// the copy on the GPU is all that is needed
+	std::vector<GLfloat>().swap(positions);
+}
+
+void PointBuffer::uploadSelection()
+{
+	indexBuffer.bind();
+	indexBuffer.allocate(selected.empty() ? NULL : &selected[0], (int)(selected.size() * sizeof(GLuint)));
+	indexBuffer.release();
+	lastUpload += selected.size() * sizeof(GLuint);
+}
+
+void PointBuffer::drawPoints()
+{
+	if (points == 0)
+	{
+		return;
+	}
+
+	vertexBuffer.bind();
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 0, 0);
+
+	glDrawArrays(GL_POINTS, 0, (GLsizei)points);
+
+	glDisableClientState(GL_VERTEX_ARRAY);
+	vertexBuffer.release();
+}
+
+void PointBuffer::drawSelected()
+{
+	if (selected.empty())
+	{
+		return;
+	}
+
+	vertexBuffer.bind();
+	indexBuffer.bind();
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 0, 0);
+
+	glDrawElements(GL_POINTS, (GLsizei)selected.size(), GL_UNSIGNED_INT, 0);
+
+	glDisableClientState(GL_VERTEX_ARRAY);
+	indexBuffer.release();
+	vertexBuffer.release();
+}
@@ -0,0 +1,93 @@
+#ifndef PointBuffer_H
+#define PointBuffer_H
+
+#include <QGLBuffer>
+
+#include <vector>
+
+#include "OpenGLHeader.h"
+#include "ViewerTFiberMesh.h"
+#include "ViewerHMesh.h"
+
+using namespace MeshLib;
+
+/*!
+* \brief PointBuffer, the vertices of a mesh on the GPU, in the order of the mesh arrays
+* \details All points are drawn with one call, the selected ones with a second call through
+* \details a small index list, which is only rebuilt when the selection version of the mesh changes.
+*/
+class PointBuffer
+{
+public:
+	PointBuffer();
+	~PointBuffer();
+
+	// bring the buffers up to date with the mesh, returns true if anything was uploaded
+	bool update(TMeshLib::CVTMesh * mesh);
+	bool update(HMeshLib::CVHMesh * mesh);
+
+	// draw all points, or only the selected ones, in the current color
+	void drawPoints();
+	void drawSelected();
+
+	size_t numPoints() const { return points; };
+	size_t numSelected() const { return selected.size(); };
+
+	// bytes sent to the GPU by the last update
+	size_t uploadedBytes() const { return lastUpload; };
+
+private:
+	template<typename M>
+	bool update(M * mesh);
+
+	void uploadPositions(const CMeshArrays & arrays);
+	void uploadSelection();
+
+	QGLBuffer vertexBuffer;
+	QGLBuffer indexBuffer;
+
+	size_t points;
+	std::vector<GLfloat> positions;
+	std::vector<GLuint> selected;
+
+	size_t lastUpload;
+
+	// versions of the mesh the buffers were built from
+	int geometryVersion;
+	int selectionVersion;
+};
+
+template<typename M>
+bool PointBuffer::update(M * mesh)
+{
+	bool uploaded = false;
+	lastUpload = 0;
+
+	if (mesh->geometryVersion() != geometryVersion || !vertexBuffer.isCreated())
+	{
+		uploadPositions(mesh->m_arrays);
+		geometryVersion = mesh->geometryVersion();
+		// the indices refer to the arrays, which may have been renumbered
+		selectionVersion = mesh->selectionVersion() - 1;
+		uploaded = true;
+	}
+
+	if (mesh->selectionVersion() != selectionVersion)
+	{
+		selected.clear();
+		for (typename M::MeshVertexIterator vIter(mesh); !vIter.end(); vIter++)
+		{
+			if ((*vIter)->selected() && (*vIter)->index() >= 0 && (size_t)(*vIter)->index() < points)
+			{
+				selected.push_back((GLuint)(*vIter)->index());
+			}
+		}
+		uploadSelection();
+		selectionVersion = mesh->selectionVersion();
+		uploaded = true;
+	}
+
+	return uploaded;
+};
+
+#endif
@@ -0,0 +1,314 @@
+#ifndef _MESHLIB_PROFILE_H_
+#define _MESHLIB_PROFILE_H_
+
+#include <math.h>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include "..\MeshLib\core\Geometry\Point.h"
+
+#include "MeshArrays.h"
+
+namespace MeshLib
+{
+	/*!
+	* \brief CProfile, cross section area and volume below the plane, sampled along an axis
+	* \details The plane n * p = m_offsets[i] with n = m_axis cuts the part with area m_area[g][i] out of group m_groups[g],
+	* \details and m_volume[g][i] is the volume of the group below that plane.
+	*/
+	class CProfile
+	{
+	public:
+		void clear()
+		{
+			m_offsets.clear();
+			m_groups.clear();
+			m_area.clear();
+			m_volume.clear();
+		};
+
+		// sum over all groups
+		double area(size_t i) const
+		{
+			double a = 0;
+			for (size_t g = 0; g < m_groups.size(); g++) a += m_area[g][i];
+			return a;
+		};
+
+		double volume(size_t i) const
+		{
+			double v = 0;
+			for (size_t g = 0; g < m_groups.size(); g++) v += m_volume[g][i];
+			return v;
+		};
+
+		CPoint m_axis;
+		std::vector<double> m_offsets;
+
+		std::vector<int> m_groups;
+		std::vector<std::vector<double> > m_area;
+		std::vector<std::vector<double> > m_volume;
+	};
+
+	/*!
+	* \brief CProfileSweep, computes a CProfile of a mesh in a single sweep
+	* \details The area of the section of a tet is a quadratic polynomial of the offset between consecutive vertex heights,
+	* \details and the volume below is its integral. Every tet emits the changes of these polynomials at its four
+	* \details heights as events, hexes are split into six tets. After sorting the events, one sweep over the samples
+	* \details accumulates the polynomials, so the whole profile takes O(n log n) instead of a cut per sample.
+	*/
+	class CProfileSweep
+	{
+	public:
+		/*!
+		* Sample the profile at samples offsets evenly spaced in [offsetMin, offsetMax]
+		*/
+		void sweep(const CMeshArrays & arrays, const CPoint & axis, double offsetMin, double offsetMax, int samples, CProfile & profile);
+
+		// extend [offsetMin, offsetMax] to the offsets of all vertices along the unit axis
+		static void range(const CMeshArrays & arrays, const CPoint & axis, double & offsetMin, double & offsetMax)
+		{
+			for (size_t v = 0; v < arrays.numVertices(); v++)
+			{
+				double s = axis[0] * arrays.m_x[v] + axis[1] * arrays.m_y[v] + axis[2] * arrays.m_z[v];
+				offsetMin = std::min(offsetMin, s);
+				offsetMax = std::max(offsetMax, s);
+			}
+		};
+
+	protected:
+		// a change of the area and volume polynomials of one group, in the normalized offset u
+		struct CEvent
+		{
+			double m_u;
+			int m_group;
+			double m_area[3];
+			double m_volume[4];
+
+			bool operator<(const CEvent & other) const { return m_u < other.m_u; };
+		};
+
+		void _addTet(const CPoint * p, int group);
+
+		// exact area of the section of the tet with the plane at height h, heights sorted ascending
+		double _sectionArea(const CPoint * p, const double * heights, double h);
+
+		// offset s = m_center + m_scale * u, so the polynomials stay well conditioned
+		double _u(double s) const { return (s - m_center) / m_scale; };
+
+		CPoint m_axis;
+		double m_center;
+		double m_scale;
+
+		std::vector<CEvent> m_events;
+	};
+
+	inline void CProfileSweep::sweep(const CMeshArrays & arrays, const CPoint & axis, double offsetMin, double offsetMax, int samples, CProfile & profile)
+	{
+		static const int hexTets[6][4] = { { 0, 1, 2, 6 }, { 0, 2, 3, 6 }, { 0, 3, 7, 6 }, { 0, 7, 4, 6 }, { 0, 4, 5, 6 }, { 0, 5, 1, 6 } };
+
+		profile.clear();
+		m_events.clear();
+
+		m_axis = axis / axis.norm();
+		m_center = (offsetMin + offsetMax) / 2.0;
+		m_scale = std::max((offsetMax - offsetMin) / 2.0, 1e-12);
+
+		profile.m_axis = m_axis;
+		for (int i = 0; i < samples; i++)
+		{
+			profile.m_offsets.push_back(samples > 1 ? offsetMin + (offsetMax - offsetMin) * i / (samples - 1) : offsetMin);
+		}
+
+		// groups in ascending order
+		std::map<int, int> groupIndex;
+		for (size_t e = 0; e < arrays.numElements(); e++)
+		{
+			groupIndex[arrays.m_groups[e]] = 0;
+		}
+		for (std::map<int, int>::iterator gIter = groupIndex.begin(); gIter != groupIndex.end(); gIter++)
+		{
+			gIter->second = (int)profile.m_groups.size();
+			profile.m_groups.push_back(gIter->first);
+		}
+
+		int nv = arrays.m_verticesPerElement;
+		for (size_t e = 0; e < arrays.numElements(); e++)
+		{
+			const int * ev = &arrays.m_elements[e * nv];
+			int group = groupIndex[arrays.m_groups[e]];
+
+			CPoint p[8];
+			for (int k = 0; k < nv; k++)
+			{
+				p[k] = CPoint(arrays.m_x[ev[k]], arrays.m_y[ev[k]], arrays.m_z[ev[k]]);
+			}
+
+			if (nv == 4)
+			{
+				_addTet(p, group);
+			}
+			else
+			{
+				for (int t = 0; t < 6; t++)
+				{
+					CPoint q[4] = { p[hexTets[t][0]], p[hexTets[t][1]], p[hexTets[t][2]], p[hexTets[t][3]] };
+					_addTet(q, group);
+				}
+			}
+		}
+
+		std::sort(m_events.begin(), m_events.end());
+
+		// the polynomials of every group, valid between the last applied event and the next one
+		size_t nGroups = profile.m_groups.size();
+		std::vector<double> area(3 * nGroups, 0.0);
+		std::vector<double> volume(4 * nGroups, 0.0);
+
+		profile.m_area.assign(nGroups, std::vector<double>(samples, 0.0));
+		profile.m_volume.assign(nGroups, std::vector<double>(samples, 0.0));
+
+		size_t next = 0;
+		for (int i = 0; i < samples; i++)
+		{
+			double u = _u(profile.m_offsets[i]);
+
+			while (next < m_events.size() && m_events[next].m_u <= u)
+			{
+				CEvent & event = m_events[next++];
+				for (int k = 0; k < 3; k++) area[3 * event.m_group + k] += event.m_area[k];
+				for (int k = 0; k < 4; k++) volume[4 * event.m_group + k] += event.m_volume[k];
+			}
+
+			for (size_t g = 0; g < nGroups; g++)
+			{
+				const double * a = &area[3 * g];
+				const double * v = &volume[4 * g];
+				// the sums of the cancelling polynomials of finished tets leave a tiny residue
+				profile.m_area[g][i] = std::max(0.0, a[0] + u * (a[1] + u * a[2]));
+				profile.m_volume[g][i] = std::max(0.0, v[0] + u * (v[1] + u * (v[2] + u * v[3])));
+			}
+		}
+	};
+
+	inline double CProfileSweep::_sectionArea(const CPoint * p, const double * heights, double h)
+	{
+		// vertices below the plane first
+		int below[4], above[4];
+		int nBelow = 0, nAbove = 0;
+		for (int k = 0; k < 4; k++)
+		{
+			if (heights[k] < h) below[nBelow++] = k;
+			else above[nAbove++] = k;
+		}
+
+		if (nBelow == 0 || nAbove == 0)
+		{
+			return 0.0;
+		}
+
+		CPoint q[4];
+		int n = 0;
+		// the corners in cyclic order: for two vertices below (a, b) and above (c, d), ac ad bd bc
+		for (int i = 0; i < nBelow; i++)
+		{
+			for (int j = 0; j < nAbove; j++)
+			{
+				int a = below[i];
+				int b = above[(nBelow == 2 && i == 1) ? 1 - j : j];
+				double t = (h - heights[a]) / (heights[b] - heights[a]);
+				q[n++] = p[a] + (p[b] - p[a]) * t;
+			}
+		}
+
+		if (n == 3)
+		{
+			return ((q[1] - q[0]) ^ (q[2] - q[0])).norm() / 2.0;
+		}
+		return ((q[2] - q[0]) ^ (q[3] - q[1])).norm() / 2.0;
+	};
+
+	inline void CProfileSweep::_addTet(const CPoint * p, int group)
+	{
+		double heights[4];
+		for (int k = 0; k < 4; k++)
+		{
+			heights[k] = m_axis * p[k];
+		}
+
+		double tetVolume = fabs(((p[1] - p[0]) ^ (p[2] - p[0])) * (p[3] - p[0])) / 6.0;
+		if (tetVolume == 0)
+		{
+			return;
+		}
+
+		double sorted[4] = { heights[0], heights[1], heights[2], heights[3] };
+		std::sort(sorted, sorted + 4);
+
+		// polynomials of the interval before the current height, in u
+		double lastArea[3] = { 0, 0, 0 };
+		double lastVolume[4] = { 0, 0, 0, 0 };
+		double volumeBelow = 0;
+
+		for (int k = 0; k < 4; k++)
+		{
+			double curArea[3] = { 0, 0, 0 };
+			double curVolume[4] = { volumeBelow, 0, 0, 0 };
+
+			if (k == 3)
+			{
+				curVolume[0] = tetVolume;
+			}
+			else if (sorted[k + 1] > sorted[k])
+			{
+				// the area is exactly quadratic inside the interval, fit it through three interior samples
+				double s0 = sorted[k], s1 = sorted[k + 1];
+				double u0 = _u(s0), u1 = _u(s1);
+				double x[3], y[3];
+				for (int j = 0; j < 3; j++)
+				{
+					x[j] = u0 + (u1 - u0) * (j + 1) / 4.0;
+					y[j] = _sectionArea(p, heights, s0 + (s1 - s0) * (j + 1) / 4.0);
+				}
+
+				// Newton form, then expanded into a + b u + c u^2
+				double d01 = (y[1] - y[0]) / (x[1] - x[0]);
+				double d12 = (y[2] - y[1]) / (x[2] - x[1]);
+				double c = (d12 - d01) / (x[2] - x[0]);
+				double b = d01 - c * (x[0] + x[1]);
+				double a = y[0] - b * x[0] - c * x[0] * x[0];
+				curArea[0] = a;
+				curArea[1] = b;
+				curArea[2] = c;
+
+				// volume = volumeBelow + m_scale * (F(u) - F(u0)), F the antiderivative of the area
+				double F0 = u0 * (a + u0 * (b / 2.0 + u0 * c / 3.0));
+				curVolume[0] = volumeBelow - m_scale * F0;
+				curVolume[1] = m_scale * a;
+				curVolume[2] = m_scale * b / 2.0;
+				curVolume[3] = m_scale * c / 3.0;
+
+				double F1 = u1 * (a + u1 * (b / 2.0 + u1 * c / 3.0));
+				volumeBelow += m_scale * (F1 - F0);
+			}
+			else
+			{
+				// an empty interval, nothing changes
+				continue;
+			}
+
+			CEvent event;
+			event.m_u = _u(sorted[k]);
+			event.m_group = group;
+			for (int j = 0; j < 3; j++) event.m_area[j] = curArea[j] - lastArea[j];
+			for (int j = 0; j < 4; j++) event.m_volume[j] = curVolume[j] - lastVolume[j];
+			m_events.push_back(event);
+
+			for (int j = 0; j < 3; j++) lastArea[j] = curArea[j];
+			for (int j = 0; j < 4; j++) lastVolume[j] = curVolume[j];
+		}
+	};
+};
+
+#endif
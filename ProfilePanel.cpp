@@ -0,0 +1,204 @@
+#include "ProfilePanel.h"
+
+#include <fstream>
+
+
+ProfilePlot::ProfilePlot(QWidget * _parent) : QWidget(_parent)
+{
+	profiles = NULL;
+	setMinimumSize(360, 320);
+	setAutoFillBackground(true);
+	setBackgroundRole(QPalette::Base);
+};
+
+void ProfilePlot::paintEvent(QPaintEvent * e)
+{
+	QPainter painter(this);
+	painter.setRenderHint(QPainter::Antialiasing);
+
+	if (profiles == NULL || profiles->empty() || profiles->front().m_offsets.empty())
+	{
+		painter.drawText(rect(), Qt::AlignCenter, tr("No profile, load a volume and press Compute"));
+		return;
+	}
+
+	int h = height() / 2;
+	drawCurves(painter, QRect(0, 0, width(), h), false);
+	drawCurves(painter, QRect(0, h, width(), height() - h), true);
+};
+
+void ProfilePlot::drawCurves(QPainter & painter, QRect rect, bool isVolume)
+{
+	const int margin = 40;
+	QRect area = rect.adjusted(margin, margin / 2, -margin / 2, -margin);
+
+	std::vector<double> & offsets = profiles->front().m_offsets;
+	double sMin = offsets.front();
+	double sMax = offsets.back();
+
+	// the curves of a mesh are the total and, if there are several, its groups
+	double yMax = 0;
+	for (size_t m = 0; m < profiles->size(); m++)
+	{
+		CProfile & profile = (*profiles)[m];
+		for (size_t i = 0; i < profile.m_offsets.size(); i++)
+		{
+			yMax = std::max(yMax, isVolume ? profile.volume(i) : profile.area(i));
+		}
+	}
+	if (yMax <= 0)
+	{
+		yMax = 1;
+	}
+
+	painter.setPen(Qt::black);
+	painter.drawRect(area);
+	painter.drawText(rect.adjusted(margin, 0, 0, 0), Qt::AlignTop | Qt::AlignLeft, isVolume ? tr("Volume below") : tr("Cross section area"));
+	painter.drawText(area.left() - margin, area.top(), margin - 4, 20, Qt::AlignRight, QString::number(yMax, 'g', 3));
+	painter.drawText(area.left() - margin, area.bottom() - 20, margin - 4, 20, Qt::AlignRight, "0");
+	painter.drawText(area.left(), area.bottom() + 4, 80, 20, Qt::AlignLeft, QString::number(sMin, 'g', 3));
+	painter.drawText(area.right() - 80, area.bottom() + 4, 80, 20, Qt::AlignRight, QString::number(sMax, 'g', 3));
+
+	double sRange = (sMax > sMin) ? sMax - sMin : 1.0;
+
+	for (size_t m = 0; m < profiles->size(); m++)
+	{
+		CProfile & profile = (*profiles)[m];
+		size_t nGroups = profile.m_groups.size();
+
+		// -1 is the total of the mesh
+		for (int g = (nGroups > 1) ? -1 : 0; g < (int)nGroups; g++)
+		{
+			QColor color = Qt::black;
+			if (g >= 0)
+			{
+				const unsigned char * c = CGroupColors::color(profile.m_groups[g]);
+				color = QColor(c[0], c[1], c[2]);
+			}
+
+			// the meshes are told apart by the line style
+			QPen pen(color);
+			pen.setStyle((Qt::PenStyle)(Qt::SolidLine + m % 5));
+			painter.setPen(pen);
+
+			QPolygonF curve;
+			for (size_t i = 0; i < profile.m_offsets.size(); i++)
+			{
+				double y;
+				if (g < 0)
+				{
+					y = isVolume ? profile.volume(i) : profile.area(i);
+				}
+				else
+				{
+					y = isVolume ? profile.m_volume[g][i] : profile.m_area[g][i];
+				}
+				curve << QPointF(area.left() + area.width() * (profile.m_offsets[i] - sMin) / sRange, area.bottom() - area.height() * y / yMax);
+			}
+			painter.drawPolyline(curve);
+		}
+	}
+};
+
+
+ProfilePanel::ProfilePanel(QWidget * _parent) : QDialog(_parent)
+{
+	plot = new ProfilePlot();
+
+	axisBox = new QComboBox();
+	axisBox->addItem(tr("X"));
+	axisBox->addItem(tr("Y"));
+	axisBox->addItem(tr("Z"));
+	axisBox->addItem(tr("Cut Plane Normal"));
+
+	samplesBox = new QSpinBox();
+	samplesBox->setRange(2, 100000);
+	samplesBox->setValue(256);
+
+	QPushButton * computeButton = new QPushButton(tr("Compute"));
+	QPushButton * exportButton = new QPushButton(tr("Export CSV"));
+
+	connect(computeButton, SIGNAL(clicked()), this, SLOT(compute()));
+	connect(exportButton, SIGNAL(clicked()), this, SLOT(exportCSV()));
+
+	QHBoxLayout * controls = new QHBoxLayout();
+	controls->addWidget(new QLabel(tr("Axis:")));
+	controls->addWidget(axisBox);
+	controls->addWidget(new QLabel(tr("Samples:")));
+	controls->addWidget(samplesBox);
+	controls->addStretch(1);
+	controls->addWidget(computeButton);
+	controls->addWidget(exportButton);
+
+	QVBoxLayout * layout = new QVBoxLayout();
+	layout->addLayout(controls);
+	layout->addWidget(plot, 1);
+	setLayout(layout);
+
+	setWindowTitle(tr("Area and Volume Profile"));
+	resize(640, 560);
+};
+
+ProfilePanel::~ProfilePanel()
+{
+};
+
+void ProfilePanel::compute()
+{
+	emit computeRequested(axisBox->currentIndex(), samplesBox->value());
+};
+
+void ProfilePanel::exportCSV()
+{
+	if (meshProfiles.empty() || meshProfiles.front().m_offsets.empty())
+	{
+		QMessageBox::warning(this, tr("Export CSV"), tr("Compute the profile first"));
+		return;
+	}
+
+	QString filename = QFileDialog::getSaveFileName(this, tr("Export Profile"), tr("profile.csv"), tr("CSV Files (*.csv)"));
+	if (filename.isEmpty())
+	{
+		return;
+	}
+
+	std::fstream _os(filename.toStdString().c_str(), std::fstream::out);
+	if (_os.fail())
+	{
+		fprintf(stderr, "Error is opening file %s\n", filename.toStdString().c_str());
+		return;
+	}
+
+	// all meshes are sampled at the same offsets
+	_os << "offset";
+	for (size_t m = 0; m < meshProfiles.size(); m++)
+	{
+		CProfile & profile = meshProfiles[m];
+		_os << ",mesh" << m << "_area,mesh" << m << "_volume";
+		for (size_t g = 0; g < profile.m_groups.size(); g++)
+		{
+			_os << ",mesh" << m << "_group" << profile.m_groups[g] << "_area";
+			_os << ",mesh" << m << "_group" << profile.m_groups[g] << "_volume";
+		}
+	}
+	_os << std::endl;
+
+	_os.precision(10);
+	std::vector<double> & offsets = meshProfiles.front().m_offsets;
+	for (size_t i = 0; i < offsets.size(); i++)
+	{
+		_os << offsets[i];
+		for (size_t m = 0; m < meshProfiles.size(); m++)
+		{
+			CProfile & profile = meshProfiles[m];
+			_os << "," << profile.area(i) << "," << profile.volume(i);
+			for (size_t g = 0; g < profile.m_groups.size(); g++)
+			{
+				_os << "," << profile.m_area[g][i] << "," << profile.m_volume[g][i];
+			}
+		}
+		_os << std::endl;
+	}
+
+	_os.close();
+};
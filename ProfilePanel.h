@@ -0,0 +1,74 @@
+#pragma once
+#include <QDialog>
+#include <QLayout>
+#include <QComboBox>
+#include <QSpinBox>
+#include <QLabel>
+#include <QPushButton>
+#include <QPainter>
+#include <QFileDialog>
+#include <QMessageBox>
+
+#include <vector>
+#include <iostream>
+
+#include "Profile.h"
+#include "GroupColors.h"
+
+using namespace MeshLib;
+
+/*!
+* \brief ProfilePlot, draws the area and the volume curves of the profiles above each other
+*/
+class ProfilePlot :
+	public QWidget
+{
+public:
+	ProfilePlot(QWidget * _parent = 0);
+
+	void setProfiles(std::vector<CProfile> * profiles) { this->profiles = profiles; update(); };
+
+protected:
+	void paintEvent(QPaintEvent * e);
+
+private:
+	// draw one of the quantities into rect, volume if isVolume
+	void drawCurves(QPainter & painter, QRect rect, bool isVolume);
+
+	std::vector<CProfile> * profiles;
+};
+
+/*!
+* \brief ProfilePanel, cross section area and volume of every mesh and group along an axis
+*/
+class ProfilePanel :
+	public QDialog
+{
+	Q_OBJECT
+
+public:
+	ProfilePanel(QWidget * _parent = 0);
+	~ProfilePanel();
+
+	// axis index of the combo box, the cut plane normal is the last one
+	enum { AXIS_X, AXIS_Y, AXIS_Z, AXIS_CUT };
+
+	std::vector<CProfile> & profiles() { return meshProfiles; };
+
+	// redraw after the profiles changed
+	void updatePlot() { plot->setProfiles(&meshProfiles); };
+
+signals:
+	void computeRequested(int axis, int samples);
+
+public slots:
+	void compute();
+	void exportCSV();
+
+private:
+	ProfilePlot * plot;
+	QComboBox * axisBox;
+	QSpinBox * samplesBox;
+
+	std::vector<CProfile> meshProfiles;
+};
@@ -0,0 +1,99 @@
+#include "ProxyBuffer.h"
+
+#include <stddef.h>
+
+#include "GroupColors.h"
+
+
+ProxyBuffer::ProxyBuffer() : vertexBuffer(QGLBuffer::VertexBuffer), indexBuffer(QGLBuffer::IndexBuffer)
+{
+	triangles = 0;
+	lastUpload = 0;
+	cutVersion = -1;
+	geometryVersion = -1;
+
+	vertexBuffer.setUsagePattern(QGLBuffer::StaticDraw);
+	indexBuffer.setUsagePattern(QGLBuffer::StaticDraw);
+}
+
+ProxyBuffer::~ProxyBuffer()
+{
+	vertexBuffer.destroy();
+	indexBuffer.destroy();
+}
+
+bool ProxyBuffer::update(TMeshLib::CVTMesh * mesh)
+{
+	return update<TMeshLib::CVTMesh>(mesh);
+}
+
+bool ProxyBuffer::update(HMeshLib::CVHMesh * mesh)
+{
+	return update<HMeshLib::CVHMesh>(mesh);
+}
+
+void ProxyBuffer::upload(const CSurfaceProxy & proxy)
+{
+	if (!vertexBuffer.isCreated())
+	{
+		vertexBuffer.create();
+		indexBuffer.create();
+	}
+
+	vertices.resize(proxy.numVertices());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		// the colors of the groups as in the full surface, the selection is not shown
+		const GLubyte * c = CGroupColors::color(proxy.m_groups[i]);
+		for (int j = 0; j < 3; j++)
+		{
+			vertices[i].position[j] = proxy.m_positions[3 * i + j];
+			vertices[i].normal[j] = proxy.m_normals[3 * i + j];
+		}
+		for (int j = 0; j < 4; j++)
+		{
+			vertices[i].color[j] = c[j];
+		}
+	}
+
+	triangles = proxy.numTriangles();
+
+	vertexBuffer.bind();
+	vertexBuffer.allocate(vertices.empty() ? NULL : &vertices[0], (int)(vertices.size() * sizeof(Vertex)));
+	vertexBuffer.release();
+
+	indexBuffer.bind();
+	indexBuffer.allocate(proxy.m_triangles.empty() ? NULL : &proxy.m_triangles[0], (int)(proxy.m_triangles.size() * sizeof(int)));
+	indexBuffer.release();
+
+	lastUpload = vertices.size() * sizeof(Vertex) + proxy.m_triangles.size() * sizeof(int);
+}
+
+void ProxyBuffer::draw()
+{
+	if (triangles == 0)
+	{
+		return;
+	}
+
+	vertexBuffer.bind();
+	indexBuffer.bind();
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+
+	// the pointers are offsets into the bound vertex buffer
+	glVertexPointer(3, GL_FLOAT, sizeof(Vertex), (const GLvoid*)offsetof(Vertex, position));
+	glNormalPointer(GL_FLOAT, sizeof(Vertex), (const GLvoid*)offsetof(Vertex, normal));
+	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), (const GLvoid*)offsetof(Vertex, color));
+
+	glDrawElements(GL_TRIANGLES, (GLsizei)(3 * triangles), GL_UNSIGNED_INT, 0);
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	indexBuffer.release();
+	vertexBuffer.release();
+}
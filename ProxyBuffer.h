@@ -0,0 +1,84 @@
+#ifndef ProxyBuffer_H
+#define ProxyBuffer_H
+
+#include <QGLBuffer>
+
+#include <vector>
+
+#include "OpenGLHeader.h"
+#include "ViewerTFiberMesh.h"
+#include "ViewerHMesh.h"
+
+using namespace MeshLib;
+
+/*!
+* \brief ProxyBuffer, the coarse proxy of the visible surface of a mesh on the GPU
+* \details The proxy is built by the cut worker after every cut, the buffer uploads it once it is swapped in.
+* \details It is drawn instead of the full surface while the view is rotated or translated.
+*/
+class ProxyBuffer
+{
+public:
+	struct Vertex
+	{
+		GLfloat position[3];
+		GLfloat normal[3];
+		GLubyte color[4];
+	};
+
+	ProxyBuffer();
+	~ProxyBuffer();
+
+	// upload the proxy of the mesh if it changed, returns true if the proxy matches the current surface
+	bool update(TMeshLib::CVTMesh * mesh);
+	bool update(HMeshLib::CVHMesh * mesh);
+
+	// draw the proxy with the current fixed function state
+	void draw();
+
+	size_t numTriangles() const { return triangles; };
+
+	// bytes sent to the GPU by the last update
+	size_t uploadedBytes() const { return lastUpload; };
+
+private:
+	template<typename M>
+	bool update(M * mesh);
+
+	void upload(const CSurfaceProxy & proxy);
+
+	QGLBuffer vertexBuffer;
+	QGLBuffer indexBuffer;
+
+	// the interleaved vertices of the last upload, kept so the next one does not allocate
+	std::vector<Vertex> vertices;
+
+	size_t triangles;
+	size_t lastUpload;
+
+	// versions of the surface the uploaded proxy was built from
+	int cutVersion;
+	int geometryVersion;
+};
+
+template<typename M>
+bool ProxyBuffer::update(M * mesh)
+{
+	CSurfaceProxy & proxy = mesh->m_proxy;
+	lastUpload = 0;
+	if (proxy.m_cutVersion != mesh->cutVersion() || proxy.m_geometryVersion != mesh->geometryVersion() || proxy.numTriangles() == 0)
+	{
+		return false;
+	}
+
+	if (proxy.m_cutVersion != cutVersion || proxy.m_geometryVersion != geometryVersion || !vertexBuffer.isCreated())
+	{
+		upload(proxy);
+		cutVersion = proxy.m_cutVersion;
+		geometryVersion = proxy.m_geometryVersion;
+	}
+
+	return true;
+};
+
+#endif
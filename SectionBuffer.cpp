@@ -0,0 +1,124 @@
+#include "SectionBuffer.h"
+
+#include <algorithm>
+
+#include "GroupColors.h"
+
+
+SectionBuffer::SectionBuffer() : vertexBuffer(QGLBuffer::VertexBuffer)
+{
+	drawnTriangles = 0;
+	lastUpload = 0;
+	cutVersion = -1;
+
+	vertexBuffer.setUsagePattern(QGLBuffer::DynamicDraw);
+}
+
+SectionBuffer::~SectionBuffer()
+{
+	vertexBuffer.destroy();
+}
+
+bool SectionBuffer::update(TMeshLib::CVTMesh * mesh)
+{
+	return update(mesh->m_section, mesh->cutVersion());
+}
+
+bool SectionBuffer::update(HMeshLib::CVHMesh * mesh)
+{
+	return update(mesh->m_section, mesh->cutVersion());
+}
+
+bool SectionBuffer::update(const CCrossSection & section, int version)
+{
+	lastUpload = 0;
+	if (version == cutVersion && vertexBuffer.isCreated())
+	{
+		return false;
+	}
+
+	if (!vertexBuffer.isCreated())
+	{
+		vertexBuffer.create();
+	}
+
+	// the polygons of a group next to each other, in their order within the group
+	order.clear();
+	for (size_t f = 0; f < section.numPolygons(); f++)
+	{
+		order.push_back(std::pair<int, int>(section.m_polygonGroup[f], (int)f));
+	}
+	std::sort(order.begin(), order.end());
+
+	vertices.clear();
+	runs.clear();
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		int group = order[i].first;
+		int f = order[i].second;
+		if (runs.empty() || runs.back().group != group)
+		{
+			Run run = { group, (GLint)(vertices.size() / 5), 0 };
+			runs.push_back(run);
+		}
+
+		// the polygons are convex, split them into fans
+		int first = section.m_polygonStart[f];
+		for (int k = first + 1; k + 1 < section.m_polygonStart[f + 1]; k++)
+		{
+			int corners[3] = { first, k, k + 1 };
+			for (int c = 0; c < 3; c++)
+			{
+				const CSectionPoint & sp = section.m_points[corners[c]];
+				vertices.push_back((GLfloat)sp.m_position[0]);
+				vertices.push_back((GLfloat)sp.m_position[1]);
+				vertices.push_back((GLfloat)sp.m_position[2]);
+				vertices.push_back((GLfloat)sp.m_uv[0]);
+				vertices.push_back((GLfloat)sp.m_uv[1]);
+			}
+			runs.back().count += 3;
+		}
+	}
+	normal = section.m_normal;
+
+	vertexBuffer.bind();
+	vertexBuffer.allocate(vertices.empty() ? NULL : &vertices[0], (int)(vertices.size() * sizeof(GLfloat)));
+	vertexBuffer.release();
+	lastUpload = vertices.size() * sizeof(GLfloat);
+
+	cutVersion = version;
+	return true;
+}
+
+void SectionBuffer::draw(const std::set<int> & hiddenGroups)
+{
+	drawnTriangles = 0;
+	if (vertices.empty())
+	{
+		return;
+	}
+
+	vertexBuffer.bind();
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 5 * sizeof(GLfloat), 0);
+	glTexCoordPointer(2, GL_FLOAT, 5 * sizeof(GLfloat), (const GLvoid *)(3 * sizeof(GLfloat)));
+	glNormal3d(normal[0], normal[1], normal[2]);
+
+	for (size_t r = 0; r < runs.size(); r++)
+	{
+		if (hiddenGroups.count(runs[r].group) != 0)
+		{
+			continue;
+		}
+
+		// the section takes the color of the group of its element, like the faces around it
+		glColor4ubv(CGroupColors::color(runs[r].group));
+		glDrawArrays(GL_TRIANGLES, runs[r].first, runs[r].count);
+		drawnTriangles += runs[r].count / 3;
+	}
+
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	vertexBuffer.release();
+}
@@ -0,0 +1,64 @@
+#ifndef SectionBuffer_H
+#define SectionBuffer_H
+
+#include <QGLBuffer>
+
+#include <set>
+#include <vector>
+
+#include "OpenGLHeader.h"
+#include "ViewerTFiberMesh.h"
+#include "ViewerHMesh.h"
+
+using namespace MeshLib;
+
+/*!
+* \brief SectionBuffer, the triangulated cross section of a mesh on the GPU
+* \details The polygons are split into fans and uploaded once per cut, sorted by group, so every group is one
+* \details glDrawArrays call and hidden groups are skipped without an upload.
+*/
+class SectionBuffer
+{
+public:
+	SectionBuffer();
+	~SectionBuffer();
+
+	// bring the buffer up to date with the section of the mesh, returns true if it was uploaded
+	bool update(TMeshLib::CVTMesh * mesh);
+	bool update(HMeshLib::CVHMesh * mesh);
+
+	// draw the triangles of the visible groups in the colors of their groups
+	void draw(const std::set<int> & hiddenGroups);
+
+	// triangles drawn by the last draw
+	size_t numDrawnTriangles() const { return drawnTriangles; };
+	// bytes sent to the GPU by the last update
+	size_t uploadedBytes() const { return lastUpload; };
+
+private:
+	bool update(const CCrossSection & section, int version);
+
+	// the triangles of one group, vertices [first, first + count) of the buffer
+	struct Run
+	{
+		int group;
+		GLint first;
+		GLsizei count;
+	};
+
+	QGLBuffer vertexBuffer;
+
+	// x y z u v of every corner, kept to reuse its memory on the next cut
+	std::vector<GLfloat> vertices;
+	std::vector<std::pair<int, int> > order;
+	std::vector<Run> runs;
+	CPoint normal;
+
+	size_t drawnTriangles;
+	size_t lastUpload;
+
+	// the cut version of the mesh the buffer was built from
+	int cutVersion;
+};
+
+#endif
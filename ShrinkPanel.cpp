@@ -0,0 +1,41 @@
+#include "ShrinkPanel.h"
+
+
+ShrinkPanel::ShrinkPanel(QWidget * _parent) : QDialog(_parent)
+{
+	slider = new QSlider(Qt::Horizontal);
+	slider->setRange(10, 100);
+	slider->setValue(80);
+
+	valueLabel = new QLabel(tr("80%"));
+	valueLabel->setMinimumWidth(40);
+
+	connect(slider, SIGNAL(valueChanged(int)), this, SLOT(valueChanged(int)));
+
+	QHBoxLayout * layout = new QHBoxLayout();
+	layout->addWidget(new QLabel(tr("Element size")));
+	layout->addWidget(slider, 1);
+	layout->addWidget(valueLabel);
+	setLayout(layout);
+
+	setWindowTitle(tr("Shrink Elements"));
+	resize(320, 60);
+};
+
+ShrinkPanel::~ShrinkPanel()
+{
+};
+
+void ShrinkPanel::setShrink(double factor)
+{
+	slider->blockSignals(true);
+	slider->setValue((int)(factor * 100.0 + 0.5));
+	slider->blockSignals(false);
+	valueLabel->setText(tr("%1%").arg(slider->value()));
+};
+
+void ShrinkPanel::valueChanged(int percent)
+{
+	valueLabel->setText(tr("%1%").arg(percent));
+	emit shrinkChanged(percent / 100.0);
+};
@@ -0,0 +1,31 @@
+#pragma once
+#include <QDialog>
+#include <QLayout>
+#include <QSlider>
+#include <QLabel>
+
+/*!
+* \brief ShrinkPanel, sets the factor the elements are shrunk by toward their centroids
+*/
+class ShrinkPanel :
+	public QDialog
+{
+	Q_OBJECT
+
+public:
+	ShrinkPanel(QWidget * _parent = 0);
+	~ShrinkPanel();
+
+	// show the factor, the fraction of the size the elements keep, without emitting shrinkChanged
+	void setShrink(double factor);
+
+signals:
+	void shrinkChanged(double factor);
+
+private slots:
+	void valueChanged(int percent);
+
+private:
+	QSlider * slider;
+	QLabel * valueLabel;
+};
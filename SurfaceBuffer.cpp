@@ -0,0 +1,1271 @@
+#include "SurfaceBuffer.h"
+
+#include <stddef.h>
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+#include <iostream>
+
+// the section plane clips through gl_ClipVertex, the color is the lit material of GL_COLOR_MATERIAL, the normal is
+// only bound for smooth shading and the centroid only when shrunk, a shrink of 1 leaves the vertex where it is
+static const char * surfaceVertexShader =
+	"#version 120\n"
+	"uniform float shrink;\n"
+	"attribute vec3 centroid;\n"
+	"varying vec3 eyePosition;\n"
+	"varying vec3 normal;\n"
+	"varying vec4 color;\n"
+	"void main()\n"
+	"{\n"
+	"	vec4 v = gl_Vertex;\n"
+	"	if (shrink < 1.0) v.xyz = centroid + shrink * (v.xyz - centroid);\n"
+	"	vec4 p = gl_ModelViewMatrix * v;\n"
+	"	eyePosition = p.xyz;\n"
+	"	normal = gl_NormalMatrix * gl_Normal;\n"
+	"	color = gl_Color;\n"
+	"	gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+	"	gl_ClipVertex = p;\n"
+	"	gl_Position = gl_ProjectionMatrix * p;\n"
+	"}\n";
+
+// the face normal is the cross product of the derivatives of the eye position, or the interpolated vertex normal when
+// smooth, the lights are those of the viewer, directional and diffuse only, and the texture is applied after the
+// lighting as with GL_REPLACE or GL_MODULATE
+static const char * surfaceFragmentShader =
+	"#version 120\n"
+	"uniform bool isLit;\n"
+	"uniform bool isSmooth;\n"
+	"uniform int textureMode;\n"
+	"uniform sampler2D image;\n"
+	"varying vec3 eyePosition;\n"
+	"varying vec3 normal;\n"
+	"varying vec4 color;\n"
+	"void main()\n"
+	"{\n"
+	"	vec4 c = color;\n"
+	"	if (isLit)\n"
+	"	{\n"
+	"		vec3 n = isSmooth ? normalize(normal) : normalize(cross(dFdx(eyePosition), dFdy(eyePosition)));\n"
+	"		if (dot(n, eyePosition) > 0.0) n = -n;\n"
+	"		vec3 light = gl_LightModel.ambient.rgb;\n"
+	"		for (int i = 1; i <= 3; i++)\n"
+	"		{\n"
+	"			light += gl_LightSource[i].diffuse.rgb * max(dot(n, normalize(gl_LightSource[i].position.xyz)), 0.0);\n"
+	"		}\n"
+	"		c.rgb = clamp(c.rgb * light, 0.0, 1.0);\n"
+	"	}\n"
+	"	if (textureMode == 1) c.rgb = texture2D(image, gl_TexCoord[0].st).rgb;\n"
+	"	else if (textureMode == 2) c.rgb *= texture2D(image, gl_TexCoord[0].st).rgb;\n"
+	"	gl_FragColor = c;\n"
+	"}\n";
+
+
+SurfaceBuffer::SurfaceBuffer() : vertexBuffer(QGLBuffer::VertexBuffer), indexBuffer(QGLBuffer::IndexBuffer), lineBuffer(QGLBuffer::VertexBuffer), normalBuffer(QGLBuffer::VertexBuffer), centroidBuffer(QGLBuffer::VertexBuffer), lineCentroidBuffer(QGLBuffer::VertexBuffer)
+{
+	program = NULL;
+	isShaded = false;
+	isSmooth = false;
+	isShrunk = false;
+	shrinkFactor = 1;
+	centroidLocation = -1;
+	isLitLocation = -1;
+	isSmoothLocation = -1;
+	shrinkLocation = -1;
+	textureModeLocation = -1;
+	hiddenGroups = NULL;
+	stamp = 0;
+	lastUpload = 0;
+	drawnCells = 0;
+	drawnTriangles = 0;
+	drawnEdges = 0;
+	cellWidth = 1;
+	dims[0] = dims[1] = dims[2] = 1;
+	multiDrawElements = NULL;
+	multiDrawArrays = NULL;
+	cornersPerFace = 3;
+	indicesPerFace = 3;
+	cutVersion = -1;
+	geometryVersion = -1;
+	selectionVersion = -1;
+
+	vertexBuffer.setUsagePattern(QGLBuffer::DynamicDraw);
+	indexBuffer.setUsagePattern(QGLBuffer::DynamicDraw);
+	lineBuffer.setUsagePattern(QGLBuffer::DynamicDraw);
+	normalBuffer.setUsagePattern(QGLBuffer::DynamicDraw);
+	centroidBuffer.setUsagePattern(QGLBuffer::DynamicDraw);
+	lineCentroidBuffer.setUsagePattern(QGLBuffer::DynamicDraw);
+}
+
+SurfaceBuffer::~SurfaceBuffer()
+{
+	delete program;
+	vertexBuffer.destroy();
+	indexBuffer.destroy();
+	lineBuffer.destroy();
+	normalBuffer.destroy();
+	centroidBuffer.destroy();
+	lineCentroidBuffer.destroy();
+}
+
+bool SurfaceBuffer::initShading()
+{
+	if (!QGLShaderProgram::hasOpenGLShaderPrograms())
+	{
+		return false;
+	}
+
+	program = new QGLShaderProgram();
+	if (!program->addShaderFromSourceCode(QGLShader::Vertex, surfaceVertexShader) ||
+		!program->addShaderFromSourceCode(QGLShader::Fragment, surfaceFragmentShader) ||
+		!program->link())
+	{
+		std::cout << "surface shader: " << program->log().toStdString() << std::endl;
+		delete program;
+		program = NULL;
+		return false;
+	}
+	centroidLocation = program->attributeLocation("centroid");
+	isLitLocation = program->uniformLocation("isLit");
+	isSmoothLocation = program->uniformLocation("isSmooth");
+	shrinkLocation = program->uniformLocation("shrink");
+	textureModeLocation = program->uniformLocation("textureMode");
+
+	// the texture is always the one bound to the first unit
+	program->bind();
+	program->setUniformValue(program->uniformLocation("image"), (GLint)0);
+	program->release();
+	return true;
+}
+
+bool SurfaceBuffer::update(TMeshLib::CVTMesh * mesh, std::vector<TMeshLib::CViewerHalfFace*> & halffaces)
+{
+	lastUpload = 0;
+	if (mesh->cutVersion() == cutVersion && mesh->geometryVersion() == geometryVersion && mesh->selectionVersion() == selectionVersion)
+	{
+		return false;
+	}
+
+	if (!vertexBuffer.isCreated())
+	{
+		// the first update decides between the shader and the fixed function normals
+		isShaded = initShading();
+	}
+
+	if (mesh->geometryVersion() != geometryVersion || !vertexBuffer.isCreated())
+	{
+		rebuild(mesh, halffaces, 3);
+	}
+	else
+	{
+		if (mesh->cutVersion() != cutVersion)
+		{
+			patch(mesh, halffaces);
+		}
+		// only the tets have selected faces, their colors are written in place
+		if (mesh->selectionVersion() != selectionVersion)
+		{
+			recolor(mesh, mesh->m_selectedHalfFaces);
+		}
+	}
+
+	cutVersion = mesh->cutVersion();
+	geometryVersion = mesh->geometryVersion();
+	selectionVersion = mesh->selectionVersion();
+	return true;
+}
+
+bool SurfaceBuffer::update(HMeshLib::CVHMesh * mesh, std::vector<HMeshLib::CHViewerHalfFace*> & halffaces)
+{
+	lastUpload = 0;
+	if (mesh->cutVersion() == cutVersion && mesh->geometryVersion() == geometryVersion)
+	{
+		return false;
+	}
+
+	if (!vertexBuffer.isCreated())
+	{
+		// the first update decides between the shader and the fixed function normals
+		isShaded = initShading();
+	}
+
+	if (mesh->geometryVersion() != geometryVersion || !vertexBuffer.isCreated())
+	{
+		rebuild(mesh, halffaces, 4);
+	}
+	else
+	{
+		patch(mesh, halffaces);
+	}
+
+	cutVersion = mesh->cutVersion();
+	geometryVersion = mesh->geometryVersion();
+	return true;
+}
+
+void SurfaceBuffer::setSmooth(bool smooth)
+{
+	if (smooth != isSmooth)
+	{
+		// the normals of all slots change, the next update rebuilds
+		isSmooth = smooth;
+		geometryVersion = -1;
+	}
+}
+
+void SurfaceBuffer::setShrunk(bool shrunk)
+{
+	if (shrunk != isShrunk)
+	{
+		// the centroids are only kept while shrunk, the next update rebuilds
+		isShrunk = shrunk;
+		geometryVersion = -1;
+	}
+}
+
+void SurfaceBuffer::setShrinkFactor(double factor)
+{
+	if ((GLfloat)factor != shrinkFactor)
+	{
+		shrinkFactor = (GLfloat)factor;
+		if (isShrunk && !isShaded)
+		{
+			// the fixed function fallback moved the corners on the CPU, the next update rebuilds
+			geometryVersion = -1;
+		}
+	}
+}
+
+const GLubyte * SurfaceBuffer::faceColor(TMeshLib::CVTMesh * mesh, TMeshLib::CViewerHalfFace * pHF)
+{
+	if (mesh->HalfFaceFace(pHF)->selected())
+	{
+		return CGroupColors::selected();
+	}
+	return CGroupColors::color(mesh->HalfFaceTet(pHF)->group());
+}
+
+const GLubyte * SurfaceBuffer::faceColor(HMeshLib::CVHMesh * mesh, HMeshLib::CHViewerHalfFace * pHF)
+{
+	if (mesh->HalfFaceFace(pHF)->selected())
+	{
+		return CGroupColors::selected();
+	}
+	return CGroupColors::color(0);
+}
+
+void SurfaceBuffer::setupCentroids(const CMeshArrays & arrays)
+{
+	int n = arrays.m_verticesPerElement;
+	int numElements = (int)arrays.numElements();
+	elementCentroids.resize(numElements * 3);
+
+#pragma omp parallel for if (numElements > 4096)
+	for (int e = 0; e < numElements; e++)
+	{
+		double c[3] = { 0, 0, 0 };
+		for (int k = 0; k < n; k++)
+		{
+			int v = arrays.m_elements[e * n + k];
+			c[0] += arrays.m_x[v];
+			c[1] += arrays.m_y[v];
+			c[2] += arrays.m_z[v];
+		}
+		for (int j = 0; j < 3; j++)
+		{
+			elementCentroids[3 * e + j] = (GLfloat)(c[j] / n);
+		}
+	}
+}
+
+void SurfaceBuffer::setupGrid(const CMeshArrays & arrays, size_t targetFaces)
+{
+	CPoint lo(0, 0, 0), hi(0, 0, 0);
+	for (size_t v = 0; v < arrays.numVertices(); v++)
+	{
+		CPoint p(arrays.m_x[v], arrays.m_y[v], arrays.m_z[v]);
+		for (int j = 0; j < 3; j++)
+		{
+			lo[j] = (v == 0 || p[j] < lo[j]) ? p[j] : lo[j];
+			hi[j] = (v == 0 || p[j] > hi[j]) ? p[j] : hi[j];
+		}
+	}
+
+	// the cuts expose faces of the interior, count them with the elements
+	size_t faces = std::max(targetFaces, arrays.numElements() / 8);
+	double cells = (double)std::min(std::max(faces / 1024, (size_t)1), (size_t)4096);
+
+	// flat meshes still get cells of a sensible size
+	CPoint extent = hi - lo;
+	double diagonal = std::max(extent.norm(), 1e-9);
+	double volume = 1;
+	for (int j = 0; j < 3; j++)
+	{
+		extent[j] = std::max(extent[j], diagonal * 1e-3);
+		volume *= extent[j];
+	}
+
+	cellWidth = pow(volume / cells, 1.0 / 3.0);
+	for (int j = 0; j < 3; j++)
+	{
+		dims[j] = std::max(1, (int)ceil(extent[j] / cellWidth));
+		// center the grid on the box
+		lo[j] -= (dims[j] * cellWidth - (hi[j] - lo[j])) / 2.0;
+	}
+	gridMin = lo;
+
+	std::set<int> present(arrays.m_groups.begin(), arrays.m_groups.end());
+	groups.assign(present.begin(), present.end());
+	if (groups.empty())
+	{
+		groups.push_back(0);
+	}
+	groupIndex.clear();
+	for (size_t i = 0; i < groups.size(); i++)
+	{
+		groupIndex[groups[i]] = (int)i;
+	}
+}
+
+int SurfaceBuffer::cellKey(int gridIndex, int group) const
+{
+	std::unordered_map<int, int>::const_iterator gIter = groupIndex.find(group);
+	return gridIndex * (int)groups.size() + (gIter == groupIndex.end() ? 0 : gIter->second);
+}
+
+int SurfaceBuffer::pointCell(const CPoint & p) const
+{
+	int c[3];
+	for (int j = 0; j < 3; j++)
+	{
+		c[j] = (int)floor((p[j] - gridMin[j]) / cellWidth);
+		c[j] = std::min(std::max(c[j], 0), dims[j] - 1);
+	}
+	return (c[2] * dims[1] + c[1]) * dims[0] + c[0];
+}
+
+void SurfaceBuffer::layoutCells(const CMeshArrays & arrays, const std::vector<int> & faceCells)
+{
+	// a cell for every group in every grid cell
+	size_t nGrid = (size_t)dims[0] * dims[1] * dims[2] * groups.size();
+
+	std::vector<int> faceCount(nGrid, 0);
+	for (size_t f = 0; f < faceCells.size(); f++)
+	{
+		faceCount[faceCells[f]]++;
+	}
+
+	std::vector<int> elementCount(nGrid, 0);
+	int nv = arrays.m_verticesPerElement;
+	for (size_t e = 0; e < arrays.numElements(); e++)
+	{
+		const int * ev = &arrays.m_elements[e * nv];
+		CPoint center(0, 0, 0);
+		for (int k = 0; k < nv; k++)
+		{
+			center = center + CPoint(arrays.m_x[ev[k]], arrays.m_y[ev[k]], arrays.m_z[ev[k]]);
+		}
+		elementCount[cellKey(pointCell(center / (double)nv), arrays.m_groups[e])]++;
+	}
+
+	// a plane through n elements exposes about n^(2/3) of their faces, a few planes are allowed before a rebuild
+	std::vector<int> capacity(nGrid, 0);
+	std::vector<int> cells;
+	for (size_t g = 0; g < nGrid; g++)
+	{
+		if (faceCount[g] == 0 && elementCount[g] == 0)
+		{
+			continue;
+		}
+		capacity[g] = faceCount[g] + faceCount[g] / 4 + (int)(4.0 * pow((double)elementCount[g], 2.0 / 3.0)) + 16;
+		cells.push_back((int)g);
+	}
+
+	gridCell.assign(nGrid, -1);
+	cellStart.clear();
+	cellCapacity.clear();
+	nodes.clear();
+
+	if (!cells.empty())
+	{
+		buildTree(cells, capacity, 0, (int)cells.size());
+	}
+
+	size_t nCells = cellStart.size();
+	cellFree.resize(nCells);
+	cellMin.assign(nCells, CPoint(DBL_MAX, DBL_MAX, DBL_MAX));
+	cellMax.assign(nCells, CPoint(-DBL_MAX, -DBL_MAX, -DBL_MAX));
+	cellDirty.assign(nCells, true);
+
+	cellGroup.resize(nCells);
+	for (size_t g = 0; g < nGrid; g++)
+	{
+		if (gridCell[g] >= 0)
+		{
+			cellGroup[gridCell[g]] = groups[g % groups.size()];
+		}
+	}
+}
+
+void SurfaceBuffer::layoutEdgeCells(const std::vector<int> & edgeCount)
+{
+	// a face entering with a cut brings about cornersPerFace / 2 new edges
+	edgeCellStart.clear();
+	edgeCellCapacity.clear();
+	for (size_t c = 0; c < edgeCount.size(); c++)
+	{
+		edgeCellStart.push_back(edgeCellStart.empty() ? 0 : edgeCellStart.back() + edgeCellCapacity.back());
+		edgeCellCapacity.push_back(edgeCount[c] + edgeCount[c] / 4 + cellCapacity[c] * cornersPerFace / 4 + 16);
+	}
+	edgeCellFree.resize(edgeCount.size());
+}
+
+int SurfaceBuffer::buildTree(std::vector<int> & cells, const std::vector<int> & capacity, int first, int count)
+{
+	int node = (int)nodes.size();
+	nodes.push_back(Node());
+	nodes[node].m_left = nodes[node].m_right = nodes[node].m_cell = -1;
+
+	int nGroups = (int)groups.size();
+	int groupLo = nGroups, groupHi = -1;
+	for (int i = first; i < first + count; i++)
+	{
+		groupLo = std::min(groupLo, cells[i] % nGroups);
+		groupHi = std::max(groupHi, cells[i] % nGroups);
+	}
+	nodes[node].m_group = (groupLo == groupHi) ? groups[groupLo] : -1;
+
+	if (count == 1)
+	{
+		// the leaves are numbered in depth first order, so the slots of a subtree are contiguous
+		int g = cells[first];
+		int c = (int)cellStart.size();
+		cellStart.push_back(cellStart.empty() ? 0 : cellStart.back() + cellCapacity.back());
+		cellCapacity.push_back(capacity[g]);
+		gridCell[g] = c;
+		nodes[node].m_cell = c;
+		return node;
+	}
+
+	if (groupLo != groupHi)
+	{
+		// the groups go to separate subtrees before the space is split
+		int groupMid = (groupLo + groupHi) / 2;
+		int half = (int)(std::partition(cells.begin() + first, cells.begin() + first + count,
+			[nGroups, groupMid](int a) { return a % nGroups <= groupMid; }) - (cells.begin() + first));
+
+		int left = buildTree(cells, capacity, first, half);
+		int right = buildTree(cells, capacity, first + half, count - half);
+		nodes[node].m_left = left;
+		nodes[node].m_right = right;
+		return node;
+	}
+
+	// split at the median along the longest side of the cells
+	int lo[3] = { dims[0], dims[1], dims[2] };
+	int hi[3] = { 0, 0, 0 };
+	for (int i = first; i < first + count; i++)
+	{
+		int g = cells[i] / nGroups;
+		int c[3] = { g % dims[0], (g / dims[0]) % dims[1], g / (dims[0] * dims[1]) };
+		for (int j = 0; j < 3; j++)
+		{
+			lo[j] = std::min(lo[j], c[j]);
+			hi[j] = std::max(hi[j], c[j]);
+		}
+	}
+	int axis = 0;
+	for (int j = 1; j < 3; j++)
+	{
+		if (hi[j] - lo[j] > hi[axis] - lo[axis]) axis = j;
+	}
+
+	int stride = (axis == 0) ? 1 : (axis == 1) ? dims[0] : dims[0] * dims[1];
+	int size = dims[axis];
+	int half = count / 2;
+	std::nth_element(cells.begin() + first, cells.begin() + first + half, cells.begin() + first + count,
+		[stride, size, nGroups](int a, int b) { return (a / nGroups / stride) % size < (b / nGroups / stride) % size; });
+
+	int left = buildTree(cells, capacity, first, half);
+	int right = buildTree(cells, capacity, first + half, count - half);
+	nodes[node].m_left = left;
+	nodes[node].m_right = right;
+	return node;
+}
+
+void SurfaceBuffer::degenerateSlot(int slot)
+{
+	// a degenerate triangle does not produce any fragment
+	GLuint first = (GLuint)(slot * cornersPerFace);
+	GLuint * index = &indices[slot * indicesPerFace];
+	for (int i = 0; i < indicesPerFace; i++)
+	{
+		index[i] = first;
+	}
+}
+
+void SurfaceBuffer::clearSlot(int slot)
+{
+	degenerateSlot(slot);
+
+	if (isSmooth)
+	{
+		unlinkCorners(slot);
+	}
+
+	unsigned long long * edges = &slotEdges[slot * cornersPerFace];
+	for (int k = 0; k < cornersPerFace; k++)
+	{
+		removeEdge(edges[k]);
+		edges[k] = 0;
+	}
+
+	int c = slotCell[slot];
+	slotOf.erase(slotFace[slot]);
+	slotFace[slot] = NULL;
+	cellFree[c].push_back(slot);
+	cellDirty[c] = true;
+	dirtySlots.push_back(slot);
+}
+
+void SurfaceBuffer::linkCorners(int slot, const int * ids)
+{
+	for (int k = 0; k < cornersPerFace; k++)
+	{
+		int c = slot * cornersPerFace + k;
+		int v = ids[k];
+		cornerVertex[c] = v;
+		cornerPrev[c] = -1;
+		cornerNext[c] = vertexCorner[v];
+		if (vertexCorner[v] >= 0)
+		{
+			cornerPrev[vertexCorner[v]] = c;
+		}
+		vertexCorner[v] = c;
+		dirtyVertices.push_back(v);
+	}
+}
+
+void SurfaceBuffer::unlinkCorners(int slot)
+{
+	for (int k = 0; k < cornersPerFace; k++)
+	{
+		int c = slot * cornersPerFace + k;
+		int v = cornerVertex[c];
+		if (v < 0)
+		{
+			continue;
+		}
+
+		if (cornerPrev[c] >= 0)
+		{
+			cornerNext[cornerPrev[c]] = cornerNext[c];
+		}
+		else
+		{
+			vertexCorner[v] = cornerNext[c];
+		}
+		if (cornerNext[c] >= 0)
+		{
+			cornerPrev[cornerNext[c]] = cornerPrev[c];
+		}
+		cornerVertex[c] = -1;
+		dirtyVertices.push_back(v);
+	}
+}
+
+CPoint SurfaceBuffer::slotAreaNormal(int slot) const
+{
+	const Vertex * corner = &vertices[slot * cornersPerFace];
+	CPoint p0(corner[0].position[0], corner[0].position[1], corner[0].position[2]);
+	CPoint n(0, 0, 0);
+	for (int t = 1; t + 1 < cornersPerFace; t++)
+	{
+		CPoint p1(corner[t].position[0], corner[t].position[1], corner[t].position[2]);
+		CPoint p2(corner[t + 1].position[0], corner[t + 1].position[1], corner[t + 1].position[2]);
+		n = n + ((p1 - p0) ^ (p2 - p0));
+	}
+	return n;
+}
+
+void SurfaceBuffer::updateVertexNormals()
+{
+	std::sort(dirtyVertices.begin(), dirtyVertices.end());
+	dirtyVertices.erase(std::unique(dirtyVertices.begin(), dirtyVertices.end()), dirtyVertices.end());
+
+	// every dirty vertex is summed again over the faces still around it, the corners of a vertex are its own, so the
+	// threads never write the same normal
+	int n = (int)dirtyVertices.size();
+#pragma omp parallel for schedule(dynamic, 256) if (n > 4096)
+	for (int i = 0; i < n; i++)
+	{
+		int v = dirtyVertices[i];
+		CPoint sum(0, 0, 0);
+		for (int c = vertexCorner[v]; c >= 0; c = cornerNext[c])
+		{
+			sum = sum + slotAreaNormal(c / cornersPerFace);
+		}
+		double len = sum.norm();
+		if (len > 0)
+		{
+			sum = sum / len;
+		}
+		for (int c = vertexCorner[v]; c >= 0; c = cornerNext[c])
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				normals[3 * c + j] = (GLfloat)sum[j];
+			}
+		}
+	}
+
+	for (int i = 0; i < n; i++)
+	{
+		for (int c = vertexCorner[dirtyVertices[i]]; c >= 0; c = cornerNext[c])
+		{
+			dirtySlots.push_back(c / cornersPerFace);
+		}
+	}
+	dirtyVertices.clear();
+}
+
+bool SurfaceBuffer::addEdge(unsigned long long key, const CPoint & a, const CPoint & b, const GLubyte * color, int c, const GLfloat * centroid)
+{
+	std::unordered_map<unsigned long long, EdgeRef>::iterator eIter = edgeOf.find(key);
+	if (eIter != edgeOf.end())
+	{
+		eIter->second.m_count++;
+		return true;
+	}
+
+	if (edgeCellFree[c].empty())
+	{
+		return false;
+	}
+
+	int slot = edgeCellFree[c].back();
+	edgeCellFree[c].pop_back();
+
+	LineVertex * end = &lineVertices[2 * slot];
+	for (int j = 0; j < 3; j++)
+	{
+		end[0].position[j] = (GLfloat)a[j];
+		end[1].position[j] = (GLfloat)b[j];
+	}
+	for (int j = 0; j < 4; j++)
+	{
+		end[0].color[j] = end[1].color[j] = color[j];
+	}
+	if (centroid != NULL)
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			lineCentroids[6 * slot + i] = centroid[i % 3];
+		}
+	}
+
+	EdgeRef ref = { slot, 1 };
+	edgeOf[key] = ref;
+	edgeSlotKey[slot] = key;
+	dirtyEdges.push_back(slot);
+	cellDirty[c] = true;
+	return true;
+}
+
+void SurfaceBuffer::removeEdge(unsigned long long key)
+{
+	std::unordered_map<unsigned long long, EdgeRef>::iterator eIter = edgeOf.find(key);
+	if (eIter == edgeOf.end() || --eIter->second.m_count > 0)
+	{
+		return;
+	}
+
+	// a line of length zero does not produce any fragment
+	int slot = eIter->second.m_slot;
+	LineVertex * end = &lineVertices[2 * slot];
+	end[1] = end[0];
+
+	edgeOf.erase(eIter);
+	edgeSlotKey[slot] = 0;
+	edgeCellFree[edgeSlotCell[slot]].push_back(slot);
+	cellDirty[edgeSlotCell[slot]] = true;
+	dirtyEdges.push_back(slot);
+}
+
+void SurfaceBuffer::refit()
+{
+	for (size_t c = 0; c < cellStart.size(); c++)
+	{
+		if (!cellDirty[c])
+		{
+			continue;
+		}
+		cellDirty[c] = false;
+
+		CPoint lo(DBL_MAX, DBL_MAX, DBL_MAX), hi(-DBL_MAX, -DBL_MAX, -DBL_MAX);
+		for (int s = cellStart[c]; s < cellStart[c] + cellCapacity[c]; s++)
+		{
+			if (slotFace[s] == NULL)
+			{
+				continue;
+			}
+			const Vertex * corner = &vertices[s * cornersPerFace];
+			for (int k = 0; k < cornersPerFace; k++)
+			{
+				for (int j = 0; j < 3; j++)
+				{
+					lo[j] = std::min(lo[j], (double)corner[k].position[j]);
+					hi[j] = std::max(hi[j], (double)corner[k].position[j]);
+				}
+			}
+			if (hasCentroids())
+			{
+				// a shrunk face lies between its corners and the centroid of its element
+				const GLfloat * centroid = &centroids[s * cornersPerFace * 3];
+				for (int j = 0; j < 3; j++)
+				{
+					lo[j] = std::min(lo[j], (double)centroid[j]);
+					hi[j] = std::max(hi[j], (double)centroid[j]);
+				}
+			}
+		}
+		// an edge stays in its cell after the face that added it left
+		for (int s = edgeCellStart[c]; s < edgeCellStart[c] + edgeCellCapacity[c]; s++)
+		{
+			if (edgeSlotKey[s] == 0)
+			{
+				continue;
+			}
+			for (int k = 0; k < 2; k++)
+			{
+				for (int j = 0; j < 3; j++)
+				{
+					lo[j] = std::min(lo[j], (double)lineVertices[2 * s + k].position[j]);
+					hi[j] = std::max(hi[j], (double)lineVertices[2 * s + k].position[j]);
+				}
+			}
+			if (hasCentroids())
+			{
+				for (int j = 0; j < 3; j++)
+				{
+					lo[j] = std::min(lo[j], (double)lineCentroids[6 * s + j]);
+					hi[j] = std::max(hi[j], (double)lineCentroids[6 * s + j]);
+				}
+			}
+		}
+		cellMin[c] = lo;
+		cellMax[c] = hi;
+	}
+
+	if (!nodes.empty())
+	{
+		refitNode(0);
+	}
+}
+
+void SurfaceBuffer::refitNode(int node)
+{
+	Node & n = nodes[node];
+	if (n.m_cell >= 0)
+	{
+		n.m_min = cellMin[n.m_cell];
+		n.m_max = cellMax[n.m_cell];
+		return;
+	}
+
+	refitNode(n.m_left);
+	refitNode(n.m_right);
+
+	// an empty child has an inverted box and drops out of the union
+	const Node & l = nodes[n.m_left];
+	const Node & r = nodes[n.m_right];
+	for (int j = 0; j < 3; j++)
+	{
+		n.m_min[j] = std::min(l.m_min[j], r.m_min[j]);
+		n.m_max[j] = std::max(l.m_max[j], r.m_max[j]);
+	}
+}
+
+void SurfaceBuffer::upload()
+{
+	if (!vertexBuffer.isCreated())
+	{
+		vertexBuffer.create();
+		indexBuffer.create();
+		lineBuffer.create();
+		multiDrawElements = (MultiDrawElements)QGLContext::currentContext()->getProcAddress("glMultiDrawElements");
+		multiDrawArrays = (MultiDrawArrays)QGLContext::currentContext()->getProcAddress("glMultiDrawArrays");
+	}
+
+	// the cells already hold room for the faces entering with the next cuts
+	vertexBuffer.bind();
+	vertexBuffer.allocate((int)(vertices.size() * sizeof(Vertex)));
+	if (!vertices.empty())
+	{
+		vertexBuffer.write(0, &vertices[0], (int)(vertices.size() * sizeof(Vertex)));
+	}
+	vertexBuffer.release();
+
+	indexBuffer.bind();
+	indexBuffer.allocate((int)(indices.size() * sizeof(GLuint)));
+	if (!indices.empty())
+	{
+		indexBuffer.write(0, &indices[0], (int)(indices.size() * sizeof(GLuint)));
+	}
+	indexBuffer.release();
+
+	lineBuffer.bind();
+	lineBuffer.allocate((int)(lineVertices.size() * sizeof(LineVertex)));
+	if (!lineVertices.empty())
+	{
+		lineBuffer.write(0, &lineVertices[0], (int)(lineVertices.size() * sizeof(LineVertex)));
+	}
+	lineBuffer.release();
+
+	if (hasNormals())
+	{
+		if (!normalBuffer.isCreated())
+		{
+			normalBuffer.create();
+		}
+		normalBuffer.bind();
+		normalBuffer.allocate((int)(normals.size() * sizeof(GLfloat)));
+		if (!normals.empty())
+		{
+			normalBuffer.write(0, &normals[0], (int)(normals.size() * sizeof(GLfloat)));
+		}
+		normalBuffer.release();
+	}
+
+	if (hasCentroids())
+	{
+		if (!centroidBuffer.isCreated())
+		{
+			centroidBuffer.create();
+		}
+		centroidBuffer.bind();
+		centroidBuffer.allocate((int)(centroids.size() * sizeof(GLfloat)));
+		if (!centroids.empty())
+		{
+			centroidBuffer.write(0, &centroids[0], (int)(centroids.size() * sizeof(GLfloat)));
+		}
+		centroidBuffer.release();
+
+		if (!lineCentroidBuffer.isCreated())
+		{
+			lineCentroidBuffer.create();
+		}
+		lineCentroidBuffer.bind();
+		lineCentroidBuffer.allocate((int)(lineCentroids.size() * sizeof(GLfloat)));
+		if (!lineCentroids.empty())
+		{
+			lineCentroidBuffer.write(0, &lineCentroids[0], (int)(lineCentroids.size() * sizeof(GLfloat)));
+		}
+		lineCentroidBuffer.release();
+	}
+
+	lastUpload = vertices.size() * sizeof(Vertex) + (normals.size() + centroids.size() + lineCentroids.size()) * sizeof(GLfloat) +
+		indices.size() * sizeof(GLuint) + lineVertices.size() * sizeof(LineVertex);
+	dirtySlots.clear();
+	dirtyEdges.clear();
+}
+
+void SurfaceBuffer::dirtyRuns(std::vector<int> & dirty, std::vector<std::pair<int, int> > & runs)
+{
+	std::sort(dirty.begin(), dirty.end());
+	dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+
+	runs.clear();
+	size_t i = 0;
+	while (i < dirty.size())
+	{
+		// a run of consecutive slots is written at once
+		size_t j = i + 1;
+		while (j < dirty.size() && dirty[j] == dirty[j - 1] + 1)
+		{
+			j++;
+		}
+		runs.push_back(std::make_pair(dirty[i], (int)(j - i)));
+		i = j;
+	}
+}
+
+void SurfaceBuffer::uploadDirty()
+{
+	dirtyRuns(dirtySlots, uploadRuns);
+	for (size_t r = 0; r < uploadRuns.size(); r++)
+	{
+		int first = uploadRuns[r].first;
+		int count = uploadRuns[r].second;
+
+		int vertexBytes = count * cornersPerFace * sizeof(Vertex);
+		int indexBytes = count * indicesPerFace * sizeof(GLuint);
+
+		vertexBuffer.bind();
+		vertexBuffer.write(first * cornersPerFace * sizeof(Vertex), &vertices[first * cornersPerFace], vertexBytes);
+		indexBuffer.bind();
+		indexBuffer.write(first * indicesPerFace * sizeof(GLuint), &indices[first * indicesPerFace], indexBytes);
+		lastUpload += vertexBytes + indexBytes;
+
+		if (hasNormals())
+		{
+			int normalBytes = count * cornersPerFace * 3 * sizeof(GLfloat);
+			normalBuffer.bind();
+			normalBuffer.write(first * cornersPerFace * 3 * sizeof(GLfloat), &normals[first * cornersPerFace * 3], normalBytes);
+			lastUpload += normalBytes;
+		}
+
+		if (hasCentroids())
+		{
+			int centroidBytes = count * cornersPerFace * 3 * sizeof(GLfloat);
+			centroidBuffer.bind();
+			centroidBuffer.write(first * cornersPerFace * 3 * sizeof(GLfloat), &centroids[first * cornersPerFace * 3], centroidBytes);
+			lastUpload += centroidBytes;
+		}
+	}
+	if (!uploadRuns.empty())
+	{
+		indexBuffer.release();
+		vertexBuffer.release();
+		if (hasNormals())
+		{
+			normalBuffer.release();
+		}
+		if (hasCentroids())
+		{
+			centroidBuffer.release();
+		}
+	}
+
+	dirtyRuns(dirtyEdges, uploadRuns);
+	for (size_t r = 0; r < uploadRuns.size(); r++)
+	{
+		int lineBytes = uploadRuns[r].second * 2 * sizeof(LineVertex);
+		lineBuffer.bind();
+		lineBuffer.write(uploadRuns[r].first * 2 * sizeof(LineVertex), &lineVertices[uploadRuns[r].first * 2], lineBytes);
+		lastUpload += lineBytes;
+
+		if (hasCentroids())
+		{
+			int centroidBytes = uploadRuns[r].second * 6 * sizeof(GLfloat);
+			lineCentroidBuffer.bind();
+			lineCentroidBuffer.write(uploadRuns[r].first * 6 * sizeof(GLfloat), &lineCentroids[uploadRuns[r].first * 6], centroidBytes);
+			lastUpload += centroidBytes;
+		}
+	}
+	if (!uploadRuns.empty())
+	{
+		lineBuffer.release();
+		if (hasCentroids())
+		{
+			lineCentroidBuffer.release();
+		}
+	}
+
+	dirtySlots.clear();
+	dirtyEdges.clear();
+}
+
+void SurfaceBuffer::draw(const GLdouble * modelView, const GLdouble * projection, bool isLit, TextureMode texture)
+{
+	cullCells(modelView, projection);
+	collectRanges(cellStart, cellCapacity);
+	drawnTriangles = drawTriangles(isLit, texture) / 3;
+}
+
+void SurfaceBuffer::drawOutlines(const GLdouble * modelView, const GLdouble * projection, const GLubyte * color)
+{
+	cullCells(modelView, projection);
+	collectRanges(edgeCellStart, edgeCellCapacity);
+	drawnEdges = drawLines(color) / 2;
+}
+
+void SurfaceBuffer::cullCells(const GLdouble * modelView, const GLdouble * projection)
+{
+	drawnCells = 0;
+	visibleCells.clear();
+	if (slotOf.empty() || !vertexBuffer.isCreated())
+	{
+		return;
+	}
+
+	// the planes of the frustum from the rows of projection * modelView, inside where a x + b y + c z + d >= 0
+	GLdouble clip[16];
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			clip[i + 4 * j] = 0;
+			for (int k = 0; k < 4; k++)
+			{
+				clip[i + 4 * j] += projection[i + 4 * k] * modelView[k + 4 * j];
+			}
+		}
+	}
+	GLdouble planes[6][4];
+	for (int p = 0; p < 6; p++)
+	{
+		int row = p / 2;
+		double sign = (p % 2 == 0) ? 1.0 : -1.0;
+		for (int j = 0; j < 4; j++)
+		{
+			planes[p][j] = clip[3 + 4 * j] + sign * clip[row + 4 * j];
+		}
+	}
+
+	stack.clear();
+	stack.push_back(0);
+	while (!stack.empty())
+	{
+		// the lowest bit marks a subtree found completely inside the frustum
+		int entry = stack.back();
+		stack.pop_back();
+		const Node & n = nodes[entry >> 1];
+		bool inside = (entry & 1) != 0;
+
+		if (n.m_min[0] > n.m_max[0])
+		{
+			continue;
+		}
+
+		if (n.m_group >= 0 && hiddenGroups != NULL && hiddenGroups->count(n.m_group) != 0)
+		{
+			continue;
+		}
+
+		if (!inside)
+		{
+			bool outside = false;
+			inside = true;
+			for (int p = 0; p < 6 && !outside; p++)
+			{
+				// the corners of the box farthest along and against the plane normal
+				double outer = planes[p][3], inner = planes[p][3];
+				for (int j = 0; j < 3; j++)
+				{
+					outer += planes[p][j] * (planes[p][j] > 0 ? n.m_max[j] : n.m_min[j]);
+					inner += planes[p][j] * (planes[p][j] > 0 ? n.m_min[j] : n.m_max[j]);
+				}
+				outside = outer < 0;
+				inside = inside && inner >= 0;
+			}
+			if (outside)
+			{
+				continue;
+			}
+		}
+
+		if (n.m_cell < 0)
+		{
+			// the left child is drawn first, so the cells come in slot order
+			stack.push_back((n.m_right << 1) | (inside ? 1 : 0));
+			stack.push_back((n.m_left << 1) | (inside ? 1 : 0));
+			continue;
+		}
+
+		drawnCells++;
+		visibleCells.push_back(n.m_cell);
+	}
+}
+
+void SurfaceBuffer::collectRanges(const std::vector<int> & start, const std::vector<int> & capacity)
+{
+	rangeFirsts.clear();
+	rangeSlots.clear();
+
+	// neighboring leaves are neighboring ranges and merge
+	int rangeFirst = -1, rangeEnd = -1;
+	for (size_t i = 0; i < visibleCells.size(); i++)
+	{
+		int c = visibleCells[i];
+		if (start[c] != rangeEnd)
+		{
+			if (rangeFirst >= 0)
+			{
+				rangeFirsts.push_back(rangeFirst);
+				rangeSlots.push_back(rangeEnd - rangeFirst);
+			}
+			rangeFirst = start[c];
+		}
+		rangeEnd = start[c] + capacity[c];
+	}
+	if (rangeFirst >= 0)
+	{
+		rangeFirsts.push_back(rangeFirst);
+		rangeSlots.push_back(rangeEnd - rangeFirst);
+	}
+}
+
+void SurfaceBuffer::bindProgram(bool isLit, TextureMode texture, GLfloat shrink)
+{
+	program->bind();
+	program->setUniformValue(isLitLocation, (GLint)isLit);
+	program->setUniformValue(isSmoothLocation, (GLint)isSmooth);
+	program->setUniformValue(shrinkLocation, shrink);
+	program->setUniformValue(textureModeLocation, (GLint)texture);
+}
+
+size_t SurfaceBuffer::drawTriangles(bool isLit, TextureMode texture)
+{
+	if (rangeFirsts.empty())
+	{
+		return 0;
+	}
+
+	size_t drawn = 0;
+	drawCounts.clear();
+	drawOffsets.clear();
+	for (size_t r = 0; r < rangeFirsts.size(); r++)
+	{
+		drawCounts.push_back((GLsizei)(rangeSlots[r] * indicesPerFace));
+		drawOffsets.push_back((const GLvoid*)(rangeFirsts[r] * indicesPerFace * sizeof(GLuint)));
+		drawn += drawCounts.back();
+	}
+
+	if (isShaded)
+	{
+		bindProgram(isLit, texture, hasCentroids() ? shrinkFactor : 1.0f);
+	}
+	if (hasNormals())
+	{
+		// the pointer is taken from the normal buffer before the vertex buffer is bound
+		normalBuffer.bind();
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glNormalPointer(GL_FLOAT, 0, (const GLvoid*)0);
+	}
+	if (hasCentroids())
+	{
+		centroidBuffer.bind();
+		program->enableAttributeArray(centroidLocation);
+		program->setAttributeBuffer(centroidLocation, GL_FLOAT, 0, 3);
+	}
+
+	vertexBuffer.bind();
+	indexBuffer.bind();
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+
+	// the pointers are offsets into the bound vertex buffer
+	glVertexPointer(3, GL_FLOAT, sizeof(Vertex), (const GLvoid*)offsetof(Vertex, position));
+	glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), (const GLvoid*)offsetof(Vertex, uv));
+	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), (const GLvoid*)offsetof(Vertex, color));
+
+	// free slots are degenerate and cost next to nothing
+	if (multiDrawElements != NULL)
+	{
+		multiDrawElements(GL_TRIANGLES, &drawCounts[0], GL_UNSIGNED_INT, &drawOffsets[0], (GLsizei)drawCounts.size());
+	}
+	else
+	{
+		for (size_t r = 0; r < drawCounts.size(); r++)
+		{
+			glDrawElements(GL_TRIANGLES, drawCounts[r], GL_UNSIGNED_INT, drawOffsets[r]);
+		}
+	}
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	indexBuffer.release();
+	vertexBuffer.release();
+
+	if (hasCentroids())
+	{
+		program->disableAttributeArray(centroidLocation);
+	}
+	if (isShaded)
+	{
+		program->release();
+	}
+	if (hasNormals())
+	{
+		glDisableClientState(GL_NORMAL_ARRAY);
+	}
+
+	return drawn;
+}
+
+size_t SurfaceBuffer::drawLines(const GLubyte * color)
+{
+	if (rangeFirsts.empty())
+	{
+		return 0;
+	}
+
+	size_t drawn = 0;
+	drawFirsts.clear();
+	drawCounts.clear();
+	for (size_t r = 0; r < rangeFirsts.size(); r++)
+	{
+		drawFirsts.push_back((GLint)(rangeFirsts[r] * 2));
+		drawCounts.push_back((GLsizei)(rangeSlots[r] * 2));
+		drawn += drawCounts.back();
+	}
+
+	// the lines carry no normal, they are drawn unlit, and shrunk with the faces by the same factor
+	if (isShaded)
+	{
+		bindProgram(false, UNTEXTURED, hasCentroids() ? shrinkFactor : 1.0f);
+	}
+	else
+	{
+		glPushAttrib(GL_ENABLE_BIT);
+		glDisable(GL_LIGHTING);
+	}
+	if (hasCentroids())
+	{
+		lineCentroidBuffer.bind();
+		program->enableAttributeArray(centroidLocation);
+		program->setAttributeBuffer(centroidLocation, GL_FLOAT, 0, 3);
+	}
+
+	lineBuffer.bind();
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3, GL_FLOAT, sizeof(LineVertex), (const GLvoid*)offsetof(LineVertex, position));
+	if (color == NULL)
+	{
+		glEnableClientState(GL_COLOR_ARRAY);
+		glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(LineVertex), (const GLvoid*)offsetof(LineVertex, color));
+	}
+	else
+	{
+		glColor4ubv(color);
+	}
+
+	// free slots are lines of length zero
+	if (multiDrawArrays != NULL)
+	{
+		multiDrawArrays(GL_LINES, &drawFirsts[0], &drawCounts[0], (GLsizei)drawCounts.size());
+	}
+	else
+	{
+		for (size_t r = 0; r < drawCounts.size(); r++)
+		{
+			glDrawArrays(GL_LINES, drawFirsts[r], drawCounts[r]);
+		}
+	}
+
+	if (color == NULL)
+	{
+		glDisableClientState(GL_COLOR_ARRAY);
+	}
+	glDisableClientState(GL_VERTEX_ARRAY);
+	lineBuffer.release();
+
+	if (hasCentroids())
+	{
+		program->disableAttributeArray(centroidLocation);
+	}
+	if (isShaded)
+	{
+		program->release();
+	}
+	else
+	{
+		glPopAttrib();
+	}
+
+	return drawn;
+}
@@ -0,0 +1,752 @@
+#ifndef SurfaceBuffer_H
+#define SurfaceBuffer_H
+
+#include <QGLBuffer>
+#include <QGLContext>
+#include <QGLShaderProgram>
+
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <algorithm>
+
+#include "OpenGLHeader.h"
+#include "ViewerTFiberMesh.h"
+#include "ViewerHMesh.h"
+#include "GroupColors.h"
+
+using namespace MeshLib;
+
+/*!
+* \brief SurfaceBuffer, vertex and index buffer of a list of half faces, kept on the GPU across frames
+* \details Every half face owns a slot of corners with the color of the face, the slots are grouped into cells that
+* \details are culled against the view frustum. A cut only rewrites the slots of the faces that entered or left the list.
+* \details The faces are flat shaded by a shader, the wireframe is a separate buffer of the unique edges of the faces.
+*/
+class SurfaceBuffer
+{
+public:
+	struct Vertex
+	{
+		GLfloat position[3];
+		GLfloat uv[2];
+		GLubyte color[4];
+	};
+
+	// an edge slot holds the two ends of the edge, a free slot has both at the same point
+	struct LineVertex
+	{
+		GLfloat position[3];
+		GLubyte color[4];
+	};
+
+	// how the texture of the viewer is applied to the faces, as GL_REPLACE or GL_MODULATE would
+	enum TextureMode { UNTEXTURED = 0, REPLACE = 1, MODULATE = 2 };
+
+	SurfaceBuffer();
+	~SurfaceBuffer();
+
+	// bring the buffers up to date with the half faces, returns true if anything was uploaded
+	bool update(TMeshLib::CVTMesh * mesh, std::vector<TMeshLib::CViewerHalfFace*> & halffaces);
+	bool update(HMeshLib::CVHMesh * mesh, std::vector<HMeshLib::CHViewerHalfFace*> & halffaces);
+
+	// draw the cells inside the view frustum, lit if isLit and textured by texture, the fixed function fallback follows
+	// the state of the caller instead
+	void draw(const GLdouble * modelView, const GLdouble * projection, bool isLit, TextureMode texture);
+	// draw the unique edges inside the view frustum as unlit lines, in the colors of the faces or in color if not NULL,
+	// an edge shared by two faces is drawn once and the diagonals of the triangulation are not drawn
+	void drawOutlines(const GLdouble * modelView, const GLdouble * projection, const GLubyte * color);
+
+	// the faces are shaded by the program, false for the fixed function fallback
+	bool shaded() const { return isShaded; };
+
+	// light the faces with the area weighted normals of their vertices instead of their own, the next update rebuilds
+	// on a change, a cut only sums again the normals of the vertices of the faces that entered or left
+	void setSmooth(bool smooth);
+	bool smooth() const { return isSmooth; };
+
+	// draw every face and edge scaled by factor toward the centroid of its element, the next update rebuilds when
+	// shrunk changes, the factor takes effect with the next draw, or with the next update without shaders,
+	// the list then holds every face of the elements to draw, and every element draws its own edges
+	void setShrunk(bool shrunk);
+	bool shrunk() const { return isShrunk; };
+	void setShrinkFactor(double factor);
+
+	// the groups left out of the draw list, owned by the caller
+	void setHiddenGroups(const std::set<int> * groups) { hiddenGroups = groups; };
+
+	size_t numFaces() const { return slotOf.size(); };
+
+	// bytes sent to the GPU by the last update
+	size_t uploadedBytes() const { return lastUpload; };
+
+	// cells drawn by the last frame, out of numCells()
+	size_t numDrawnCells() const { return drawnCells; };
+	size_t numCells() const { return cellStart.size(); };
+	// triangles submitted by the last frame, the degenerate ones of free slots included
+	size_t numDrawnTriangles() const { return drawnTriangles; };
+	// edges submitted by the last outline drawing, the free slots included
+	size_t numDrawnEdges() const { return drawnEdges; };
+	size_t numEdges() const { return edgeOf.size(); };
+
+private:
+	// node of the hierarchy over the cells, a leaf holds one cell
+	struct Node
+	{
+		CPoint m_min;
+		CPoint m_max;
+		int m_left;
+		int m_right;
+		int m_cell;
+		// the group of all cells below, -1 if they are of several groups
+		int m_group;
+	};
+
+	// an edge in the line buffer and the number of faces of the list sharing it
+	struct EdgeRef
+	{
+		int m_slot;
+		int m_count;
+	};
+
+	// lay out the cells and put every half face into a slot of its cell, then upload the whole buffers
+	template<typename M, typename HF>
+	void rebuild(M * mesh, std::vector<HF*> & halffaces, int cornersPerFace);
+
+	// move the faces that left the list to the free lists and the faces that entered into slots of their cells, the
+	// changes come from the mesh when the buffer holds the cut before the current one, else the list is compared
+	template<typename M, typename HF>
+	void patch(M * mesh, std::vector<HF*> & halffaces);
+
+	// give the faces of the slots colored as selected and the faces in selectedHalfFaces the colors of their faces again
+	template<typename M, typename HF>
+	void recolor(M * mesh, std::vector<HF*> & selectedHalfFaces);
+	// write the color of the face to the corners of the slot and to its edges
+	template<typename M, typename HF>
+	void recolorSlot(M * mesh, HF * pHF, int slot);
+
+	// write the face into the slot and add its edges, false if the cell has no free edge slot left, a quad is a fan of
+	// two triangles split along the same diagonal as the immediate mode
+	template<typename M, typename HF>
+	bool fillSlot(M * mesh, HF * pHF, int slot);
+
+	// the corners of the face, their vertex indices and the keys of its edges
+	template<typename M, typename HF>
+	int faceCorners(M * mesh, HF * pHF, CPoint * points, int * ids, unsigned long long * keys) const;
+
+	template<typename M, typename HF>
+	int faceCell(M * mesh, HF * pHF) const;
+
+	// the grid cell of a point, clamped to the grid
+	int pointCell(const CPoint & p) const;
+	// the key of a grid cell and a group, the groups not in the arrays share the key of the first
+	int cellKey(int gridIndex, int group) const;
+
+	// a grid over the box of the arrays, with about one cell per targetFaces faces, and the groups of its elements
+	void setupGrid(const CMeshArrays & arrays, size_t targetFaces);
+	// give every cell room for its faces and an estimate of the faces a cut exposes in it, ordered by the hierarchy,
+	// which splits the groups apart first, so every group is a contiguous range of slots and a subtree
+	void layoutCells(const CMeshArrays & arrays, const std::vector<int> & faceCells);
+	// the same for the edges, edgeCount[c] edges start in cell c
+	void layoutEdgeCells(const std::vector<int> & edgeCount);
+	int buildTree(std::vector<int> & cells, const std::vector<int> & capacity, int first, int count);
+
+	// collect the cells inside the frustum into visibleCells, in slot order, the subtrees of hidden groups are skipped
+	void cullCells(const GLdouble * modelView, const GLdouble * projection);
+	// merge the slot ranges of the visible cells into rangeFirsts and rangeSlots
+	void collectRanges(const std::vector<int> & start, const std::vector<int> & capacity);
+	// draw the collected ranges as triangles, returns the number of indices drawn
+	size_t drawTriangles(bool isLit, TextureMode texture);
+	// draw the collected ranges of edge slots as lines, returns the number of vertices drawn
+	size_t drawLines(const GLubyte * color);
+
+	// bind the program and set its uniforms, lit only if isLit and shrunk by shrink
+	void bindProgram(bool isLit, TextureMode texture, GLfloat shrink);
+
+	void clearSlot(int slot);
+	void degenerateSlot(int slot);
+
+	// add the corners of the slot to the lists of their vertices, or take them out, and mark the vertices
+	void linkCorners(int slot, const int * ids);
+	void unlinkCorners(int slot);
+	// the sum of the cross products of the triangles of the slot, its normal scaled by twice its area
+	CPoint slotAreaNormal(int slot) const;
+	// sum the normals of the marked vertices again and write them to their corners
+	void updateVertexNormals();
+
+	// the normal buffer is used by the fixed function fallback and by smooth shading
+	bool hasNormals() const { return !isShaded || isSmooth; };
+	// the centroid buffers are only used by the program
+	bool hasCentroids() const { return isShaded && isShrunk; };
+
+	// take an edge slot of cell c, write the edge and count the face on it, centroid is NULL unless hasCentroids(),
+	// the edge keeps its slot in the cell of the face that added it until the last face using it is removed
+	bool addEdge(unsigned long long key, const CPoint & a, const CPoint & b, const GLubyte * color, int c, const GLfloat * centroid);
+	void removeEdge(unsigned long long key);
+
+	// recompute the boxes of the dirty cells from their faces and refit the hierarchy
+	void refit();
+	void refitNode(int node);
+
+	// the color of the face from the group colors, as drawn by the immediate mode path
+	static const GLubyte * faceColor(TMeshLib::CVTMesh * mesh, TMeshLib::CViewerHalfFace * pHF);
+	static const GLubyte * faceColor(HMeshLib::CVHMesh * mesh, HMeshLib::CHViewerHalfFace * pHF);
+
+	static int faceGroup(TMeshLib::CVTMesh * mesh, TMeshLib::CViewerHalfFace * pHF) { return mesh->HalfFaceTet(pHF)->group(); };
+	// hexes carry no group
+	static int faceGroup(HMeshLib::CVHMesh * mesh, HMeshLib::CHViewerHalfFace * pHF) { return 0; };
+
+	// the position of the element behind the half face in the arrays
+	static int elementIndex(TMeshLib::CVTMesh * mesh, TMeshLib::CViewerHalfFace * pHF) { return mesh->HalfFaceTet(pHF)->index(); };
+	static int elementIndex(HMeshLib::CVHMesh * mesh, HMeshLib::CHViewerHalfFace * pHF) { return mesh->HalfFaceHex(pHF)->index(); };
+
+	// the centroid of every element of the arrays, the corners and line ends carry the centroid of their element and
+	// the shader moves them toward it by the shrink uniform, without shaders they are moved by fillSlot
+	void setupCentroids(const CMeshArrays & arrays);
+
+	// compile the flat shading program and look up its uniforms, false if the context has no shaders, the flat normal
+	// comes from the screen space derivatives of the eye position, the fallback puts the normals into normalBuffer,
+	// the shaders are GLSL 1.20 and read the matrices and lights of the compatibility profile
+	bool initShading();
+
+	// upload all slots
+	void upload();
+	// upload the dirty slots and edges, merged into runs of consecutive slots, the boxes of their cells are refit before
+	void uploadDirty();
+
+	// sort and merge the dirty slots into runs of first, count
+	static void dirtyRuns(std::vector<int> & dirty, std::vector<std::pair<int, int> > & runs);
+
+	typedef void (APIENTRY * MultiDrawElements)(GLenum mode, const GLsizei * count, GLenum type, const GLvoid * const * indices, GLsizei primcount);
+	typedef void (APIENTRY * MultiDrawArrays)(GLenum mode, const GLint * first, const GLsizei * count, GLsizei primcount);
+
+	QGLBuffer vertexBuffer;
+	QGLBuffer indexBuffer;
+	QGLBuffer lineBuffer;
+	// the normal of every vertex, only filled without shaders
+	QGLBuffer normalBuffer;
+	// the centroid of the element of every vertex and of every end of a line, only filled when shrunk
+	QGLBuffer centroidBuffer;
+	QGLBuffer lineCentroidBuffer;
+
+	QGLShaderProgram * program;
+	bool isShaded;
+	bool isSmooth;
+	bool isShrunk;
+	GLfloat shrinkFactor;
+	int centroidLocation;
+	// the uniforms of the program, looked up once when it is linked
+	int isLitLocation;
+	int isSmoothLocation;
+	int shrinkLocation;
+	int textureModeLocation;
+
+	std::vector<Vertex> vertices;
+	std::vector<GLfloat> normals;
+	std::vector<GLfloat> centroids;
+	std::vector<GLuint> indices;
+	std::vector<LineVertex> lineVertices;
+	std::vector<GLfloat> lineCentroids;
+	// x, y and z of the centroid of every element while shrunk
+	std::vector<GLfloat> elementCentroids;
+
+	// the face in every slot, NULL for a free slot, and the cell the slot belongs to
+	std::vector<const void*> slotFace;
+	std::vector<int> slotCell;
+	std::unordered_map<const void*, int> slotOf;
+	std::vector<int> dirtySlots;
+	// the slots written in the selected color, and the copy of them recolored by the current selection change
+	std::vector<int> selectedSlots;
+	std::vector<int> recolorSlots;
+
+	// the edges of the list by the key of their vertex indices, the edges of every face slot, and the key and the cell
+	// of every edge slot, key 0 for a free slot
+	std::unordered_map<unsigned long long, EdgeRef> edgeOf;
+	std::vector<unsigned long long> slotEdges;
+	std::vector<unsigned long long> edgeSlotKey;
+	std::vector<int> edgeSlotCell;
+	std::vector<int> dirtyEdges;
+
+	// only when smooth, the vertex of every corner, -1 for a free slot, the first corner of every vertex of the mesh,
+	// and the next and previous corner of the same vertex, -1 at the ends
+	std::vector<int> cornerVertex;
+	std::vector<int> vertexCorner;
+	std::vector<int> cornerNext;
+	std::vector<int> cornerPrev;
+	std::vector<int> dirtyVertices;
+
+	// slot was seen in the list during the current patch
+	std::vector<int> slotStamp;
+	int stamp;
+	// the faces the current patch puts into slots, and the runs of the dirty slots to upload, kept to reuse their memory
+	std::vector<const void*> enteredFaces;
+	std::vector<std::pair<int, int> > uploadRuns;
+
+	// the grid, dims cells along every axis of width cellWidth starting at gridMin
+	CPoint gridMin;
+	double cellWidth;
+	int dims[3];
+	// the groups of the elements in ascending order and the index of every group among them
+	std::vector<int> groups;
+	std::unordered_map<int, int> groupIndex;
+	// cell key to the index of its slot range, -1 if no face can be in the cell
+	std::vector<int> gridCell;
+	const std::set<int> * hiddenGroups;
+
+	// slot range, free slots and box of the faces of every cell, in the order of the leaves of the hierarchy
+	std::vector<int> cellStart;
+	std::vector<int> cellCapacity;
+	std::vector<std::vector<int> > cellFree;
+	std::vector<CPoint> cellMin;
+	std::vector<CPoint> cellMax;
+	std::vector<bool> cellDirty;
+	std::vector<int> cellGroup;
+
+	// the edge slot range and free edge slots of every cell, in the same order
+	std::vector<int> edgeCellStart;
+	std::vector<int> edgeCellCapacity;
+	std::vector<std::vector<int> > edgeCellFree;
+
+	std::vector<Node> nodes;
+
+	// the visible cells and slot ranges of the current frame, and the draw lists made of them
+	std::vector<int> visibleCells;
+	std::vector<int> rangeFirsts;
+	std::vector<int> rangeSlots;
+	std::vector<GLsizei> drawCounts;
+	std::vector<const GLvoid*> drawOffsets;
+	std::vector<GLint> drawFirsts;
+	std::vector<int> stack;
+	size_t drawnCells;
+	size_t drawnTriangles;
+	size_t drawnEdges;
+
+	size_t lastUpload;
+
+	int cornersPerFace;
+	int indicesPerFace;
+
+	// glMultiDrawElements and glMultiDrawArrays are not part of the OpenGL 1.1 headers, they are looked up in the context
+	MultiDrawElements multiDrawElements;
+	MultiDrawArrays multiDrawArrays;
+
+	// versions of the mesh the buffers were built from
+	int cutVersion;
+	int geometryVersion;
+	int selectionVersion;
+};
+
+template<typename M, typename HF>
+int SurfaceBuffer::faceCell(M * mesh, HF * pHF) const
+{
+	CPoint center(0, 0, 0);
+	int k = 0;
+	for (typename M::HalfFaceVertexIterator fvIter(mesh, pHF); !fvIter.end(); ++fvIter, k++)
+	{
+		center = center + (*fvIter)->position();
+	}
+	return cellKey(pointCell(center / (double)k), faceGroup(mesh, pHF));
+};
+
+template<typename M, typename HF>
+int SurfaceBuffer::faceCorners(M * mesh, HF * pHF, CPoint * points, int * ids, unsigned long long * keys) const
+{
+	int k = 0;
+	for (typename M::HalfFaceVertexIterator fvIter(mesh, pHF); !fvIter.end() && k < 8; ++fvIter, k++)
+	{
+		points[k] = (*fvIter)->position();
+		ids[k] = (*fvIter)->index();
+	}
+	if (isShrunk)
+	{
+		// every element draws its own edges, the key is the element and the places of the ends among its vertices
+		int e = elementIndex(mesh, pHF);
+		int n = mesh->m_arrays.m_verticesPerElement;
+		const int * ev = &mesh->m_arrays.m_elements[e * n];
+		int local[8];
+		for (int i = 0; i < k; i++)
+		{
+			local[i] = (int)(std::find(ev, ev + n, ids[i]) - ev);
+		}
+		for (int i = 0; i < k; i++)
+		{
+			unsigned int a = (unsigned int)local[i], b = (unsigned int)local[(i + 1) % k];
+			keys[i] = ((unsigned long long)(e + 1) << 8) | (std::min(a, b) << 4) | std::max(a, b);
+		}
+		return k;
+	}
+
+	for (int i = 0; i < k; i++)
+	{
+		unsigned int a = (unsigned int)ids[i], b = (unsigned int)ids[(i + 1) % k];
+		keys[i] = ((unsigned long long)std::min(a, b) << 32) | std::max(a, b);
+	}
+	return k;
+};
+
+template<typename M, typename HF>
+void SurfaceBuffer::rebuild(M * mesh, std::vector<HF*> & halffaces, int cornersPerFace)
+{
+	this->cornersPerFace = cornersPerFace;
+	indicesPerFace = (cornersPerFace - 2) * 3;
+
+	slotOf.clear();
+	dirtySlots.clear();
+	dirtyEdges.clear();
+	selectedSlots.clear();
+
+	setupGrid(mesh->m_arrays, halffaces.size());
+	if (isShrunk)
+	{
+		setupCentroids(mesh->m_arrays);
+	}
+	else
+	{
+		std::vector<GLfloat>().swap(elementCentroids);
+	}
+
+	std::vector<int> faceCells(halffaces.size());
+	for (size_t f = 0; f < halffaces.size(); f++)
+	{
+		faceCells[f] = faceCell(mesh, halffaces[f]);
+	}
+	layoutCells(mesh->m_arrays, faceCells);
+
+	// an edge goes to the cell of the first face using it, count them for the edge slots
+	std::vector<int> edgeCount(cellStart.size(), 0);
+	edgeOf.clear();
+	for (size_t f = 0; f < halffaces.size(); f++)
+	{
+		CPoint points[8];
+		int ids[8];
+		unsigned long long keys[8];
+		int k = faceCorners(mesh, halffaces[f], points, ids, keys);
+		for (int i = 0; i < k; i++)
+		{
+			EdgeRef ref = { -1, 0 };
+			if (edgeOf.insert(std::make_pair(keys[i], ref)).second)
+			{
+				edgeCount[gridCell[faceCells[f]]]++;
+			}
+		}
+	}
+	edgeOf.clear();
+	layoutEdgeCells(edgeCount);
+
+	size_t slots = cellStart.empty() ? 0 : cellStart.back() + cellCapacity.back();
+	vertices.resize(slots * cornersPerFace);
+	normals.resize(hasNormals() ? slots * cornersPerFace * 3 : 0);
+	centroids.resize(hasCentroids() ? slots * cornersPerFace * 3 : 0);
+	indices.resize(slots * indicesPerFace);
+	slotEdges.assign(slots * cornersPerFace, 0);
+	slotFace.assign(slots, NULL);
+	slotCell.resize(slots);
+	slotStamp.assign(slots, stamp);
+
+	dirtyVertices.clear();
+	if (isSmooth)
+	{
+		cornerVertex.assign(slots * cornersPerFace, -1);
+		cornerNext.assign(slots * cornersPerFace, -1);
+		cornerPrev.assign(slots * cornersPerFace, -1);
+		vertexCorner.assign(mesh->m_arrays.numVertices(), -1);
+	}
+	else
+	{
+		std::vector<int>().swap(cornerVertex);
+		std::vector<int>().swap(cornerNext);
+		std::vector<int>().swap(cornerPrev);
+		std::vector<int>().swap(vertexCorner);
+	}
+
+	size_t edgeSlots = edgeCellStart.empty() ? 0 : edgeCellStart.back() + edgeCellCapacity.back();
+	lineVertices.assign(edgeSlots * 2, LineVertex());
+	lineCentroids.assign(hasCentroids() ? edgeSlots * 2 * 3 : 0, 0.0f);
+	edgeSlotKey.assign(edgeSlots, 0);
+	edgeSlotCell.resize(edgeSlots);
+	for (size_t c = 0; c < edgeCellStart.size(); c++)
+	{
+		edgeCellFree[c].clear();
+		for (int s = edgeCellStart[c] + edgeCellCapacity[c] - 1; s >= edgeCellStart[c]; s--)
+		{
+			edgeSlotCell[s] = (int)c;
+			edgeCellFree[c].push_back(s);
+		}
+	}
+
+	// every slot starts free, the lowest slots of a cell are handed out first
+	for (size_t c = 0; c < cellStart.size(); c++)
+	{
+		cellFree[c].clear();
+		for (int s = cellStart[c] + cellCapacity[c] - 1; s >= cellStart[c]; s--)
+		{
+			slotCell[s] = (int)c;
+			cellFree[c].push_back(s);
+			degenerateSlot(s);
+		}
+		cellDirty[c] = true;
+	}
+
+	for (size_t f = 0; f < halffaces.size(); f++)
+	{
+		int c = gridCell[faceCells[f]];
+		int slot = cellFree[c].back();
+		cellFree[c].pop_back();
+		// the edge slots were counted above, there is always room
+		fillSlot(mesh, halffaces[f], slot);
+	}
+
+	if (isSmooth)
+	{
+		updateVertexNormals();
+	}
+
+	refit();
+	upload();
+};
+
+template<typename M, typename HF>
+void SurfaceBuffer::patch(M * mesh, std::vector<HF*> & halffaces)
+{
+	stamp++;
+	dirtySlots.clear();
+	dirtyEdges.clear();
+	enteredFaces.clear();
+
+	typename M::CListChanges * changes = (mesh->cutVersion() == cutVersion + 1) ? mesh->cutChanges(halffaces) : NULL;
+	if (changes != NULL)
+	{
+		// the cut of the worker knows the faces that left and entered the list since the one in the buffer
+		for (size_t f = 0; f < changes->m_left.size(); f++)
+		{
+			std::unordered_map<const void*, int>::iterator sIter = slotOf.find(changes->m_left[f]);
+			if (sIter != slotOf.end())
+			{
+				clearSlot(sIter->second);
+			}
+		}
+		for (size_t f = 0; f < changes->m_entered.size(); f++)
+		{
+			if (slotOf.count(changes->m_entered[f]) == 0)
+			{
+				enteredFaces.push_back(changes->m_entered[f]);
+			}
+		}
+	}
+	else
+	{
+		// a cut was skipped or the list is not one of the mesh, faces already in a slot stay where they are
+		for (size_t f = 0; f < halffaces.size(); f++)
+		{
+			std::unordered_map<const void*, int>::iterator sIter = slotOf.find(halffaces[f]);
+			if (sIter != slotOf.end())
+			{
+				slotStamp[sIter->second] = stamp;
+			}
+			else
+			{
+				enteredFaces.push_back(halffaces[f]);
+			}
+		}
+
+		for (size_t s = 0; s < slotFace.size(); s++)
+		{
+			if (slotFace[s] != NULL && slotStamp[s] != stamp)
+			{
+				clearSlot((int)s);
+			}
+		}
+	}
+
+	for (size_t f = 0; f < enteredFaces.size(); f++)
+	{
+		HF * pHF = (HF*)enteredFaces[f];
+		int c = gridCell[faceCell(mesh, pHF)];
+		if (c < 0 || cellFree[c].empty())
+		{
+			// the estimate of the cell was too small, lay out the cells again
+			rebuild(mesh, halffaces, cornersPerFace);
+			return;
+		}
+
+		int slot = cellFree[c].back();
+		cellFree[c].pop_back();
+		slotStamp[slot] = stamp;
+		if (!fillSlot(mesh, pHF, slot))
+		{
+			rebuild(mesh, halffaces, cornersPerFace);
+			return;
+		}
+	}
+
+	// the faces that stayed share vertices with those that entered or left, their corners are rewritten as well
+	if (isSmooth)
+	{
+		updateVertexNormals();
+	}
+
+	refit();
+	uploadDirty();
+};
+
+template<typename M, typename HF>
+void SurfaceBuffer::recolor(M * mesh, std::vector<HF*> & selectedHalfFaces)
+{
+	dirtySlots.clear();
+	dirtyEdges.clear();
+
+	// the faces selected before may have been unselected, the faces selected now are looked up by their half faces
+	recolorSlots.swap(selectedSlots);
+	selectedSlots.clear();
+	for (size_t i = 0; i < recolorSlots.size(); i++)
+	{
+		int slot = recolorSlots[i];
+		if (slotFace[slot] != NULL)
+		{
+			recolorSlot(mesh, (HF*)slotFace[slot], slot);
+		}
+	}
+	for (size_t f = 0; f < selectedHalfFaces.size(); f++)
+	{
+		std::unordered_map<const void*, int>::iterator sIter = slotOf.find(selectedHalfFaces[f]);
+		if (sIter != slotOf.end())
+		{
+			recolorSlot(mesh, selectedHalfFaces[f], sIter->second);
+		}
+	}
+
+	uploadDirty();
+};
+
+template<typename M, typename HF>
+void SurfaceBuffer::recolorSlot(M * mesh, HF * pHF, int slot)
+{
+	const GLubyte * color = faceColor(mesh, pHF);
+	if (color == CGroupColors::selected())
+	{
+		selectedSlots.push_back(slot);
+	}
+
+	Vertex * corner = &vertices[slot * cornersPerFace];
+	for (int k = 0; k < cornersPerFace; k++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			corner[k].color[j] = color[j];
+		}
+	}
+	dirtySlots.push_back(slot);
+
+	// a shared edge takes the color of the face recolored last
+	unsigned long long * edges = &slotEdges[slot * cornersPerFace];
+	for (int k = 0; k < cornersPerFace; k++)
+	{
+		std::unordered_map<unsigned long long, EdgeRef>::iterator eIter = edgeOf.find(edges[k]);
+		if (eIter == edgeOf.end())
+		{
+			continue;
+		}
+		LineVertex * ends = &lineVertices[eIter->second.m_slot * 2];
+		for (int j = 0; j < 4; j++)
+		{
+			ends[0].color[j] = color[j];
+			ends[1].color[j] = color[j];
+		}
+		dirtyEdges.push_back(eIter->second.m_slot);
+	}
+};
+
+template<typename M, typename HF>
+bool SurfaceBuffer::fillSlot(M * mesh, HF * pHF, int slot)
+{
+	const GLubyte * color = faceColor(mesh, pHF);
+	if (color == CGroupColors::selected())
+	{
+		selectedSlots.push_back(slot);
+	}
+
+	CPoint points[8];
+	int ids[8];
+	unsigned long long keys[8];
+	faceCorners(mesh, pHF, points, ids, keys);
+
+	const GLfloat * c = isShrunk ? &elementCentroids[3 * elementIndex(mesh, pHF)] : NULL;
+	if (c != NULL && !isShaded)
+	{
+		// without the program the corners are moved here, and the edges with them
+		for (int k = 0; k < cornersPerFace; k++)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				points[k][j] = c[j] + shrinkFactor * (points[k][j] - c[j]);
+			}
+		}
+	}
+
+	Vertex * corner = &vertices[slot * cornersPerFace];
+	int k = 0;
+	for (typename M::HalfFaceVertexIterator fvIter(mesh, pHF); !fvIter.end() && k < cornersPerFace; ++fvIter, k++)
+	{
+		CPoint2 uv = (*fvIter)->uv();
+		for (int j = 0; j < 3; j++)
+		{
+			corner[k].position[j] = (GLfloat)points[k][j];
+		}
+		corner[k].uv[0] = (GLfloat)uv[0];
+		corner[k].uv[1] = (GLfloat)uv[1];
+		for (int j = 0; j < 4; j++)
+		{
+			corner[k].color[j] = color[j];
+		}
+	}
+
+	if (isSmooth)
+	{
+		// the normals are written once all faces are in
+		linkCorners(slot, ids);
+	}
+	else if (!isShaded)
+	{
+		CPoint n = mesh->_halfface_normal(pHF);
+		GLfloat * normal = &normals[slot * cornersPerFace * 3];
+		for (int i = 0; i < cornersPerFace * 3; i++)
+		{
+			normal[i] = (GLfloat)n[i % 3];
+		}
+	}
+
+	if (hasCentroids())
+	{
+		GLfloat * centroid = &centroids[slot * cornersPerFace * 3];
+		for (int i = 0; i < cornersPerFace * 3; i++)
+		{
+			centroid[i] = c[i % 3];
+		}
+	}
+
+	// a fan over the corners of the face
+	GLuint first = (GLuint)(slot * cornersPerFace);
+	GLuint * index = &indices[slot * indicesPerFace];
+	for (int t = 0; t + 2 < cornersPerFace; t++)
+	{
+		index[3 * t] = first;
+		index[3 * t + 1] = first + t + 1;
+		index[3 * t + 2] = first + t + 2;
+	}
+
+	slotFace[slot] = pHF;
+	slotOf[pHF] = slot;
+	dirtySlots.push_back(slot);
+	cellDirty[slotCell[slot]] = true;
+
+	bool hasRoom = true;
+	unsigned long long * edges = &slotEdges[slot * cornersPerFace];
+	for (int k = 0; k < cornersPerFace; k++)
+	{
+		edges[k] = keys[k];
+		hasRoom = addEdge(keys[k], points[k], points[(k + 1) % cornersPerFace], color, slotCell[slot], hasCentroids() ? c : NULL) && hasRoom;
+	}
+	return hasRoom;
+};
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef _MESHLIB_SURFACE_PROXY_H_
+#define _MESHLIB_SURFACE_PROXY_H_
+
+#include <math.h>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+
+#include "..\MeshLib\core\Geometry\Point.h"
+
+#include "VertexCache.h"
+
+namespace MeshLib
+{
+	/*!
+	* \brief CSurfaceProxy, a coarse triangle mesh standing in for the visible surface while the view moves
+	* \details Vertex i is at m_positions[3 * i], with the smooth normal m_normals[3 * i] and the group m_groups[i],
+	* \details triangle t is m_triangles[3 * t] ... m_triangles[3 * t + 2]. The versions are those of the mesh the
+	* \details proxy was built from, the proxy is only valid while they match.
+	* \details The triangles are ordered for the vertex cache, m_acmrBefore and m_acmrAfter are the cache misses per
+	* \details triangle of the order they were produced in and of the final one.
+	*/
+	class CSurfaceProxy
+	{
+	public:
+		CSurfaceProxy() { clear(); };
+
+		void clear()
+		{
+			m_positions.clear();
+			m_normals.clear();
+			m_groups.clear();
+			m_triangles.clear();
+			m_cutVersion = -1;
+			m_geometryVersion = -1;
+			m_acmrBefore = 0;
+			m_acmrAfter = 0;
+		};
+
+		void swap(CSurfaceProxy & other)
+		{
+			m_positions.swap(other.m_positions);
+			m_normals.swap(other.m_normals);
+			m_groups.swap(other.m_groups);
+			m_triangles.swap(other.m_triangles);
+			std::swap(m_cutVersion, other.m_cutVersion);
+			std::swap(m_geometryVersion, other.m_geometryVersion);
+			std::swap(m_acmrBefore, other.m_acmrBefore);
+			std::swap(m_acmrAfter, other.m_acmrAfter);
+		};
+
+		size_t numVertices() const { return m_groups.size(); };
+		size_t numTriangles() const { return m_triangles.size() / 3; };
+
+		std::vector<float> m_positions;
+		std::vector<float> m_normals;
+		std::vector<int> m_groups;
+		std::vector<int> m_triangles;
+
+		int m_cutVersion;
+		int m_geometryVersion;
+
+		double m_acmrBefore;
+		double m_acmrAfter;
+	};
+
+	/*!
+	* \brief CVertexClustering, simplifies a polygon soup by merging all vertices in a cell of a grid
+	* \details Every cell becomes one vertex at the mean of its corners, faces collapse to the triangles between
+	* \details distinct cells and duplicates are dropped. The cost is linear in the number of faces.
+	*/
+	class CVertexClustering
+	{
+	public:
+		// the grid has resolution cells along the longest side of the box [lo, hi], at most 127 so the indices fit 21 bits
+		void begin(const CPoint & lo, const CPoint & hi, int resolution)
+		{
+			m_resolution = std::min(std::max(resolution, 1), 127);
+
+			CPoint extent = hi - lo;
+			double side = std::max(std::max(extent[0], extent[1]), extent[2]);
+			m_cellWidth = std::max(side, 1e-12) / m_resolution;
+			m_lo = lo;
+
+			m_clusterOf.clear();
+			m_sums.clear();
+			m_normals.clear();
+			m_counts.clear();
+			m_groups.clear();
+			m_triangles.clear();
+			m_keys.clear();
+		};
+
+		// a convex polygon with n corners, the normal weighs the smooth normals of its clusters
+		void addFace(const CPoint * corners, int n, const CPoint & normal, int group)
+		{
+			int clusters[8];
+			for (int k = 0; k < n && k < 8; k++)
+			{
+				clusters[k] = _cluster(corners[k], normal, group);
+			}
+
+			// a fan, the triangles collapsed to an edge or a point vanish
+			for (int t = 0; t + 2 < n && t + 2 < 8; t++)
+			{
+				int a = clusters[0], b = clusters[t + 1], c = clusters[t + 2];
+				if (a == b || b == c || a == c)
+				{
+					continue;
+				}
+
+				// rotate the smallest index first, which keeps the orientation
+				while (a > b || a > c)
+				{
+					int s = a; a = b; b = c; c = s;
+				}
+				unsigned long long key = ((unsigned long long)a << 42) | ((unsigned long long)b << 21) | (unsigned long long)c;
+				if (m_keys.insert(key).second)
+				{
+					m_triangles.push_back(a);
+					m_triangles.push_back(b);
+					m_triangles.push_back(c);
+				}
+			}
+		};
+
+		void finish(CSurfaceProxy & proxy)
+		{
+			size_t n = m_counts.size();
+			proxy.m_positions.resize(3 * n);
+			proxy.m_normals.resize(3 * n);
+			proxy.m_groups = m_groups;
+			proxy.m_triangles = m_triangles;
+
+			for (size_t i = 0; i < n; i++)
+			{
+				CPoint p = m_sums[i] / (double)m_counts[i];
+				CPoint nrm = m_normals[i];
+				double len = nrm.norm();
+				if (len > 0)
+				{
+					nrm = nrm / len;
+				}
+				for (int j = 0; j < 3; j++)
+				{
+					proxy.m_positions[3 * i + j] = (float)p[j];
+					proxy.m_normals[3 * i + j] = (float)nrm[j];
+				}
+			}
+
+			// the triangles come in the order of the half face list, which jumps all over the surface
+			proxy.m_acmrBefore = CVertexCache::acmr(proxy.m_triangles, n);
+			CVertexCache::tipsify(proxy.m_triangles, n);
+			proxy.m_acmrAfter = CVertexCache::acmr(proxy.m_triangles, n);
+		};
+
+	protected:
+		int _cluster(const CPoint & p, const CPoint & normal, int group)
+		{
+			long long c[3];
+			for (int j = 0; j < 3; j++)
+			{
+				c[j] = (long long)floor((p[j] - m_lo[j]) / m_cellWidth);
+				c[j] = std::min(std::max(c[j], 0LL), (long long)m_resolution);
+			}
+			long long key = (c[2] * (m_resolution + 1) + c[1]) * (m_resolution + 1) + c[0];
+
+			std::unordered_map<long long, int>::iterator cIter = m_clusterOf.find(key);
+			int i;
+			if (cIter == m_clusterOf.end())
+			{
+				i = (int)m_counts.size();
+				m_clusterOf[key] = i;
+				m_sums.push_back(CPoint(0, 0, 0));
+				m_normals.push_back(CPoint(0, 0, 0));
+				m_counts.push_back(0);
+				m_groups.push_back(group);
+			}
+			else
+			{
+				i = cIter->second;
+			}
+
+			m_sums[i] = m_sums[i] + p;
+			m_normals[i] = m_normals[i] + normal;
+			m_counts[i]++;
+			return i;
+		};
+
+		CPoint m_lo;
+		double m_cellWidth;
+		int m_resolution;
+
+		std::unordered_map<long long, int> m_clusterOf;
+		std::vector<CPoint> m_sums;
+		std::vector<CPoint> m_normals;
+		std::vector<int> m_counts;
+		std::vector<int> m_groups;
+
+		std::vector<int> m_triangles;
+		std::unordered_set<unsigned long long> m_keys;
+	};
+};
+
+#endif
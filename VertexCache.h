@@ -0,0 +1,159 @@
+#ifndef _MESHLIB_VERTEX_CACHE_H_
+#define _MESHLIB_VERTEX_CACHE_H_
+
+#include <stddef.h>
+#include <vector>
+
+namespace MeshLib
+{
+	/*!
+	* \brief CVertexCache, orders the triangles of an indexed mesh for the post transform vertex cache of the GPU
+	* \details tipsify is the linear time ordering of Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex
+	* \details Locality and Reduced Overdraw": it fans around a vertex while its neighbors are still in a cache of
+	* \details cacheSize entries, and then moves to the vertex of the fan staying longest in the cache. acmr simulates a
+	* \details FIFO cache and returns the average cache misses per triangle, 3 at worst and about 0.5 at best.
+	*/
+	class CVertexCache
+	{
+	public:
+		static const int cacheSize = 16;
+
+		// the cache misses per triangle drawn in their order, triangle t is triangles[3 * t] ... triangles[3 * t + 2]
+		static double acmr(const std::vector<int> & triangles, size_t numVertices)
+		{
+			size_t nt = triangles.size() / 3;
+			if (nt == 0)
+			{
+				return 0.0;
+			}
+
+			// the time a vertex entered the cache, it is still in while fewer than cacheSize entered after it
+			std::vector<long long> entered(numVertices, -(long long)cacheSize - 1);
+			long long time = 0;
+			size_t misses = 0;
+			for (size_t i = 0; i < triangles.size(); i++)
+			{
+				int v = triangles[i];
+				if (time - entered[v] > cacheSize)
+				{
+					entered[v] = ++time;
+					misses++;
+				}
+			}
+			return (double)misses / nt;
+		};
+
+		// reorder the triangles in place, the triangles keep their orientation
+		static void tipsify(std::vector<int> & triangles, size_t numVertices)
+		{
+			size_t nt = triangles.size() / 3;
+			if (nt == 0)
+			{
+				return;
+			}
+
+			// the triangles around every vertex, and how many of them are not emitted yet
+			std::vector<int> first(numVertices + 1, 0);
+			for (size_t i = 0; i < triangles.size(); i++)
+			{
+				first[triangles[i] + 1]++;
+			}
+			for (size_t v = 0; v < numVertices; v++)
+			{
+				first[v + 1] += first[v];
+			}
+			std::vector<int> live(numVertices);
+			for (size_t v = 0; v < numVertices; v++)
+			{
+				live[v] = first[v + 1] - first[v];
+			}
+			std::vector<int> around(triangles.size());
+			std::vector<int> fill(first.begin(), first.end() - 1);
+			for (size_t i = 0; i < triangles.size(); i++)
+			{
+				around[fill[triangles[i]]++] = (int)(i / 3);
+			}
+
+			std::vector<int> cached(numVertices, 0);
+			std::vector<bool> emitted(nt, false);
+			std::vector<int> deadEnds;
+			std::vector<int> candidates;
+			std::vector<int> output;
+			output.reserve(triangles.size());
+
+			int time = cacheSize + 1;
+			int cursor = 1;
+			int fan = 0;
+			while (fan >= 0)
+			{
+				candidates.clear();
+				for (int a = first[fan]; a < first[fan + 1]; a++)
+				{
+					int t = around[a];
+					if (emitted[t])
+					{
+						continue;
+					}
+					for (int k = 0; k < 3; k++)
+					{
+						int v = triangles[3 * t + k];
+						output.push_back(v);
+						deadEnds.push_back(v);
+						candidates.push_back(v);
+						live[v]--;
+						if (time - cached[v] > cacheSize)
+						{
+							cached[v] = time++;
+						}
+					}
+					emitted[t] = true;
+				}
+
+				// the candidate longest in the cache that stays there while its remaining triangles are emitted
+				fan = -1;
+				int best = -1;
+				for (size_t c = 0; c < candidates.size(); c++)
+				{
+					int v = candidates[c];
+					if (live[v] <= 0)
+					{
+						continue;
+					}
+					int priority = 0;
+					if (time - cached[v] + 2 * live[v] <= cacheSize)
+					{
+						priority = time - cached[v];
+					}
+					if (priority > best)
+					{
+						best = priority;
+						fan = v;
+					}
+				}
+
+				// a dead end, go back to a recent vertex with triangles left, or to the next one in index order
+				while (fan < 0 && !deadEnds.empty())
+				{
+					int v = deadEnds.back();
+					deadEnds.pop_back();
+					if (live[v] > 0)
+					{
+						fan = v;
+					}
+				}
+				while (fan < 0 && cursor < (int)numVertices)
+				{
+					if (live[cursor] > 0)
+					{
+						fan = cursor;
+					}
+					cursor++;
+				}
+			}
+
+			triangles.swap(output);
+		};
+	};
+};
+
+#endif
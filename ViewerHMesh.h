@@ -7,6 +7,13 @@
 #include "..\MeshLib\core\Parser\strutil.h"
 #include "..\MeshLib\core\Parser\parser.h"
 
+#include "MeshArrays.h"
+#include "CrossSection.h"
+#include "ImplicitSurface.h"
+#include "AABBTree.h"
+#include "Profile.h"
+#include "SurfaceProxy.h"
+
 namespace MeshLib
 {
 	namespace HMeshLib
@@ -15,7 +22,7 @@ namespace MeshLib
 		class CHViewerVertex : public CVertex
 		{
 		public:
-			CHViewerVertex() { m_outside = false; m_selected = false; m_cut = false; m_boundary = false;};
+			CHViewerVertex() { m_outside = false; m_selected = false; m_cut = false; m_boundary = false; m_index = -1; };
 			~CHViewerVertex(){};
 
 			bool & boundary() { return m_boundary; };
@@ -23,6 +30,10 @@ namespace MeshLib
 			bool & selected() { return m_selected; };
 			bool & cut() { return m_cut; };
 			CPoint2 & uv() { return m_uv; };
+
+			//!< position of the vertex in the mesh arrays
+			int & index() { return m_index; };
+
 			void _from_string()
 			{
 				CParser parser(m_string);
@@ -43,6 +54,7 @@ namespace MeshLib
 			bool m_selected;
 			CPoint2 m_uv;
 			bool m_cut;
+			int m_index;
 		};
 
 		/*!
@@ -120,10 +132,13 @@ namespace MeshLib
 		class CHViewerHex : public CHex
 		{
 		public:
-			CHViewerHex() { m_outside = false; };
+			CHViewerHex() { m_outside = false; m_index = -1; };
 			~CHViewerHex(){};
 			bool & outside() { return m_outside; };
 
+			//!< position of the hex in the mesh arrays
+			int & index() { return m_index; };
+
 			CPoint & vector() { return m_vector; };
 
 			void _from_string()
@@ -141,21 +156,19 @@ namespace MeshLib
 
 		protected:
 			bool m_outside;
+			int m_index;
 			CPoint m_vector;
 		};
 
 		/*!
 		* \brief CViewerHalfFace, HalfFace for viewer purpose
+		* \details The normal is computed on demand by CViewerHMesh::_halfface_normal, like for the tet mesh.
 		*/
 		class CHViewerHalfFace : public CHalfFace
 		{
 		public:
 			CHViewerHalfFace(){};
 			~CHViewerHalfFace(){};
-			CPoint & normal() { return m_normal; };
-
-		protected:
-			CPoint m_normal;
 		};
 
 
@@ -190,12 +203,82 @@ namespace MeshLib
 			// normalize the hex mesh
 			void _normalize();
 
-			void _halfface_normal();
+			// unit normal of the half face, the mean of the normals of its two triangles
+			CPoint _halfface_normal(HF * pHF);
 
 			void _cut(CPlane & p);
 
+			// classify the mesh against the plane into the back buffers, safe to run off the GUI thread
+			void _cutBack(CPlane & p);
+
+			// classify the mesh against any implicit surface into the back buffers
+			void _cutBack(CImplicitSurface & s);
+
+			// swap the back buffers filled by _cutBack with the visible ones and relabel the cut faces
+			void _swapCutBuffers();
+
+			// simplify the visible surface by vertex clustering into proxy, gives up and returns false once *cancel is set
+			bool _buildProxy(int resolution, const volatile bool * cancel, CSurfaceProxy & proxy);
+
+			// extract the boundary half faces and vertices, only rescans the mesh after _invalidateBoundary()
 			void _labelBoundary();
 
+			// the cached boundary has to be rebuilt, called by _index and whenever the topology changes
+			void _invalidateBoundary() { m_boundaryDirty = true; m_belowBoundaryVersion = -1; };
+
+			// bumped by every swap of the cut buffers, renderers compare it to decide when to rebuild
+			int cutVersion() const { return m_cutVersion; };
+			// bumped whenever positions or face colors of the visible faces change
+			int geometryVersion() const { return m_geometryVersion; };
+			void _touchGeometry() { m_geometryVersion++; };
+			// bumped whenever vertices are selected or unselected
+			int selectionVersion() const { return m_selectionVersion; };
+			void _touchSelection() { m_selectionVersion++; };
+
+			// half faces without dual, and the vertices on them
+			std::vector<CHalfFace*> & boundaryHalfFaces() { _labelBoundary(); return m_boundaryHalfFaces; };
+			std::vector<CVertex*> & boundaryVertices() { _labelBoundary(); return m_boundaryVertices; };
+			// the boundary half faces among m_pHFaces_Below, filtered again only after a cut
+			std::vector<CHalfFace*> & belowBoundaryHalfFaces();
+
+			// copy the vertices and hexes into m_arrays and build the element tree, needs to be called again after vertices move
+			void _index();
+
+			// compute the exact cross section with the plane
+			void _section(CPlane & p, CCrossSection & section);
+
+			// sample the cross section area and the volume below along the axis, per group
+			void _profile(const CPoint & axis, double offsetMin, double offsetMax, int samples, CProfile & profile);
+
+			// the cross section is computed along with every cut only when enabled
+			bool & sectionEnabled() { return m_sectionEnabled; };
+			// the half faces of the hexes below the cut are gathered along with every cut only when enabled
+			bool & elementsEnabled() { return m_elementsEnabled; };
+
+			// the half faces that entered and left a face list with the last swap, m_known is false if the list before
+			// the cut is not known, like before the first cut
+			struct CListChanges
+			{
+				std::vector<CHalfFace*> m_entered;
+				std::vector<CHalfFace*> m_left;
+				bool m_known;
+
+				CListChanges() { m_known = false; };
+				void clear() { m_entered.clear(); m_left.clear(); m_known = false; };
+				void swap(CListChanges & other) { m_entered.swap(other.m_entered); m_left.swap(other.m_left); std::swap(m_known, other.m_known); };
+			};
+
+			// the changes of m_pHFaces_Below, m_pHFaces_Above or m_pHFaces_Elements with the last swap, NULL for any other
+			// list or if they are not known
+			CListChanges * cutChanges(const std::vector<CHalfFace*> & halffaces)
+			{
+				CListChanges * changes = NULL;
+				if (&halffaces == &m_pHFaces_Below) changes = &m_belowChanges;
+				else if (&halffaces == &m_pHFaces_Above) changes = &m_aboveChanges;
+				else if (&halffaces == &m_pHFaces_Elements) changes = &m_elementsChanges;
+				return (changes != NULL && changes->m_known) ? changes : NULL;
+			};
+
 			void _write_hm_samepoint(const char * output, std::map<int, int> vertexIdMap);
 
 			void _write_above_surface_qm(const char * output);
@@ -210,8 +293,13 @@ namespace MeshLib
 			void _write_surface_qm(const char * output);
 			void _write_surface_obj(const char * output);
 
-			void _write_qm(const char * output, std::vector<CVertex*> vertices, std::vector<CHalfFace*> halffaces);
-			void _write_obj(const char * output, std::vector<CVertex*> vertices, std::vector<CHalfFace*> halffaces);
+			// write the exact cross section of the current cut, which is the plane p oriented as the cut keeps it,
+			// the section shown is written as it is, otherwise it is computed for p
+			void _write_section_m(const char * output, CPlane & p);
+			void _write_section_obj(const char * output, CPlane & p);
+
+			void _write_qm(const char * output, std::vector<CVertex*> & vertices, std::vector<CHalfFace*> & halffaces);
+			void _write_obj(const char * output, std::vector<CVertex*> & vertices, std::vector<CHalfFace*> & halffaces);
 
 		public:
 			std::vector<CHalfFace*> m_pHFaces_Above;
@@ -219,12 +307,84 @@ namespace MeshLib
 			std::vector<CFace *> m_cutFaces;
 			std::vector<CFace *> m_selectedFacesList;
 			std::vector<CVertex *> m_selectedVertices;
+
+			// back buffers of the face lists, written by _cutBack
+			std::vector<CHalfFace*> m_pHFaces_AboveBack;
+			std::vector<CHalfFace*> m_pHFaces_BelowBack;
+			std::vector<CFace *> m_cutFacesBack;
+
+			// all six half faces of every hex below the cut, in the order of the tree, and its back buffer
+			std::vector<CHalfFace*> m_pHFaces_Elements;
+			std::vector<CHalfFace*> m_pHFaces_ElementsBack;
+
+			// the changes of the face lists with the current cut, and their back buffers
+			CListChanges m_belowChanges, m_belowChangesBack;
+			CListChanges m_aboveChanges, m_aboveChangesBack;
+			CListChanges m_elementsChanges, m_elementsChangesBack;
+
+			// exact cross section of the current cut, and its back buffer
+			CCrossSection m_section;
+			CCrossSection m_sectionBack;
+
+			// coarse stand in for m_pHFaces_Below while the view moves, and its back buffer
+			CSurfaceProxy m_proxy;
+			CSurfaceProxy m_proxyBack;
+
+			CMeshArrays m_arrays;
+
+			// hexes in the order of m_arrays, and the tree over them
+			std::vector<CHex*> m_hexArray;
+			CAABBTree m_tree;
+
+		protected:
+			// the boundary half faces among halffaces
+			void _boundaryHalfFaces(std::vector<CHalfFace*> & halffaces, std::vector<CHalfFace*> & boundary);
+
+			// the vertices of the half faces, each once in the order they are first used
+			void _faceVertices(std::vector<CHalfFace*> & halffaces, std::vector<CVertex*> & vertices);
+
+			std::vector<CHalfFace*> m_boundaryHalfFaces;
+			std::vector<CVertex*> m_boundaryVertices;
+			bool m_boundaryDirty = true;
+
+			std::vector<CHalfFace*> m_belowBoundaryHalfFaces;
+			int m_belowBoundaryVersion = -1;
+
+			bool m_sectionEnabled = false;
+			bool m_elementsEnabled = false;
+			CSliceKernel m_sliceKernel;
+
+			// scratch of _cutBack, the side of every vertex evaluated during the cut with stamp m_cutStamp
+			std::vector<CAABBTree::CRange> m_outsideRanges, m_insideRanges, m_uncertainRanges;
+			std::vector<int> m_vertexStamp;
+			std::vector<bool> m_vertexOutside;
+			int m_cutStamp = 0;
+			// the outside flags of the cut swapped in last by element index, a cut has been computed, and the elements
+			// were gathered by it
+			std::vector<bool> m_outsideBefore;
+			bool m_hasCut = false;
+			bool m_elementsGathered = false;
+
+			// the list a half face is in by the flags of its element and of the one behind it, 0 none, 1 below, 2 above
+			static int _faceSide(bool outside, bool dualOutside) { return (outside == dualOutside) ? 0 : (outside ? 2 : 1); };
+
+			int m_cutVersion = 0;
+			int m_geometryVersion = 0;
+			int m_selectionVersion = 0;
 		};
 
 
 		template<typename HXV, typename V, typename HE, typename HXE, typename E, typename HF, typename F, typename HX>
 		void CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_labelBoundary()
 		{
+			if (!m_boundaryDirty)
+			{
+				return;
+			}
+
+			m_boundaryHalfFaces.clear();
+			m_boundaryVertices.clear();
+
 			for (std::list<CVertex*>::iterator vIter = m_pVertices.begin(); vIter != m_pVertices.end(); vIter++)
 			{
 				CVertex * pV = *vIter;
@@ -239,16 +399,71 @@ namespace MeshLib
 					continue;
 				}
 
+				m_boundaryHalfFaces.push_back(pHF);
+
 				CHalfEdge *pHE = HalfFaceHalfEdge(pHF);
 				for (int k = 0; k < 4; k++)
 				{
 					CVertex * pV = HalfEdgeTarget(pHE);
-					pV->boundary() = true;
+					if (!pV->boundary())
+					{
+						pV->boundary() = true;
+						m_boundaryVertices.push_back(pV);
+					}
+					pHE = HalfEdgeNext(pHE);
+				}
+			}
+
+			m_boundaryDirty = false;
+		};
+
+		template<typename HXV, typename V, typename HE, typename HXE, typename E, typename HF, typename F, typename HX>
+		void CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_boundaryHalfFaces(std::vector<CHalfFace*> & halffaces, std::vector<CHalfFace*> & boundary)
+		{
+			boundary.clear();
+			for (std::vector<CHalfFace*>::iterator hfIter = halffaces.begin(); hfIter != halffaces.end(); hfIter++)
+			{
+				CHalfFace * pHF = *hfIter;
+				if (HalfFaceDual(pHF) == NULL)
+				{
+					boundary.push_back(pHF);
+				}
+			}
+		};
+
+		template<typename HXV, typename V, typename HE, typename HXE, typename E, typename HF, typename F, typename HX>
+		void CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_faceVertices(std::vector<CHalfFace*> & halffaces, std::vector<CVertex*> & vertices)
+		{
+			// the vertices are marked by their index, which _index assigned
+			std::vector<bool> isAdded(m_pVertices.size(), false);
+			vertices.clear();
+			for (std::vector<CHalfFace*>::iterator hfIter = halffaces.begin(); hfIter != halffaces.end(); hfIter++)
+			{
+				CHalfEdge * pHE = HalfFaceHalfEdge(*hfIter);
+				for (int k = 0; k < 4; k++)
+				{
+					CVertex * pV = HalfEdgeTarget(pHE);
+					if (!isAdded[pV->index()])
+					{
+						isAdded[pV->index()] = true;
+						vertices.push_back(pV);
+					}
 					pHE = HalfEdgeNext(pHE);
 				}
 			}
 		};
 
+		template<typename HXV, typename V, typename HE, typename HXE, typename E, typename HF, typename F, typename HX>
+		std::vector<HF*> & CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::belowBoundaryHalfFaces()
+		{
+			if (m_belowBoundaryVersion != m_cutVersion)
+			{
+				_boundaryHalfFaces(m_pHFaces_Below, m_belowBoundaryHalfFaces);
+				m_belowBoundaryVersion = m_cutVersion;
+			}
+			return m_belowBoundaryHalfFaces;
+		};
+
 
 		template<typename HXV, typename V, typename HE, typename HXE, typename E, typename HF, typename F, typename HX>
 		void CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_write_hm_samepoint(const char * output, std::map<int, int> vertexIdMap)
@@ -340,234 +555,43 @@ namespace MeshLib
 		template<typename HXV, typename V, typename HE, typename HXE, typename E, typename HF, typename F, typename HX>
 		void CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_write_surface_qm(const char * output)
 		{
-
-			_labelBoundary();
-
-			std::vector<CVertex*> vertices;
-
-			for (std::list<CVertex*>::iterator vIter = m_pVertices.begin(); vIter != m_pVertices.end(); vIter++)
-			{
-				CVertex * pV = *vIter;
-				if (pV->boundary())
-				{
-					vertices.push_back(pV);
-				}
-			}
-
-			std::fstream _os(output, std::fstream::out);
-			if (_os.fail())
-			{
-				fprintf(stderr, "Error is opening file %s\n", output);
-				return;
-			}
-
-			for (std::vector<CVertex*>::iterator vIter = vertices.begin(); vIter != vertices.end(); vIter++)
-			{
-				CVertex * pV = *vIter;
-				CPoint p = pV->position();
-				_os << "Vertex " << pV->id() << " " << p << std::endl;
-			}
-
-			int faceid = 1;
-			for (std::list<HF*>::iterator hiter = m_pHalfFaces.begin(); hiter != m_pHalfFaces.end(); hiter++, faceid++)
-			{
-				CHalfFace *pHF = *hiter;
-				if (HalfFaceDual(pHF) != NULL)
-				{
-					continue;
-				}
-
-				_os << "Face " << faceid << " ";
-				CHalfEdge *pHE = HalfFaceHalfEdge(pHF);
-				for (int k = 0; k < 4; k++)
-				{
-					CVertex * pV = HalfEdgeTarget(pHE);
-					_os << pV->id() << " ";
-					pHE = HalfEdgeNext(pHE);
-				}
-				_os << std::endl;
-			}
-
-			_os.close();
+			_write_qm(output, boundaryVertices(), boundaryHalfFaces());
 		};
 
 		template<typename HXV, typename V, typename HE, typename HXE, typename E, typename HF, typename F, typename HX>
 		void CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_write_surface_obj(const char * output)
 		{
-
-			_labelBoundary();
-
-			std::fstream _os(output, std::fstream::out);
-			if (_os.fail())
-			{
-				fprintf(stderr, "Error is opening file %s\n", output);
-				return;
-			}
-
-			std::vector<CVertex*> vertices;
-
-			for (std::list<CVertex*>::iterator vIter = m_pVertices.begin(); vIter != m_pVertices.end(); vIter++)
-			{
-				CVertex * pV = *vIter;
-				if (pV->boundary())
-				{
-					vertices.push_back(pV);
-				}
-			}
-
-			int vid = 1;
-
-			for (std::vector<CVertex*>::iterator vIter = vertices.begin(); vIter != vertices.end(); vIter++)
-			{
-				CVertex * pV = *vIter;
-				pV->id() = vid++;
-			}
-
-			_os << "# Generated by VolumeViewerQt" << std::endl;
-
-			for (std::vector<CVertex*>::iterator vIter = vertices.begin(); vIter != vertices.end(); vIter++)
-			{
-				CVertex * pV = *vIter;
-				CPoint p = pV->position();
-				_os << "v " << p << std::endl;
-			}
-
-			for (std::list<HF*>::iterator hiter = m_pHalfFaces.begin(); hiter != m_pHalfFaces.end(); hiter++)
-			{
-				CHalfFace *pHF = *hiter;
-				if (HalfFaceDual(pHF) != NULL)
-				{
-					continue;
-				}
-
-				_os << "f ";
-				CHalfEdge *pHE = HalfFaceHalfEdge(pHF);
-				for (int k = 0; k < 4; k++)
-				{
-					CVertex * pV = HalfEdgeTarget(pHE);
-					_os << pV->id() << " ";
-					pHE = HalfEdgeNext(pHE);
-				}
-				_os << std::endl;
-			}
-
-			_os.close();
+			_write_obj(output, boundaryVertices(), boundaryHalfFaces());
 		};
 
 		template<typename HXV, typename V, typename HE, typename HXE, typename E, typename HF, typename F, typename HX>
 		void CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_write_above_surface_obj(const char * output)
 		{
-
 			std::vector<CHalfFace*> outputHalfFaces;
+			_boundaryHalfFaces(m_pHFaces_Above, outputHalfFaces);
 			std::vector<CVertex*> vertices;
-
-			for (std::vector<CHalfFace*>::iterator fIter = m_pHFaces_Above.begin(); fIter != m_pHFaces_Above.end(); fIter++)
-			{
-				CHalfFace * pHF = *fIter;
-				if (HalfFaceDual(pHF) != nullptr) {
-					continue;
-				}
-				outputHalfFaces.push_back(pHF);
-			}
-
-			for (std::vector<CHalfFace*>::iterator hfIter = outputHalfFaces.begin(); hfIter != outputHalfFaces.end(); hfIter++)
-			{
-				CHalfFace * pHF = *hfIter;
-				CHalfEdge *pHE = HalfFaceHalfEdge(pHF);
-				for (int k = 0; k < 4; k++)
-				{
-					CVertex * pV = HalfEdgeTarget(pHE);
-					if (std::find(vertices.begin(), vertices.end(), pV) != vertices.end())
-					{
-						vertices.push_back(pV);
-					}
-					pHE = HalfEdgeNext(pHE);
-				}
-			}
-
-			int vid = 1;
-			for (std::vector<CVertex*>::iterator vIter = vertices.begin(); vIter != vertices.end(); vIter++)
-			{
-				CVertex * pV = *vIter;
-				pV->id() = vid++;
-			}
+			_faceVertices(outputHalfFaces, vertices);
 
 			_write_obj(output, vertices, outputHalfFaces);
-
 		};
 
 		template<typename HXV, typename V, typename HE, typename HXE, typename E, typename HF, typename F, typename HX>
 		void CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_write_above_surface_qm(const char * output)
 		{
 			std::vector<CHalfFace*> outputHalfFaces;
+			_boundaryHalfFaces(m_pHFaces_Above, outputHalfFaces);
 			std::vector<CVertex*> vertices;
-
-			for (std::vector<CHalfFace*>::iterator fIter = m_pHFaces_Above.begin(); fIter != m_pHFaces_Above.end(); fIter++)
-			{
-				CHalfFace * pHF = *fIter;
-				if (HalfFaceDual(pHF) != nullptr) {
-					continue;
-				}
-				outputHalfFaces.push_back(pHF);
-			}
-
-			for (std::vector<CHalfFace*>::iterator hfIter = outputHalfFaces.begin(); hfIter != outputHalfFaces.end(); hfIter++)
-			{
-				CHalfFace * pHF = *hfIter;
-				CHalfEdge *pHE = HalfFaceHalfEdge(pHF);
-				for (int k = 0; k < 4; k++)
-				{
-					CVertex * pV = HalfEdgeTarget(pHE);
-					if (std::find(vertices.begin(), vertices.end(), pV) != vertices.end())
-					{
-						vertices.push_back(pV);
-					}
-					pHE = HalfEdgeNext(pHE);
-				}
-			}
+			_faceVertices(outputHalfFaces, vertices);
 
 			_write_qm(output, vertices, outputHalfFaces);
-			
-
 		};
 		
 		template<typename HXV, typename V, typename HE, typename HXE, typename E, typename HF, typename F, typename HX>
 		void CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_write_below_surface_obj(const char * output)
 		{
-		
-			std::vector<CHalfFace*> outputHalfFaces;
+			std::vector<CHalfFace*> & outputHalfFaces = belowBoundaryHalfFaces();
 			std::vector<CVertex*> vertices;
-
-			for (std::vector<CHalfFace*>::iterator fIter = m_pHFaces_Below.begin(); fIter != m_pHFaces_Below.end(); fIter++)
-			{
-				CHalfFace * pHF = *fIter;
-				if (HalfFaceDual(pHF) != nullptr) {
-					continue;
-				}
-				outputHalfFaces.push_back(pHF);
-			}
-
-			for (std::vector<CHalfFace*>::iterator hfIter = outputHalfFaces.begin(); hfIter != outputHalfFaces.end(); hfIter++)
-			{
-				CHalfFace * pHF = *hfIter;
-				CHalfEdge *pHE = HalfFaceHalfEdge(pHF);
-				for (int k = 0; k < 4; k++)
-				{
-					CVertex * pV = HalfEdgeTarget(pHE);
-					if (std::find(vertices.begin(), vertices.end(), pV) != vertices.end())
-					{
-						vertices.push_back(pV);
-					}
-					pHE = HalfEdgeNext(pHE);
-				}
-			}
-
-			int vid = 1;
-			for (std::vector<CVertex*>::iterator vIter = vertices.begin(); vIter != vertices.end(); vIter++)
-			{
-				CVertex * pV = *vIter;
-				pV->id() = vid++;
-			}
+			_faceVertices(outputHalfFaces, vertices);
 
 			_write_obj(output, vertices, outputHalfFaces);
 		};
@@ -575,33 +599,9 @@ namespace MeshLib
 		template<typename HXV, typename V, typename HE, typename HXE, typename E, typename HF, typename F, typename HX>
 		void CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_write_below_surface_qm(const char * output)
 		{
-			
-			std::vector<CHalfFace*> outputHalfFaces;
+			std::vector<CHalfFace*> & outputHalfFaces = belowBoundaryHalfFaces();
 			std::vector<CVertex*> vertices;
-
-			for (std::vector<CHalfFace*>::iterator fIter = m_pHFaces_Below.begin(); fIter != m_pHFaces_Below.end(); fIter++)
-			{
-				CHalfFace * pHF = *fIter;
-				if (HalfFaceDual(pHF) != nullptr) {
-					continue;
-				}
-				outputHalfFaces.push_back(pHF);
-			}
-
-			for (std::vector<CHalfFace*>::iterator hfIter = outputHalfFaces.begin(); hfIter != outputHalfFaces.end(); hfIter++)
-			{
-				CHalfFace * pHF = *hfIter;
-				CHalfEdge *pHE = HalfFaceHalfEdge(pHF);
-				for (int k = 0; k < 4; k++)
-				{
-					CVertex * pV = HalfEdgeTarget(pHE);
-					if (std::find(vertices.begin(), vertices.end(), pV) != vertices.end())
-					{
-						vertices.push_back(pV);
-					}
-					pHE = HalfEdgeNext(pHE);
-				}
-			}
+			_faceVertices(outputHalfFaces, vertices);
 
 			_write_qm(output, vertices, outputHalfFaces);
 		};
@@ -652,104 +652,143 @@ namespace MeshLib
 		};
 
 		template<typename HXV, typename V, typename HE, typename HXE, typename E, typename HF, typename F, typename HX>
-		void CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_halfface_normal()
+		CPoint CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_halfface_normal(HF * pHF)
 		{
-			for (std::list<HF*>::iterator hiter = m_pHalfFaces.begin(); hiter != m_pHalfFaces.end(); hiter++)
+			HE *pHE = HalfFaceHalfEdge(pHF);
+			CPoint ps[4];
+			for (int k = 0; k < 4; k++)
 			{
-				HF *pHF = *hiter;
-				HE *pHE = HalfFaceHalfEdge(pHF);
-				std::vector<CPoint> ps;
-				for (int k = 0; k < 4; k++)
-				{
-					ps.push_back(HalfEdgeTarget(pHE)->position());
-					pHE = HalfEdgeNext(pHE);
-				}
-				CPoint n0 = (ps[1] - ps[0]) ^ (ps[2] - ps[0]);
-				CPoint n1 = (ps[2] - ps[0]) ^ (ps[3] - ps[0]);
-				CPoint n = (n0 + n1) / 2;
-				n = n / n.norm();
-				pHF->normal() = n;
+				ps[k] = HalfEdgeTarget(pHE)->position();
+				pHE = HalfEdgeNext(pHE);
 			}
+			CPoint n0 = (ps[1] - ps[0]) ^ (ps[2] - ps[0]);
+			CPoint n1 = (ps[2] - ps[0]) ^ (ps[3] - ps[0]);
+			CPoint n = (n0 + n1) / 2;
+			double len = n.norm();
+			return len > 0 ? n / len : n;
 		};
 
 		template<typename HXV, typename V, typename HE, typename HXE, typename E, typename HF, typename F, typename HX>
 		void CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_cut(CPlane & p)
 		{
+			_cutBack(p);
+			_swapCutBuffers();
+		};
 
-			m_pHFaces_Above.clear();
-			m_pHFaces_Below.clear();
-			m_cutFaces.clear();
+		template<typename HXV, typename V, typename HE, typename HXE, typename E, typename HF, typename F, typename HX>
+		void CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_cutBack(CPlane & p)
+		{
+			CImplicitPlane surface(p);
+			_cutBack(surface);
+		};
 
-			for (std::list<V*>::iterator vIter = m_pVertices.begin(); vIter != m_pVertices.end(); vIter++)
+		template<typename HXV, typename V, typename HE, typename HXE, typename E, typename HF, typename F, typename HX>
+		void CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_cutBack(CImplicitSurface & s)
+		{
+			// only the outside flags and the back buffers are written here, everything
+			// the viewer reads while drawing or picking is left untouched until the swap
+
+			m_pHFaces_AboveBack.clear();
+			m_pHFaces_BelowBack.clear();
+			m_cutFacesBack.clear();
+			m_pHFaces_ElementsBack.clear();
+			m_belowChangesBack.clear();
+			m_aboveChangesBack.clear();
+			m_elementsChangesBack.clear();
+
+			// the lists change against the flags of the cut swapped in last
+			m_outsideBefore.resize(m_hexArray.size());
+			for (size_t e = 0; e < m_hexArray.size(); e++)
 			{
-				V * pV = *vIter;
-				pV->cut() = false;
-				CPoint pos = pV->position();
-				pV->outside() = (p.side(pos) >= 0);
+				m_outsideBefore[e] = m_hexArray[e]->outside();
 			}
 
-			for (std::list<HX*>::iterator tIter = m_pHexs.begin(); tIter != m_pHexs.end(); tIter++)
-			{
-				HX * pT = *tIter;
-
-				V * pV[8];
-
-				for (int k = 0; k < 8; k++)
-					pV[k] = HexVertex(pT, k);
-
+			// whole subtrees away from the surface are labeled at once
+			m_tree.classify(s, m_outsideRanges, m_insideRanges, m_uncertainRanges);
 
-				pT->outside() = true;
-				for (int j = 0; j < 8; j++)
+			for (size_t r = 0; r < m_outsideRanges.size(); r++)
+			{
+				for (int i = m_outsideRanges[r].first; i < m_outsideRanges[r].first + m_outsideRanges[r].second; i++)
 				{
-					if (!pV[j]->outside())
-					{
-						pT->outside() = false;
-						break;
-					}
+					m_hexArray[m_tree.m_order[i]]->outside() = true;
 				}
 			}
 
-			for (std::list<F*>::iterator fIter = m_pFaces.begin(); fIter != m_pFaces.end(); fIter++)
+			for (size_t r = 0; r < m_insideRanges.size(); r++)
 			{
-				F * pF = *fIter;
-				pF->cut() = false;
+				for (int i = m_insideRanges[r].first; i < m_insideRanges[r].first + m_insideRanges[r].second; i++)
+				{
+					m_hexArray[m_tree.m_order[i]]->outside() = false;
+				}
 			}
 
-			for (std::list<HF *>::iterator fIter = m_pHalfFaces.begin(); fIter != m_pHalfFaces.end(); fIter++)
+			// only the hexes of the leaves close to the surface evaluate their vertices, each vertex at most once
+			m_cutStamp++;
+			m_vertexStamp.resize(m_arrays.numVertices(), 0);
+			m_vertexOutside.resize(m_arrays.numVertices(), false);
+
+			for (size_t r = 0; r < m_uncertainRanges.size(); r++)
 			{
-				HF * pHF = *fIter;
+				for (int i = m_uncertainRanges[r].first; i < m_uncertainRanges[r].first + m_uncertainRanges[r].second; i++)
+				{
+					int e = m_tree.m_order[i];
+					const int * ev = &m_arrays.m_elements[e * 8];
 
-				HF * pHFD = HalfFaceDual(pHF);
+					bool outside = true;
+					for (int k = 0; k < 8 && outside; k++)
+					{
+						int v = ev[k];
+						if (m_vertexStamp[v] != m_cutStamp)
+						{
+							m_vertexStamp[v] = m_cutStamp;
+							m_vertexOutside[v] = (s.value(CPoint(m_arrays.m_x[v], m_arrays.m_y[v], m_arrays.m_z[v])) >= 0);
+						}
+						outside = m_vertexOutside[v];
+					}
 
-				F * pF = HalfFaceFace(pHF);
+					m_hexArray[e]->outside() = outside;
+				}
+			}
 
-				if (pHF != NULL && pHFD != NULL)
+			// the interior hexes kept by the cut are drawn as well when shrunk, neighbours in the tree stay close
+			if (m_elementsEnabled)
+			{
+				for (size_t i = 0; i < m_tree.m_order.size(); i++)
 				{
-					HX * pT_l = HalfFaceHex(pHF);
-					HX * pT_r = HalfFaceHex(pHFD);
-					if (pT_l->outside() != pT_r->outside() && !pF->cut())
+					HX * pH = m_hexArray[m_tree.m_order[i]];
+					if (pH->outside())
 					{
-						m_cutFaces.push_back(pF);
-						pF->cut() = true;
+						continue;
+					}
+					for (TetHFIterator hfIter(this, pH); !hfIter.end(); ++hfIter)
+					{
+						m_pHFaces_ElementsBack.push_back(*hfIter);
 					}
 				}
 			}
 
-			for (std::vector<F*>::iterator fIter = m_cutFaces.begin(); fIter != m_cutFaces.end(); fIter++)
+			// only the elements whose flag flipped bring their faces in or take them out
+			if (m_elementsEnabled && m_elementsGathered)
 			{
-				F * pF = *fIter;
-				HF * pHF = FaceLeftHalfFace(pF);
-				HE * pHE = HalfFaceHalfEdge(pHF);
-				HE * pHE2 = HalfEdgeNext(pHE);
-				HE * pHE3 = HalfEdgeNext(pHE2);
-
-				V * pV = HalfEdgeTarget(pHE);
-				V * pV2 = HalfEdgeTarget(pHE2);
-				V * pV3 = HalfEdgeTarget(pHE3);
-				pV->cut() = true;
-				pV2->cut() = true;
-				pV3->cut() = true;
+				m_elementsChangesBack.m_known = true;
+				for (size_t e = 0; e < m_hexArray.size(); e++)
+				{
+					HX * pT = m_hexArray[e];
+					if (pT->outside() == m_outsideBefore[e])
+					{
+						continue;
+					}
+					std::vector<CHalfFace*> & changed = pT->outside() ? m_elementsChangesBack.m_left : m_elementsChangesBack.m_entered;
+					for (TetHFIterator hfIter(this, pT); !hfIter.end(); ++hfIter)
+					{
+						changed.push_back(*hfIter);
+					}
+				}
 			}
+			m_elementsGathered = m_elementsEnabled;
+
+			m_belowChangesBack.m_known = m_hasCut;
+			m_aboveChangesBack.m_known = m_hasCut;
 
 			for (std::list<HF*>::iterator it = m_pHalfFaces.begin(); it != m_pHalfFaces.end(); it++)
 			{
@@ -757,36 +796,226 @@ namespace MeshLib
 				HF * pD = HalfFaceDual(pF);
 				HX  * pT = HalfFaceHex(pF);
 
-				if (pD == NULL)
+				// a boundary face goes with its element, as if the missing one behind it were on the other side
+				bool outside = pT->outside();
+				bool dualOutside = (pD == NULL) ? !outside : HalfFaceHex(pD)->outside();
+				int side = _faceSide(outside, dualOutside);
+
+				if (side == 2)
 				{
-					if (pT->outside())
+					m_pHFaces_AboveBack.push_back(pF);
+				}
+				else if (side == 1)
+				{
+					m_pHFaces_BelowBack.push_back(pF);
+
+					// every cut face has exactly one half face below the plane
+					if (pD != NULL)
 					{
-						m_pHFaces_Above.push_back(pF);
+						m_cutFacesBack.push_back(HalfFaceFace(pF));
 					}
-					else
+				}
+
+				if (!m_hasCut)
+				{
+					continue;
+				}
+
+				bool outsideBefore = m_outsideBefore[pT->index()];
+				bool dualOutsideBefore = (pD == NULL) ? !outsideBefore : m_outsideBefore[HalfFaceHex(pD)->index()];
+				int sideBefore = _faceSide(outsideBefore, dualOutsideBefore);
+				if (sideBefore != side)
+				{
+					if (sideBefore != 0)
 					{
-						m_pHFaces_Below.push_back(pF);
+						(sideBefore == 1 ? m_belowChangesBack : m_aboveChangesBack).m_left.push_back(pF);
 					}
-					continue;
+					if (side != 0)
+					{
+						(side == 1 ? m_belowChangesBack : m_aboveChangesBack).m_entered.push_back(pF);
+					}
+				}
+			}
+			m_hasCut = true;
+
+			CPlane plane;
+			if (m_sectionEnabled && s.isPlane(plane))
+			{
+				_section(plane, m_sectionBack);
+			}
+			else
+			{
+				m_sectionBack.clear();
+			}
+		};
+
+		template<typename HXV, typename V, typename HE, typename HXE, typename E, typename HF, typename F, typename HX>
+		void CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_index()
+		{
+			_touchGeometry();
+			_invalidateBoundary();
+
+			m_arrays.clear();
+			m_arrays.m_verticesPerElement = 8;
+			m_hexArray.clear();
+
+			int index = 0;
+			for (std::list<V*>::iterator vIter = m_pVertices.begin(); vIter != m_pVertices.end(); vIter++)
+			{
+				V * pV = *vIter;
+				pV->index() = index++;
+
+				CPoint p = pV->position();
+				m_arrays.m_x.push_back(p[0]);
+				m_arrays.m_y.push_back(p[1]);
+				m_arrays.m_z.push_back(p[2]);
+				m_arrays.m_u.push_back(pV->uv()[0]);
+				m_arrays.m_v.push_back(pV->uv()[1]);
+			}
+
+			for (std::list<HX*>::iterator hIter = m_pHexs.begin(); hIter != m_pHexs.end(); hIter++)
+			{
+				HX * pH = *hIter;
+				for (int k = 0; k < 8; k++)
+				{
+					m_arrays.m_elements.push_back(HexVertex(pH, k)->index());
 				}
+				// hexes carry no group
+				m_arrays.m_groups.push_back(0);
+				pH->index() = (int)m_hexArray.size();
+				m_hexArray.push_back(pH);
+			}
+
+			m_tree.build(m_arrays);
+		};
+
+		template<typename HXV, typename V, typename HE, typename HXE, typename E, typename HF, typename F, typename HX>
+		void CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_section(CPlane & p, CCrossSection & section)
+		{
+			m_sliceKernel.slice(m_arrays, p, section);
+		};
+
+		template<typename HXV, typename V, typename HE, typename HXE, typename E, typename HF, typename F, typename HX>
+		void CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_profile(const CPoint & axis, double offsetMin, double offsetMax, int samples, CProfile & profile)
+		{
+			CProfileSweep sweep;
+			sweep.sweep(m_arrays, axis, offsetMin, offsetMax, samples, profile);
+		};
+
+		template<typename HXV, typename V, typename HE, typename HXE, typename E, typename HF, typename F, typename HX>
+		void CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_write_section_m(const char * output, CPlane & p)
+		{
+			if (m_sectionEnabled)
+			{
+				m_section._write_m(output);
+				return;
+			}
 
-				HX * pDT = HalfFaceHex(pD);
+			CCrossSection section;
+			_section(p, section);
+			section._write_m(output);
+		};
 
-				if (pT->outside() && !pDT->outside())
+		template<typename HXV, typename V, typename HE, typename HXE, typename E, typename HF, typename F, typename HX>
+		void CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_write_section_obj(const char * output, CPlane & p)
+		{
+			if (m_sectionEnabled)
+			{
+				m_section._write_obj(output);
+				return;
+			}
+
+			CCrossSection section;
+			_section(p, section);
+			section._write_obj(output);
+		};
+
+		template<typename HXV, typename V, typename HE, typename HXE, typename E, typename HF, typename F, typename HX>
+		void CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_swapCutBuffers()
+		{
+			// unlabel the previous cut, only its own faces and vertices carry the flags
+			for (std::vector<CFace*>::iterator fIter = m_cutFaces.begin(); fIter != m_cutFaces.end(); fIter++)
+			{
+				CFace * pF = *fIter;
+				pF->cut() = false;
+				for (FaceVertexIterator fvIter(this, pF); !fvIter.end(); fvIter++)
 				{
-					m_pHFaces_Above.push_back(pF);
-					continue;
+					CVertex * pV = *fvIter;
+					pV->cut() = false;
+				}
+			}
+
+			m_pHFaces_Above.swap(m_pHFaces_AboveBack);
+			m_pHFaces_Below.swap(m_pHFaces_BelowBack);
+			m_pHFaces_Elements.swap(m_pHFaces_ElementsBack);
+			m_belowChanges.swap(m_belowChangesBack);
+			m_aboveChanges.swap(m_aboveChangesBack);
+			m_elementsChanges.swap(m_elementsChangesBack);
+			m_cutFaces.swap(m_cutFacesBack);
+			m_section.swap(m_sectionBack);
+			m_cutVersion++;
+
+			for (std::vector<CFace*>::iterator fIter = m_cutFaces.begin(); fIter != m_cutFaces.end(); fIter++)
+			{
+				CFace * pF = *fIter;
+				pF->cut() = true;
+				for (FaceVertexIterator fvIter(this, pF); !fvIter.end(); fvIter++)
+				{
+					CVertex * pV = *fvIter;
+					pV->cut() = true;
 				}
-				if (!pT->outside() && pDT->outside())
+			}
+		};
+
+		template<typename HXV, typename V, typename HE, typename HXE, typename E, typename HF, typename F, typename HX>
+		bool CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_buildProxy(int resolution, const volatile bool * cancel, CSurfaceProxy & proxy)
+		{
+			proxy.clear();
+
+			// the versions are taken first, a change during the build leaves the proxy stale
+			int cutVersion = m_cutVersion;
+			int geometryVersion = m_geometryVersion;
+
+			CPoint lo(0, 0, 0), hi(0, 0, 0);
+			for (size_t v = 0; v < m_arrays.numVertices(); v++)
+			{
+				CPoint p(m_arrays.m_x[v], m_arrays.m_y[v], m_arrays.m_z[v]);
+				for (int j = 0; j < 3; j++)
 				{
-					m_pHFaces_Below.push_back(pF);
-					continue;
+					lo[j] = (v == 0 || p[j] < lo[j]) ? p[j] : lo[j];
+					hi[j] = (v == 0 || p[j] > hi[j]) ? p[j] : hi[j];
 				}
 			}
+
+			CVertexClustering clustering;
+			clustering.begin(lo, hi, resolution);
+
+			for (size_t f = 0; f < m_pHFaces_Below.size(); f++)
+			{
+				if ((f & 4095) == 0 && *cancel)
+				{
+					return false;
+				}
+
+				HF * pHF = m_pHFaces_Below[f];
+				CPoint corners[4];
+				int n = 0;
+				for (HalfFaceVertexIterator fvIter(this, pHF); !fvIter.end() && n < 4; ++fvIter)
+				{
+					corners[n++] = (*fvIter)->position();
+				}
+				// hexes carry no group
+				clustering.addFace(corners, n, _halfface_normal(pHF), 0);
+			}
+
+			clustering.finish(proxy);
+			proxy.m_cutVersion = cutVersion;
+			proxy.m_geometryVersion = geometryVersion;
+			return true;
 		};
 
 		template<typename HXV, typename V, typename HE, typename HXE, typename E, typename HF, typename F, typename HX>
-		void CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_write_qm(const char * output, std::vector<CVertex*> vertices, std::vector<CHalfFace*> halffaces)
+		void CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_write_qm(const char * output, std::vector<CVertex*> & vertices, std::vector<CHalfFace*> & halffaces)
 		{
 			std::fstream _os(output, std::fstream::out);
 			if (_os.fail())
@@ -822,7 +1051,7 @@ namespace MeshLib
 
 
 		template<typename HXV, typename V, typename HE, typename HXE, typename E, typename HF, typename F, typename HX>
-		void CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_write_obj(const char * output, std::vector<CVertex*> vertices, std::vector<CHalfFace*> halffaces)
+		void CViewerHMesh<HXV, V, HE, HXE, E, HF, F, HX>::_write_obj(const char * output, std::vector<CVertex*> & vertices, std::vector<CHalfFace*> & halffaces)
 		{
 			std::fstream _os(output, std::fstream::out);
 			if (_os.fail())
@@ -833,11 +1062,15 @@ namespace MeshLib
 
 			_os << "# Generated by VolumeViewerQt" << std::endl;
 
+			// obj files refer to the vertices by their position in the file, counting from 1
+			std::vector<int> objIndex(m_pVertices.size(), 0);
+			int vid = 1;
 			for (std::vector<CVertex*>::iterator vIter = vertices.begin(); vIter != vertices.end(); vIter++)
 			{
 				CVertex * pV = *vIter;
 				CPoint p = pV->position();
 				_os << "v " << p << std::endl;
+				objIndex[pV->index()] = vid++;
 			}
 
 			for (std::vector<HF*>::iterator hiter = halffaces.begin(); hiter != halffaces.end(); hiter++)
@@ -848,7 +1081,7 @@ namespace MeshLib
 				for (int k = 0; k < 4; k++)
 				{
 					CVertex * pV = HalfEdgeTarget(pHE);
-					_os << pV->id() << " ";
+					_os << objIndex[pV->index()] << " ";
 					pHE = HalfEdgeNext(pHE);
 				}
 				_os << std::endl;
@@ -872,20 +1105,7 @@ namespace MeshLib
 				outputHalfFaces.push_back(pHF);
 			}
 
-			for (std::vector<CHalfFace*>::iterator hfIter = outputHalfFaces.begin(); hfIter != outputHalfFaces.end(); hfIter++)
-			{
-				CHalfFace * pHF = *hfIter;
-				CHalfEdge *pHE = HalfFaceHalfEdge(pHF);
-				for (int k = 0; k < 4; k++)
-				{
-					CVertex * pV = HalfEdgeTarget(pHE);
-					if (std::find(vertices.begin(), vertices.end(), pV) != vertices.end())
-					{
-						vertices.push_back(pV);
-					}
-					pHE = HalfEdgeNext(pHE);
-				}
-			}
+			_faceVertices(outputHalfFaces, vertices);
 
 			_write_qm(output, vertices, outputHalfFaces);
 		};
@@ -905,27 +1125,7 @@ namespace MeshLib
 				outputHalfFaces.push_back(pHF);
 			}
 
-			for (std::vector<CHalfFace*>::iterator hfIter = outputHalfFaces.begin(); hfIter != outputHalfFaces.end(); hfIter++)
-			{
-				CHalfFace * pHF = *hfIter;
-				CHalfEdge *pHE = HalfFaceHalfEdge(pHF);
-				for (int k = 0; k < 4; k++)
-				{
-					CVertex * pV = HalfEdgeTarget(pHE);
-					if (std::find(vertices.begin(), vertices.end(), pV) != vertices.end())
-					{
-						vertices.push_back(pV);
-					}
-					pHE = HalfEdgeNext(pHE);
-				}
-			}
-
-			int vid = 1;
-			for (std::vector<CVertex*>::iterator vIter = vertices.begin(); vIter != vertices.end(); vIter++)
-			{
-				CVertex * pV = *vIter;
-				pV->id() = vid++;
-			}
+			_faceVertices(outputHalfFaces, vertices);
 
 			_write_obj(output, vertices, outputHalfFaces);
 		};
@@ -10,6 +10,13 @@
 #include "..\MeshLib\core\Parser\strutil.h"
 #include "..\MeshLib\core\Parser\parser.h"
 
+#include "MeshArrays.h"
+#include "CrossSection.h"
+#include "ImplicitSurface.h"
+#include "AABBTree.h"
+#include "Profile.h"
+#include "SurfaceProxy.h"
+
 namespace MeshLib
 {
 	namespace TMeshLib
@@ -47,7 +54,7 @@ namespace MeshLib
 		class CViewerVertex : public CVertex
 		{
 		public:
-			CViewerVertex() { m_outside = false; m_selected = false; m_cut = false; m_boundary = false; };
+			CViewerVertex() { m_outside = false; m_selected = false; m_cut = false; m_boundary = false; m_index = -1; };
 			~CViewerVertex(){};
 
 			bool & boundary() { return m_boundary; };
@@ -58,6 +65,9 @@ namespace MeshLib
 
 			int & group() { return m_group; };
 
+			//!< position of the vertex in the mesh arrays
+			int & index() { return m_index; };
+
 			void _from_string()
 			{
 				CParser parser(m_string);
@@ -80,6 +90,7 @@ namespace MeshLib
 			bool m_cut;
 
 			int m_group;
+			int m_index;
 		};
 
 		/*!
@@ -158,10 +169,13 @@ namespace MeshLib
 		class CViewerTet : public CTet
 		{
 		public:
-			CViewerTet() { m_outside = false; };
+			CViewerTet() { m_outside = false; m_index = -1; };
 			~CViewerTet(){};
 			bool & outside() { return m_outside; };
 
+			//!< position of the tet in the mesh arrays
+			int & index() { return m_index; };
+
 			CPoint & vector() { return m_vector; };
 
 			int & group() { return m_group; };
@@ -186,22 +200,21 @@ namespace MeshLib
 
 		protected:
 			bool m_outside;
+			int m_index;
 			CPoint m_vector;
 			int m_group = 0;
 		};
 
 		/*!
 		* \brief CViewerHalfFace, HalfFace for viewer purpose
+		* \details The normal is not stored, the shaders derive it per pixel and CViewerTMesh::_halfface_normal computes it
+		* \details for the few faces drawn without them.
 		*/
 		class CViewerHalfFace : public CHalfFace
 		{
 		public:
 			CViewerHalfFace(){};
 			~CViewerHalfFace(){};
-			CPoint & normal() { return m_normal; };
-
-		protected:
-			CPoint m_normal;
 		};
 
 		/*!
@@ -234,14 +247,84 @@ namespace MeshLib
 
 		public:
 			void _normalize();
-			void _halfface_normal();
+			// unit normal of the half face from its corners, pointing out of its tet
+			CPoint _halfface_normal(HF * pHF);
 			void _cut(CPlane &);
+
+			// classify the mesh against the plane into the back buffers, safe to run off the GUI thread
+			void _cutBack(CPlane &);
+
+			// classify the mesh against any implicit surface into the back buffers
+			void _cutBack(CImplicitSurface &);
+
+			// swap the back buffers filled by _cutBack with the visible ones and relabel the cut faces
+			void _swapCutBuffers();
+
+			// simplify the visible surface by vertex clustering into proxy, gives up and returns false once *cancel is set
+			bool _buildProxy(int resolution, const volatile bool * cancel, CSurfaceProxy & proxy);
 			void _updateSelectedFaces();
 
+			// extract the boundary half faces and vertices, only rescans the mesh after _invalidateBoundary()
 			void _labelBoundary();
 
+			// the cached boundary has to be rebuilt, called by _index and whenever the topology changes
+			void _invalidateBoundary() { m_boundaryDirty = true; m_belowBoundaryVersion = -1; };
+
+			// bumped by every swap of the cut buffers, renderers compare it to decide when to rebuild
+			int cutVersion() const { return m_cutVersion; };
+			// bumped whenever positions of the visible faces change
+			int geometryVersion() const { return m_geometryVersion; };
+			void _touchGeometry() { m_geometryVersion++; };
+			// bumped whenever vertices or cut faces are selected or unselected
+			int selectionVersion() const { return m_selectionVersion; };
+			void _touchSelection() { m_selectionVersion++; };
+
+			// half faces without dual, and the vertices on them
+			std::vector<CHalfFace*> & boundaryHalfFaces() { _labelBoundary(); return m_boundaryHalfFaces; };
+			std::vector<CVertex*> & boundaryVertices() { _labelBoundary(); return m_boundaryVertices; };
+			// the boundary half faces among m_pHFaces_Below, filtered again only after a cut
+			std::vector<CHalfFace*> & belowBoundaryHalfFaces();
+
+			// copy the vertices and tets into m_arrays and build the element tree, needs to be called again after vertices move
+			void _index();
+
+			// compute the exact cross section with the plane
+			void _section(CPlane & p, CCrossSection & section);
+
+			// sample the cross section area and the volume below along the axis, per group
+			void _profile(const CPoint & axis, double offsetMin, double offsetMax, int samples, CProfile & profile);
+
+			// the cross section is computed along with every cut only when enabled
+			bool & sectionEnabled() { return m_sectionEnabled; };
+			// the half faces of the tets below the cut are gathered along with every cut only when enabled
+			bool & elementsEnabled() { return m_elementsEnabled; };
+
+			// the half faces that entered and left a face list with the last swap, m_known is false if the list before
+			// the cut is not known, like before the first cut
+			struct CListChanges
+			{
+				std::vector<HF*> m_entered;
+				std::vector<HF*> m_left;
+				bool m_known;
+
+				CListChanges() { m_known = false; };
+				void clear() { m_entered.clear(); m_left.clear(); m_known = false; };
+				void swap(CListChanges & other) { m_entered.swap(other.m_entered); m_left.swap(other.m_left); std::swap(m_known, other.m_known); };
+			};
+
+			// the changes of m_pHFaces_Below, m_pHFaces_Above or m_pHFaces_Elements with the last swap, NULL for any other
+			// list or if they are not known
+			CListChanges * cutChanges(const std::vector<HF*> & halffaces)
+			{
+				CListChanges * changes = NULL;
+				if (&halffaces == &m_pHFaces_Below) changes = &m_belowChanges;
+				else if (&halffaces == &m_pHFaces_Above) changes = &m_aboveChanges;
+				else if (&halffaces == &m_pHFaces_Elements) changes = &m_elementsChanges;
+				return (changes != NULL && changes->m_known) ? changes : NULL;
+			};
+
 			/*! get cut faces vector */
-			std::vector<F *> _getCutFaces() { return m_cutFaces; };
+			std::vector<F *> & _getCutFaces() { return m_cutFaces; };
 
 			std::vector<CVertex*> & selectedVertices() { return m_selectedVertices; };
 
@@ -260,9 +343,9 @@ namespace MeshLib
 			// load fiber file
 			void _load_f(const char * input);
 
-			void _write_m(const char * output, std::vector<CVertex*> vertices, std::vector<CHalfFace*> halffaces);
+			void _write_m(const char * output, std::vector<CVertex*> & vertices, std::vector<CHalfFace*> & halffaces);
 
-			void _write_obj(const char * output, std::vector<CVertex*> vertices, std::vector<CHalfFace*> halffaces);
+			void _write_obj(const char * output, std::vector<CVertex*> & vertices, std::vector<CHalfFace*> & halffaces);
 
 			void _write_above_surface_m(const char * output);
 			void _write_above_surface_obj(const char * output);
@@ -277,24 +360,97 @@ namespace MeshLib
 			void _write_surface_m(const char * output);
 			void _write_surface_obj(const char * output);
 
+			// write the exact cross section of the current cut, which is the plane p oriented as the cut keeps it,
+			// the section shown is written as it is, otherwise it is computed for p
+			void _write_section_m(const char * output, CPlane & p);
+			void _write_section_obj(const char * output, CPlane & p);
+
 			bool & isFiber() { return m_isFiber; };
 
 		private:
 			std::map<int, int> mapSelectedNewVertex;
 
+			// the boundary half faces among halffaces
+			void _boundaryHalfFaces(std::vector<CHalfFace*> & halffaces, std::vector<CHalfFace*> & boundary);
+
+			// the vertices of the half faces, each once in the order they are first used
+			void _faceVertices(std::vector<CHalfFace*> & halffaces, std::vector<CVertex*> & vertices);
+
+			std::vector<CHalfFace*> m_boundaryHalfFaces;
+			std::vector<CVertex*> m_boundaryVertices;
+			bool m_boundaryDirty = true;
+
+			std::vector<CHalfFace*> m_belowBoundaryHalfFaces;
+			int m_belowBoundaryVersion = -1;
+
 		public:
 			std::vector<HF*> m_pHFaces_Above;
 			std::vector<HF*> m_pHFaces_Below;
 			std::vector<F *> m_cutFaces;
 			std::vector<F *> m_selectedFacesList;
+			// the half faces of m_cutFaces below the cut, in the same order
+			std::vector<HF*> m_cutHalfFaces;
+			// both half faces of every face of m_selectedFacesList, the surface buffers recolor them on a selection change
+			std::vector<HF*> m_selectedHalfFaces;
+
+			// back buffers of the face lists, written by _cutBack
+			std::vector<HF*> m_pHFaces_AboveBack;
+			std::vector<HF*> m_pHFaces_BelowBack;
+			std::vector<F *> m_cutFacesBack;
+			std::vector<HF*> m_cutHalfFacesBack;
+
+			// all four half faces of every tet below the cut, in the order of the tree, and its back buffer
+			std::vector<HF*> m_pHFaces_Elements;
+			std::vector<HF*> m_pHFaces_ElementsBack;
+
+			// the changes of the face lists with the current cut, and their back buffers
+			CListChanges m_belowChanges, m_belowChangesBack;
+			CListChanges m_aboveChanges, m_aboveChangesBack;
+			CListChanges m_elementsChanges, m_elementsChangesBack;
+
+			// exact cross section of the current cut, and its back buffer
+			CCrossSection m_section;
+			CCrossSection m_sectionBack;
+
+			// coarse stand in for m_pHFaces_Below while the view moves, and its back buffer
+			CSurfaceProxy m_proxy;
+			CSurfaceProxy m_proxyBack;
 
 			std::vector<CVertex*> m_selectedVertices;
 
+			CMeshArrays m_arrays;
+
+			// tets in the order of m_arrays, and the tree over them
+			std::vector<T*> m_tetArray;
+			CAABBTree m_tree;
+
 		protected:
 
 			std::list<CFiber*> m_fibers;
 			int m_nFibers;
 			bool m_isFiber = false;
+
+			bool m_sectionEnabled = false;
+			bool m_elementsEnabled = false;
+			CSliceKernel m_sliceKernel;
+
+			// scratch of _cutBack, the side of every vertex evaluated during the cut with stamp m_cutStamp
+			std::vector<CAABBTree::CRange> m_outsideRanges, m_insideRanges, m_uncertainRanges;
+			std::vector<int> m_vertexStamp;
+			std::vector<bool> m_vertexOutside;
+			int m_cutStamp = 0;
+			// the outside flags of the cut swapped in last by element index, a cut has been computed, and the elements
+			// were gathered by it
+			std::vector<bool> m_outsideBefore;
+			bool m_hasCut = false;
+			bool m_elementsGathered = false;
+
+			// the list a half face is in by the flags of its element and of the one behind it, 0 none, 1 below, 2 above
+			static int _faceSide(bool outside, bool dualOutside) { return (outside == dualOutside) ? 0 : (outside ? 2 : 1); };
+
+			int m_cutVersion = 0;
+			int m_geometryVersion = 0;
+			int m_selectionVersion = 0;
 		};
 
 		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
@@ -405,6 +561,8 @@ namespace MeshLib
 			m_maxVertexId += k - 1;
 			m_nVertices += k - 1;
 
+			_invalidateBoundary();
+
 			std::fstream _os(filename, std::fstream::out);
 			if (_os.fail())
 			{
@@ -531,11 +689,15 @@ namespace MeshLib
 		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
 		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_updateSelectedFaces()
 		{
+			// only the colors of the cut faces change, the buffers recolor the faces in their lists
+			_touchSelection();
+
 			m_selectedFacesList.clear();
+			m_selectedHalfFaces.clear();
 
-			for (std::vector<F*>::iterator fIter = m_cutFaces.begin(); fIter != m_cutFaces.end(); fIter++)
+			for (size_t i = 0; i < m_cutFaces.size(); i++)
 			{
-				F * pF = *fIter;
+				F * pF = m_cutFaces[i];
 				pF->selected() = false;
 
 				bool faceSelected = true;
@@ -552,6 +714,13 @@ namespace MeshLib
 				{
 					pF->selected() = true;
 					m_selectedFacesList.push_back(pF);
+
+					HF * pHF = m_cutHalfFaces[i];
+					m_selectedHalfFaces.push_back(pHF);
+					if (HalfFaceDual(pHF) != NULL)
+					{
+						m_selectedHalfFaces.push_back(HalfFaceDual(pHF));
+					}
 				}
 			}
 		}
@@ -602,102 +771,142 @@ namespace MeshLib
 		};
 
 		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
-		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_halfface_normal()
+		CPoint CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_halfface_normal(HF * pHF)
 		{
-			for (std::list<HF*>::iterator hiter = m_pHalfFaces.begin(); hiter != m_pHalfFaces.end(); hiter++)
+			HE *pHE = HalfFaceHalfEdge(pHF);
+			CPoint ps[3];
+			for (int k = 0; k < 3; k++)
 			{
-				HF *pHF = *hiter;
-				HE *pHE = HalfFaceHalfEdge(pHF);
-				std::vector<CPoint> ps;
-				for (int k = 0; k < 3; k++)
-				{
-					ps.push_back(HalfEdgeTarget(pHE)->position());
-					pHE = HalfEdgeNext(pHE);
-				}
-				CPoint n = (ps[1] - ps[0]) ^ (ps[2] - ps[0]);
-				n = n / n.norm();
-				pHF->normal() = n;
+				ps[k] = HalfEdgeTarget(pHE)->position();
+				pHE = HalfEdgeNext(pHE);
 			}
+			CPoint n = (ps[1] - ps[0]) ^ (ps[2] - ps[0]);
+			double len = n.norm();
+			return len > 0 ? n / len : n;
 		};
 
 		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
 		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_cut(CPlane & p)
 		{
+			_cutBack(p);
+			_swapCutBuffers();
+		};
 
-			m_pHFaces_Above.clear();
-			m_pHFaces_Below.clear();
-			m_cutFaces.clear();
+		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
+		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_cutBack(CPlane & p)
+		{
+			CImplicitPlane surface(p);
+			_cutBack(surface);
+		};
 
-			for (std::list<V*>::iterator vIter = m_pVertices.begin(); vIter != m_pVertices.end(); vIter++)
+		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
+		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_cutBack(CImplicitSurface & s)
+		{
+			// only the outside flags and the back buffers are written here, everything
+			// the viewer reads while drawing or picking is left untouched until the swap
+
+			m_pHFaces_AboveBack.clear();
+			m_pHFaces_BelowBack.clear();
+			m_cutFacesBack.clear();
+			m_cutHalfFacesBack.clear();
+			m_pHFaces_ElementsBack.clear();
+			m_belowChangesBack.clear();
+			m_aboveChangesBack.clear();
+			m_elementsChangesBack.clear();
+
+			// the lists change against the flags of the cut swapped in last
+			m_outsideBefore.resize(m_tetArray.size());
+			for (size_t e = 0; e < m_tetArray.size(); e++)
 			{
-				V * pV = *vIter;
-				pV->cut() = false;
-				CPoint pos = pV->position();
-				pV->outside() = (p.side(pos) >= 0);
+				m_outsideBefore[e] = m_tetArray[e]->outside();
 			}
 
-			for (std::list<T*>::iterator tIter = m_pTets.begin(); tIter != m_pTets.end(); tIter++)
-			{
-				T * pT = *tIter;
-
-				V * pV[4];
-
-				for (int k = 0; k < 4; k++)
-					pV[k] = TetVertex(pT, k);
-
+			// whole subtrees away from the surface are labeled at once
+			m_tree.classify(s, m_outsideRanges, m_insideRanges, m_uncertainRanges);
 
-				pT->outside() = true;
-				for (int j = 0; j < 4; j++)
+			for (size_t r = 0; r < m_outsideRanges.size(); r++)
+			{
+				for (int i = m_outsideRanges[r].first; i < m_outsideRanges[r].first + m_outsideRanges[r].second; i++)
 				{
-					if (!pV[j]->outside())
-					{
-						pT->outside() = false;
-						break;
-					}
+					m_tetArray[m_tree.m_order[i]]->outside() = true;
 				}
 			}
 
-			for (std::list<F*>::iterator fIter = m_pFaces.begin(); fIter != m_pFaces.end(); fIter++)
+			for (size_t r = 0; r < m_insideRanges.size(); r++)
 			{
-				F * pF = *fIter;
-				pF->cut() = false;
+				for (int i = m_insideRanges[r].first; i < m_insideRanges[r].first + m_insideRanges[r].second; i++)
+				{
+					m_tetArray[m_tree.m_order[i]]->outside() = false;
+				}
 			}
 
-			for (std::list<HF *>::iterator fIter = m_pHalfFaces.begin(); fIter != m_pHalfFaces.end(); fIter++)
+			// only the tets of the leaves close to the surface evaluate their vertices, each vertex at most once
+			m_cutStamp++;
+			m_vertexStamp.resize(m_arrays.numVertices(), 0);
+			m_vertexOutside.resize(m_arrays.numVertices(), false);
+
+			for (size_t r = 0; r < m_uncertainRanges.size(); r++)
 			{
-				HF * pHF = *fIter;
+				for (int i = m_uncertainRanges[r].first; i < m_uncertainRanges[r].first + m_uncertainRanges[r].second; i++)
+				{
+					int e = m_tree.m_order[i];
+					const int * ev = &m_arrays.m_elements[e * 4];
 
-				HF * pHFD = HalfFaceDual(pHF);
+					bool outside = true;
+					for (int k = 0; k < 4 && outside; k++)
+					{
+						int v = ev[k];
+						if (m_vertexStamp[v] != m_cutStamp)
+						{
+							m_vertexStamp[v] = m_cutStamp;
+							m_vertexOutside[v] = (s.value(CPoint(m_arrays.m_x[v], m_arrays.m_y[v], m_arrays.m_z[v])) >= 0);
+						}
+						outside = m_vertexOutside[v];
+					}
 
-				F * pF = HalfFaceFace(pHF);
+					m_tetArray[e]->outside() = outside;
+				}
+			}
 
-				if (pHF != NULL && pHFD != NULL)
+			// the interior tets kept by the cut are drawn as well when shrunk, neighbours in the tree stay close
+			if (m_elementsEnabled)
+			{
+				for (size_t i = 0; i < m_tree.m_order.size(); i++)
 				{
-					T * pT_l = HalfFaceTet(pHF);
-					T * pT_r = HalfFaceTet(pHFD);
-					if (pT_l->outside() != pT_r->outside() && !pF->cut())
+					T * pT = m_tetArray[m_tree.m_order[i]];
+					if (pT->outside())
+					{
+						continue;
+					}
+					for (TetHFIterator hfIter(this, pT); !hfIter.end(); ++hfIter)
 					{
-						m_cutFaces.push_back(pF);
-						pF->cut() = true;
+						m_pHFaces_ElementsBack.push_back(*hfIter);
 					}
 				}
 			}
 
-			for (std::vector<F*>::iterator fIter = m_cutFaces.begin(); fIter != m_cutFaces.end(); fIter++)
+			// only the elements whose flag flipped bring their faces in or take them out
+			if (m_elementsEnabled && m_elementsGathered)
 			{
-				F * pF = *fIter;
-				HF * pHF = FaceLeftHalfFace(pF);
-				HE * pHE = HalfFaceHalfEdge(pHF);
-				HE * pHE2 = HalfEdgeNext(pHE);
-				HE * pHE3 = HalfEdgeNext(pHE2);
-
-				V * pV = HalfEdgeTarget(pHE);
-				V * pV2 = HalfEdgeTarget(pHE2);
-				V * pV3 = HalfEdgeTarget(pHE3);
-				pV->cut() = true;
-				pV2->cut() = true;
-				pV3->cut() = true;
+				m_elementsChangesBack.m_known = true;
+				for (size_t e = 0; e < m_tetArray.size(); e++)
+				{
+					T * pT = m_tetArray[e];
+					if (pT->outside() == m_outsideBefore[e])
+					{
+						continue;
+					}
+					std::vector<HF*> & changed = pT->outside() ? m_elementsChangesBack.m_left : m_elementsChangesBack.m_entered;
+					for (TetHFIterator hfIter(this, pT); !hfIter.end(); ++hfIter)
+					{
+						changed.push_back(*hfIter);
+					}
+				}
 			}
+			m_elementsGathered = m_elementsEnabled;
+
+			m_belowChangesBack.m_known = m_hasCut;
+			m_aboveChangesBack.m_known = m_hasCut;
 
 			for (std::list<HF*>::iterator it = m_pHalfFaces.begin(); it != m_pHalfFaces.end(); it++)
 			{
@@ -705,157 +914,242 @@ namespace MeshLib
 				HF * pD = HalfFaceDual(pF);
 				T  * pT = HalfFaceTet(pF);
 
-				if (pD == NULL)
+				// a boundary face goes with its element, as if the missing one behind it were on the other side
+				bool outside = pT->outside();
+				bool dualOutside = (pD == NULL) ? !outside : HalfFaceTet(pD)->outside();
+				int side = _faceSide(outside, dualOutside);
+
+				if (side == 2)
 				{
-					if (pT->outside())
-					{
-						m_pHFaces_Above.push_back(pF);
-					}
-					else
+					m_pHFaces_AboveBack.push_back(pF);
+				}
+				else if (side == 1)
+				{
+					m_pHFaces_BelowBack.push_back(pF);
+
+					// every cut face has exactly one half face below the plane
+					if (pD != NULL)
 					{
-						m_pHFaces_Below.push_back(pF);
+						m_cutFacesBack.push_back(HalfFaceFace(pF));
+						m_cutHalfFacesBack.push_back(pF);
 					}
-					continue;
 				}
 
-				T * pDT = HalfFaceTet(pD);
-
-				if (pT->outside() && !pDT->outside())
+				if (!m_hasCut)
 				{
-					m_pHFaces_Above.push_back(pF);
 					continue;
 				}
-				if (!pT->outside() && pDT->outside())
+
+				bool outsideBefore = m_outsideBefore[pT->index()];
+				bool dualOutsideBefore = (pD == NULL) ? !outsideBefore : m_outsideBefore[HalfFaceTet(pD)->index()];
+				int sideBefore = _faceSide(outsideBefore, dualOutsideBefore);
+				if (sideBefore != side)
 				{
-					m_pHFaces_Below.push_back(pF);
-					continue;
+					if (sideBefore != 0)
+					{
+						(sideBefore == 1 ? m_belowChangesBack : m_aboveChangesBack).m_left.push_back(pF);
+					}
+					if (side != 0)
+					{
+						(side == 1 ? m_belowChangesBack : m_aboveChangesBack).m_entered.push_back(pF);
+					}
 				}
 			}
+			m_hasCut = true;
+
+			CPlane plane;
+			if (m_sectionEnabled && s.isPlane(plane))
+			{
+				_section(plane, m_sectionBack);
+			}
+			else
+			{
+				m_sectionBack.clear();
+			}
 		};
 
 		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
-		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_labelBoundary()
+		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_index()
 		{
-			for (std::list<CVertex*>::iterator vIter = m_pVertices.begin(); vIter != m_pVertices.end(); vIter++)
+			_touchGeometry();
+			_invalidateBoundary();
+
+			m_arrays.clear();
+			m_arrays.m_verticesPerElement = 4;
+			m_tetArray.clear();
+
+			int index = 0;
+			for (std::list<V*>::iterator vIter = m_pVertices.begin(); vIter != m_pVertices.end(); vIter++)
 			{
-				CVertex * pV = *vIter;
-				pV->boundary() = false;
+				V * pV = *vIter;
+				pV->index() = index++;
+
+				CPoint p = pV->position();
+				m_arrays.m_x.push_back(p[0]);
+				m_arrays.m_y.push_back(p[1]);
+				m_arrays.m_z.push_back(p[2]);
+				m_arrays.m_u.push_back(pV->uv()[0]);
+				m_arrays.m_v.push_back(pV->uv()[1]);
 			}
 
-			for (std::list<HF*>::iterator hiter = m_pHalfFaces.begin(); hiter != m_pHalfFaces.end(); hiter++)
+			for (std::list<T*>::iterator tIter = m_pTets.begin(); tIter != m_pTets.end(); tIter++)
 			{
-				CHalfFace *pHF = *hiter;
-				if (HalfFaceDual(pHF) != NULL)
-				{
-					continue;
-				}
-
-				CHalfEdge *pHE = HalfFaceHalfEdge(pHF);
+				T * pT = *tIter;
 				for (int k = 0; k < 4; k++)
 				{
-					CVertex * pV = HalfEdgeTarget(pHE);
-					pV->boundary() = true;
-					pHE = HalfEdgeNext(pHE);
+					m_arrays.m_elements.push_back(TetVertex(pT, k)->index());
 				}
+				m_arrays.m_groups.push_back(pT->group());
+				pT->index() = (int)m_tetArray.size();
+				m_tetArray.push_back(pT);
 			}
+
+			m_tree.build(m_arrays);
 		};
 
 		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
-		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_write_surface_obj(const char * output)
+		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_section(CPlane & p, CCrossSection & section)
 		{
+			m_sliceKernel.slice(m_arrays, p, section);
+		};
 
-			std::fstream _os(output, std::fstream::out);
-			if (_os.fail())
+		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
+		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_profile(const CPoint & axis, double offsetMin, double offsetMax, int samples, CProfile & profile)
+		{
+			CProfileSweep sweep;
+			sweep.sweep(m_arrays, axis, offsetMin, offsetMax, samples, profile);
+		};
+
+		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
+		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_write_section_m(const char * output, CPlane & p)
+		{
+			if (m_sectionEnabled)
 			{
-				fprintf(stderr, "Error is opening file %s\n", output);
+				m_section._write_m(output);
 				return;
 			}
 
-			_labelBoundary();
+			CCrossSection section;
+			_section(p, section);
+			section._write_m(output);
+		};
 
-			std::vector<CVertex*> vertices;
+		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
+		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_write_section_obj(const char * output, CPlane & p)
+		{
+			if (m_sectionEnabled)
+			{
+				m_section._write_obj(output);
+				return;
+			}
 
-			for (std::list<CVertex*>::iterator vIter = m_pVertices.begin(); vIter != m_pVertices.end(); vIter++)
+			CCrossSection section;
+			_section(p, section);
+			section._write_obj(output);
+		};
+
+		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
+		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_swapCutBuffers()
+		{
+			// unlabel the previous cut, only its own faces and vertices carry the flags
+			for (std::vector<F*>::iterator fIter = m_cutFaces.begin(); fIter != m_cutFaces.end(); fIter++)
 			{
-				CVertex * pV = *vIter;
-				if (pV->boundary())
+				F * pF = *fIter;
+				pF->cut() = false;
+				for (FaceVertexIterator fvIter(this, pF); !fvIter.end(); fvIter++)
 				{
-					vertices.push_back(pV);
+					V * pV = *fvIter;
+					pV->cut() = false;
 				}
 			}
 
-			int vid = 1;
+			m_pHFaces_Above.swap(m_pHFaces_AboveBack);
+			m_pHFaces_Below.swap(m_pHFaces_BelowBack);
+			m_pHFaces_Elements.swap(m_pHFaces_ElementsBack);
+			m_belowChanges.swap(m_belowChangesBack);
+			m_aboveChanges.swap(m_aboveChangesBack);
+			m_elementsChanges.swap(m_elementsChangesBack);
+			m_cutFaces.swap(m_cutFacesBack);
+			m_cutHalfFaces.swap(m_cutHalfFacesBack);
+			m_section.swap(m_sectionBack);
+			m_cutVersion++;
 
-			for (std::vector<CVertex*>::iterator vIter = vertices.begin(); vIter != vertices.end(); vIter++)
+			for (std::vector<F*>::iterator fIter = m_cutFaces.begin(); fIter != m_cutFaces.end(); fIter++)
 			{
-				CVertex * pV = *vIter;
-				pV->id() = vid++;
+				F * pF = *fIter;
+				pF->cut() = true;
+				for (FaceVertexIterator fvIter(this, pF); !fvIter.end(); fvIter++)
+				{
+					V * pV = *fvIter;
+					pV->cut() = true;
+				}
 			}
+		};
 
-			_os << "# Generated by VolumeViewerQt" << std::endl;
+		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
+		bool CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_buildProxy(int resolution, const volatile bool * cancel, CSurfaceProxy & proxy)
+		{
+			proxy.clear();
 
-			for (std::vector<CVertex*>::iterator vIter = vertices.begin(); vIter != vertices.end(); vIter++)
+			// the versions are taken first, a change during the build leaves the proxy stale
+			int cutVersion = m_cutVersion;
+			int geometryVersion = m_geometryVersion;
+
+			CPoint lo(0, 0, 0), hi(0, 0, 0);
+			for (size_t v = 0; v < m_arrays.numVertices(); v++)
 			{
-				CVertex * pV = *vIter;
-				CPoint p = pV->position();
-				_os << "v " << p << std::endl;
+				CPoint p(m_arrays.m_x[v], m_arrays.m_y[v], m_arrays.m_z[v]);
+				for (int j = 0; j < 3; j++)
+				{
+					lo[j] = (v == 0 || p[j] < lo[j]) ? p[j] : lo[j];
+					hi[j] = (v == 0 || p[j] > hi[j]) ? p[j] : hi[j];
+				}
 			}
 
-			for (std::list<HF*>::iterator hiter = m_pHalfFaces.begin(); hiter != m_pHalfFaces.end(); hiter++)
+			CVertexClustering clustering;
+			clustering.begin(lo, hi, resolution);
+
+			for (size_t f = 0; f < m_pHFaces_Below.size(); f++)
 			{
-				CHalfFace *pHF = *hiter;
-				if (HalfFaceDual(pHF) != NULL)
+				if ((f & 4095) == 0 && *cancel)
 				{
-					continue;
+					return false;
 				}
 
-				_os << "f ";
-				CHalfEdge *pHE = HalfFaceHalfEdge(pHF);
-				for (int k = 0; k < 3; k++)
+				HF * pHF = m_pHFaces_Below[f];
+				CPoint corners[4];
+				int n = 0;
+				for (HalfFaceVertexIterator fvIter(this, pHF); !fvIter.end() && n < 4; ++fvIter)
 				{
-					CVertex * pV = HalfEdgeTarget(pHE);
-					_os << pV->id() << " ";
-					pHE = HalfEdgeNext(pHE);
+					corners[n++] = (*fvIter)->position();
 				}
-				_os << std::endl;
+				clustering.addFace(corners, n, _halfface_normal(pHF), HalfFaceTet(pHF)->group());
 			}
 
-			_os.close();
+			clustering.finish(proxy);
+			proxy.m_cutVersion = cutVersion;
+			proxy.m_geometryVersion = geometryVersion;
+			return true;
 		};
 
 		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
-		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_write_surface_m(const char * output)
+		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_labelBoundary()
 		{
-
-			_labelBoundary();
-
-			std::vector<CVertex*> vertices;
-
-			for (std::list<CVertex*>::iterator vIter = m_pVertices.begin(); vIter != m_pVertices.end(); vIter++)
+			if (!m_boundaryDirty)
 			{
-				CVertex * pV = *vIter;
-				if (pV->boundary())
-				{
-					vertices.push_back(pV);
-				}
-			}
-
-			std::fstream _os(output, std::fstream::out);
-			if (_os.fail())
-			{
-				fprintf(stderr, "Error is opening file %s\n", output);
 				return;
 			}
 
-			for (std::vector<CVertex*>::iterator vIter = vertices.begin(); vIter != vertices.end(); vIter++)
+			m_boundaryHalfFaces.clear();
+			m_boundaryVertices.clear();
+
+			for (std::list<CVertex*>::iterator vIter = m_pVertices.begin(); vIter != m_pVertices.end(); vIter++)
 			{
 				CVertex * pV = *vIter;
-				CPoint p = pV->position();
-				_os << "Vertex " << pV->id() << " " << p << std::endl;
+				pV->boundary() = false;
 			}
 
-			int faceid = 1;
-			for (std::list<HF*>::iterator hiter = m_pHalfFaces.begin(); hiter != m_pHalfFaces.end(); hiter++, faceid++)
+			for (std::list<HF*>::iterator hiter = m_pHalfFaces.begin(); hiter != m_pHalfFaces.end(); hiter++)
 			{
 				CHalfFace *pHF = *hiter;
 				if (HalfFaceDual(pHF) != NULL)
@@ -863,89 +1157,101 @@ namespace MeshLib
 					continue;
 				}
 
-				_os << "Face " << faceid << " ";
+				m_boundaryHalfFaces.push_back(pHF);
+
 				CHalfEdge *pHE = HalfFaceHalfEdge(pHF);
 				for (int k = 0; k < 3; k++)
 				{
 					CVertex * pV = HalfEdgeTarget(pHE);
-					_os << pV->id() << " ";
+					if (!pV->boundary())
+					{
+						pV->boundary() = true;
+						m_boundaryVertices.push_back(pV);
+					}
 					pHE = HalfEdgeNext(pHE);
 				}
-				_os << std::endl;
 			}
 
-			_os.close();
-		}
+			m_boundaryDirty = false;
+		};
 
 		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
-		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_write_above_surface_m(const char * output)
+		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_boundaryHalfFaces(std::vector<CHalfFace*> & halffaces, std::vector<CHalfFace*> & boundary)
 		{
-
-			_labelBoundary();
-
-			std::vector<CHalfFace*> outputHalfFaces;
-
-			for (std::vector<CHalfFace*>::iterator hfIter = m_pHFaces_Above.begin(); hfIter != m_pHFaces_Above.end(); hfIter++)
+			boundary.clear();
+			for (std::vector<CHalfFace*>::iterator hfIter = halffaces.begin(); hfIter != halffaces.end(); hfIter++)
 			{
 				CHalfFace * pHF = *hfIter;
-				if (HalfFaceDual(pHF) != NULL)
+				if (HalfFaceDual(pHF) == NULL)
 				{
-					continue;
+					boundary.push_back(pHF);
 				}
-
-				outputHalfFaces.push_back(pHF);
-
 			}
+		};
 
-			std::vector<CVertex*> vertices;
-			for (std::list<CVertex*>::iterator vIter = m_pVertices.begin(); vIter != m_pVertices.end(); vIter++)
+		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
+		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_faceVertices(std::vector<CHalfFace*> & halffaces, std::vector<CVertex*> & vertices)
+		{
+			// the vertices are marked by their index, which _index assigned
+			std::vector<bool> isAdded(m_pVertices.size(), false);
+			vertices.clear();
+			for (std::vector<CHalfFace*>::iterator hfIter = halffaces.begin(); hfIter != halffaces.end(); hfIter++)
 			{
-				CVertex * pV = *vIter;
-				if (pV->boundary())
+				CHalfEdge * pHE = HalfFaceHalfEdge(*hfIter);
+				for (int k = 0; k < 3; k++)
 				{
-					vertices.push_back(pV);
+					CVertex * pV = HalfEdgeTarget(pHE);
+					if (!isAdded[pV->index()])
+					{
+						isAdded[pV->index()] = true;
+						vertices.push_back(pV);
+					}
+					pHE = HalfEdgeNext(pHE);
 				}
 			}
+		};
 
-			_write_m(output, vertices, outputHalfFaces);
+		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
+		std::vector<HF*> & CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::belowBoundaryHalfFaces()
+		{
+			if (m_belowBoundaryVersion != m_cutVersion)
+			{
+				_boundaryHalfFaces(m_pHFaces_Below, m_belowBoundaryHalfFaces);
+				m_belowBoundaryVersion = m_cutVersion;
+			}
+			return m_belowBoundaryHalfFaces;
 		};
 
 		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
-		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_write_above_surface_obj(const char * output)
+		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_write_surface_obj(const char * output)
 		{
+			_write_obj(output, boundaryVertices(), boundaryHalfFaces());
+		};
 
-			_labelBoundary();
+		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
+		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_write_surface_m(const char * output)
+		{
+			_write_m(output, boundaryVertices(), boundaryHalfFaces());
+		}
 
+		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
+		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_write_above_surface_m(const char * output)
+		{
 			std::vector<CHalfFace*> outputHalfFaces;
+			_boundaryHalfFaces(m_pHFaces_Above, outputHalfFaces);
+			std::vector<CVertex*> vertices;
+			_faceVertices(outputHalfFaces, vertices);
 
-			for (std::vector<CHalfFace*>::iterator hfIter = m_pHFaces_Above.begin(); hfIter != m_pHFaces_Above.end(); hfIter++)
-			{
-				CHalfFace * pHF = *hfIter;
-				if (HalfFaceDual(pHF) != NULL)
-				{
-					continue;
-				}
-
-				outputHalfFaces.push_back(pHF);
-
-			}
+			_write_m(output, vertices, outputHalfFaces);
+		};
 
+		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
+		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_write_above_surface_obj(const char * output)
+		{
+			std::vector<CHalfFace*> outputHalfFaces;
+			_boundaryHalfFaces(m_pHFaces_Above, outputHalfFaces);
 			std::vector<CVertex*> vertices;
-			for (std::list<CVertex*>::iterator vIter = m_pVertices.begin(); vIter != m_pVertices.end(); vIter++)
-			{
-				CVertex * pV = *vIter;
-				if (pV->boundary())
-				{
-					vertices.push_back(pV);
-				}
-			}
-
-			int vid = 1;
-			for (std::vector<CVertex*>::iterator vIter = vertices.begin(); vIter != vertices.end(); vIter++)
-			{
-				CVertex * pV = *vIter;
-				pV->id() = vid++;
-			}
+			_faceVertices(outputHalfFaces, vertices);
 
 			_write_obj(output, vertices, outputHalfFaces);
 		};
@@ -953,31 +1259,9 @@ namespace MeshLib
 		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
 		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_write_below_surface_m(const char * output)
 		{
-
-			_labelBoundary();
-			std::vector<CHalfFace*> outputHalfFaces;
-
-			for (std::vector<CHalfFace*>::iterator hfIter = m_pHFaces_Below.begin(); hfIter != m_pHFaces_Below.end(); hfIter++)
-			{
-				CHalfFace * pHF = *hfIter;
-				if (HalfFaceDual(pHF) != NULL)
-				{
-					continue;
-				}
-
-				outputHalfFaces.push_back(pHF);
-
-			}
-
+			std::vector<CHalfFace*> & outputHalfFaces = belowBoundaryHalfFaces();
 			std::vector<CVertex*> vertices;
-			for (std::list<CVertex*>::iterator vIter = m_pVertices.begin(); vIter != m_pVertices.end(); vIter++)
-			{
-				CVertex * pV = *vIter;
-				if (pV->boundary())
-				{
-					vertices.push_back(pV);
-				}
-			}
+			_faceVertices(outputHalfFaces, vertices);
 
 			_write_m(output, vertices, outputHalfFaces);
 		};
@@ -985,44 +1269,9 @@ namespace MeshLib
 		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
 		void CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_write_below_surface_obj(const char * output)
 		{
-			_labelBoundary();
-			std::vector<CHalfFace*> outputHalfFaces;
-
-			for (std::vector<CHalfFace*>::iterator hfIter = m_pHFaces_Below.begin(); hfIter != m_pHFaces_Below.end(); hfIter++)
-			{
-				CHalfFace * pHF = *hfIter;
-				if (HalfFaceDual(pHF) != NULL)
-				{
-					continue;
-				}
-
-				outputHalfFaces.push_back(pHF);
-
-			}
-
+			std::vector<CHalfFace*> & outputHalfFaces = belowBoundaryHalfFaces();
 			std::vector<CVertex*> vertices;
-
-			for (std::vector<CHalfFace*>::iterator hfIter = outputHalfFaces.begin(); hfIter != outputHalfFaces.end(); hfIter++)
-			{
-				CHalfFace * pHF = *hfIter;
-				CHalfEdge *pHE = HalfFaceHalfEdge(pHF);
-				for (int k = 0; k < 4; k++)
-				{
-					CVertex * pV = HalfEdgeTarget(pHE);
-					if (std::find(vertices.begin(), vertices.end(), pV) == vertices.end())
-					{
-						vertices.push_back(pV);
-					}
-					pHE = HalfEdgeNext(pHE);
-				}
-			}
-
-			int vid = 1;
-			for (std::vector<CVertex*>::iterator vIter = vertices.begin(); vIter != vertices.end(); vIter++)
-			{
-				CVertex * pV = *vIter;
-				pV->id() = vid++;
-			}
+			_faceVertices(outputHalfFaces, vertices);
 
 			_write_obj(output, vertices, outputHalfFaces);
 		};
@@ -1030,7 +1279,6 @@ namespace MeshLib
 		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
 		void  CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_write_cut_surface_m(const char * output)
 		{
-			_labelBoundary();
 			std::vector<CHalfFace*> outputHalfFaces;
 
 			for (std::vector<CHalfFace*>::iterator hfIter = m_pHFaces_Below.begin(); hfIter != m_pHFaces_Below.end(); hfIter++)
@@ -1045,21 +1293,7 @@ namespace MeshLib
 
 			}
 			std::vector<CVertex*> vertices;
-
-			for (std::vector<CHalfFace*>::iterator hfIter = outputHalfFaces.begin(); hfIter != outputHalfFaces.end(); hfIter++)
-			{
-				CHalfFace * pHF = *hfIter;
-				CHalfEdge * pHE = HalfFaceHalfEdge(pHF);
-				for (int k = 0; k < 4; k++)
-				{
-					CVertex * pV = HalfEdgeTarget(pHE);
-					if (std::find(vertices.begin(), vertices.end(), pV) == vertices.end())
-					{
-						vertices.push_back(pV);
-					}
-					pHE = HalfEdgeNext(pHE);
-				}
-			}
+			_faceVertices(outputHalfFaces, vertices);
 
 			_write_m(output, vertices, outputHalfFaces);
 		};
@@ -1067,7 +1301,6 @@ namespace MeshLib
 		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
 		void  CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_write_cut_surface_obj(const char * output)
 		{
-			_labelBoundary();
 			std::vector<CHalfFace*> outputHalfFaces;
 
 			for (std::vector<CHalfFace*>::iterator hfIter = m_pHFaces_Below.begin(); hfIter != m_pHFaces_Below.end(); hfIter++)
@@ -1082,32 +1315,13 @@ namespace MeshLib
 
 			}
 			std::vector<CVertex*> vertices;
+			_faceVertices(outputHalfFaces, vertices);
 
-			for (std::vector<CHalfFace*>::iterator hfIter = outputHalfFaces.begin(); hfIter != outputHalfFaces.end(); hfIter++)
-			{
-				CHalfFace * pHF = *hfIter;
-				CHalfEdge * pHE = HalfFaceHalfEdge(pHF);
-				for (int k = 0; k < 4; k++)
-				{
-					CVertex * pV = HalfEdgeTarget(pHE);
-					if (std::find(vertices.begin(), vertices.end(), pV) == vertices.end())
-					{
-						vertices.push_back(pV);
-					}
-					pHE = HalfEdgeNext(pHE);
-				}
-			}
-			int vid = 1;
-			for (std::vector<CVertex*>::iterator vIter = vertices.begin(); vIter != vertices.end(); vIter++)
-			{
-				CVertex * pV = *vIter;
-				pV->id() = vid++;
-			}
 			_write_obj(output, vertices, outputHalfFaces);
 		};
 
 		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
-		void  CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_write_m(const char * output, std::vector<CVertex*> vertices, std::vector<CHalfFace*> halffaces)
+		void  CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_write_m(const char * output, std::vector<CVertex*> & vertices, std::vector<CHalfFace*> & halffaces)
 		{
 			std::fstream _os(output, std::fstream::out);
 			if (_os.fail())
@@ -1142,7 +1356,7 @@ namespace MeshLib
 		};
 
 		template<typename TV, typename V, typename HE, typename TE, typename E, typename HF, typename F, typename T>
-		void  CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_write_obj(const char * output, std::vector<CVertex*> vertices, std::vector<CHalfFace*> halffaces)
+		void  CViewerTMesh<TV, V, HE, TE, E, HF, F, T>::_write_obj(const char * output, std::vector<CVertex*> & vertices, std::vector<CHalfFace*> & halffaces)
 		{
 			std::fstream _os(output, std::fstream::out);
 			if (_os.fail())
@@ -1153,11 +1367,15 @@ namespace MeshLib
 
 			_os << "# Generated by VolumeViewerQt" << std::endl;
 
+			// obj files refer to the vertices by their position in the file, counting from 1
+			std::vector<int> objIndex(m_pVertices.size(), 0);
+			int vid = 1;
 			for (std::vector<CVertex*>::iterator vIter = vertices.begin(); vIter != vertices.end(); vIter++)
 			{
 				CVertex * pV = *vIter;
 				CPoint p = pV->position();
 				_os << "v " << p << std::endl;
+				objIndex[pV->index()] = vid++;
 			}
 
 			for (std::vector<CHalfFace*>::iterator hiter = halffaces.begin(); hiter != halffaces.end(); hiter++)
@@ -1168,7 +1386,7 @@ namespace MeshLib
 				for (int k = 0; k < 3; k++)
 				{
 					CVertex * pV = HalfEdgeTarget(pHE);
-					_os << pV->id() << " ";
+					_os << objIndex[pV->index()] << " ";
 					pHE = HalfEdgeNext(pHE);
 				}
 				_os << std::endl;
@@ -1,15 +1,33 @@
 #include "VolViewer.h"
 #include "MainWindow.h"
+#include "AllocCounter.h"
 #include <queue>
 #include <random>
+#include <QElapsedTimer>
+#include <QGLFramebufferObject>
 
-VolViewer::VolViewer(QWidget *_parent) : QGLWidget(_parent)
+// double buffered with the swap waiting for the vertical retrace, so no frame is drawn that cannot be shown
+static QGLFormat viewerFormat()
+{
+	QGLFormat format = QGLFormat::defaultFormat();
+	format.setDoubleBuffer(true);
+	format.setSwapInterval(1);
+	return format;
+}
+
+// the edges drawn over the shaded faces
+static const GLubyte wireColor[4] = { 0, 0, 0, 255 };
+
+VolViewer::VolViewer(QWidget *_parent) : QGLWidget(viewerFormat(), _parent)
 {
 
 	isSelectionMode = false;
 	isSelectionCutFaceMode = false;
 	cutDistance = 0.0;
 	cutPlane = CPlane(CPoint(0.0, 0.0, 1.0), cutDistance);
+	cutType = CUT_TYPE::PLANE;
+	cutRadius = 0.0;
+	isCutInverted = false;
 	init();
 	isTextureLoaded = false;
 	isLightOn = true;
@@ -18,11 +36,34 @@ VolViewer::VolViewer(QWidget *_parent) : QGLWidget(_parent)
 
 	fiberMinLength = 0;
 
+	profilePanel = NULL;
+	groupPanel = NULL;
+	shrinkFactor = 0.8;
+	shrinkPanel = NULL;
+
+	isRetainedMode = true;
+	isInteracting = false;
+	isGLInitialized = false;
+	isStatsShown = false;
+	statsText.reserve(FrameStats::lineLength);
+	statsFont = QFont("Courier", 9);
+	proxySwapsShown = 0;
+
+	isMousePending = false;
+	pendingWheel = 0.0;
+
+	cutWorker = new CutWorker(this);
+	connect(cutWorker, SIGNAL(cutReady()), this, SLOT(update()));
+	cutWorker->start();
 }
 
 
 VolViewer::~VolViewer()
 {
+	cutWorker->stop();
+
+	makeCurrent();
+	clearBuffers();
 }
 
 void VolViewer::init()
@@ -45,23 +86,25 @@ QSize VolViewer::sizeHint() const
 void VolViewer::resizeGL(int width, int height)
 {
 	glViewport(0, 0, width, height);
-	glGetIntegerv(GL_VIEWPORT, viewPort);
+	camera.setViewport(0, 0, width, height);
 	updateProjectionMatrix();
-	updateGL();
+	update();
 }
 
-void VolViewer::getGLMatrix()
+void VolViewer::loadCamera()
 {
-	glGetDoublev(GL_PROJECTION_MATRIX, matProjection);
-	glGetDoublev(GL_MODELVIEW_MATRIX, matModelView);
-	glGetIntegerv(GL_VIEWPORT, viewPort);
+	camera.modelView(matModelView);
+	camera.projection(matProjection);
+	camera.viewport(viewPort);
+
+	glMatrixMode(GL_PROJECTION);
+	glLoadMatrixd(matProjection);
+	glMatrixMode(GL_MODELVIEW);
+	glLoadMatrixd(matModelView);
 }
 
 void VolViewer::initializeGL()
 {
-	// get the projection and modelview matrix
-	getGLMatrix();
-
 	GLfloat lightOneColor[] = { 1, 1, 1, 1 };
 	GLfloat globalAmb[] = { .1f, .1f, .1f, 1.0f };
 	GLfloat lightOnePosition[] = { .0, .0, 1, 0.0 };
@@ -95,9 +138,21 @@ void VolViewer::initializeGL()
 	glLightfv(GL_LIGHT2, GL_POSITION, lightTwoPosition);
 	glLightfv(GL_LIGHT3, GL_POSITION, lightThreePosition);
 
+	isGLInitialized = true;
+
 	setScene();
 }
 
+void VolViewer::initializeOffscreen()
+{
+	// a widget which is never shown does not get initialized by Qt
+	makeCurrent();
+	if (!isGLInitialized)
+	{
+		glInit();
+	}
+}
+
 void VolViewer::setScene()
 {
 	makeWholeSceneVisible();
@@ -106,57 +161,53 @@ void VolViewer::setScene()
 
 void VolViewer::setDrawMode(DRAW_MODE drawMode)
 {
+	bool sectionChanged = (drawMode == DRAW_MODE::SECTION) != (meshDrawMode == DRAW_MODE::SECTION);
+	bool shrinkChanged = (drawMode == DRAW_MODE::SHRINK) != (meshDrawMode == DRAW_MODE::SHRINK);
 	meshDrawMode = drawMode;
-	updateGL();
+
+	if (sectionChanged || shrinkChanged)
+	{
+		// the exact section and the faces of all elements below the cut are only gathered while they are shown
+		cutWorker->waitForIdle();
+
+		bool sectionEnabled = (meshDrawMode == DRAW_MODE::SECTION);
+		bool elementsEnabled = (meshDrawMode == DRAW_MODE::SHRINK);
+		for (size_t t = 0; t < tmeshlist.size(); t++)
+		{
+			tmeshlist[t]->sectionEnabled() = sectionEnabled;
+			tmeshlist[t]->elementsEnabled() = elementsEnabled;
+		}
+		for (size_t h = 0; h < hmeshlist.size(); h++)
+		{
+			hmeshlist[h]->sectionEnabled() = sectionEnabled;
+			hmeshlist[h]->elementsEnabled() = elementsEnabled;
+		}
+
+		cutMeshes();
+	}
+
+	update();
 }
 
 void VolViewer::setVolType(VOLUME_TYPE volType)
 {
 	meshVolType = volType;
-	updateGL();
+	update();
 }
 
 void VolViewer::updateProjectionMatrix()
 {
-	makeCurrent();
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-	gluPerspective(fovy(), (GLdouble)width() / (GLdouble)height(), 0.001 * radius * 2, 100.0 * radius);
+	camera.setPerspective(fovy(), (GLdouble)width() / (GLdouble)height(), 0.001 * radius * 2, 100.0 * radius);
 }
 
 void VolViewer::makeWholeSceneVisible()
 {
-	makeCurrent();
-
 	float diam = radius * 2;
 	zNear = 0.001 * diam;
 	zFar = diam;
 
-	GLfloat left = center[0] - diam;
-	GLfloat right = center[0] + diam;
-	GLfloat bottom = center[1] - diam;
-	GLfloat top = center[1] + diam;
-
-	GLfloat aspect = (GLfloat)width() / (GLfloat)height();
-	if (aspect < 1.0)
-	{
-		bottom /= aspect;
-		top /= aspect;
-	}
-	else
-	{
-		left *= aspect;
-		right *= aspect;
-	}
-
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-	glOrtho(left, right, bottom, top, zNear, zFar);
-	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
-
-	gluLookAt(center[0], center[1], 1.5 * diam, center[0], center[1], center[2], 0.0, 1.0, 0.0);
-
+	// look at the center along -z from outside the bounding sphere
+	camera.lookAt(center, 1.5 * diam);
 }
 
 void VolViewer::computeBoundingSphere()
@@ -247,12 +298,36 @@ void VolViewer::computeBoundingSphere()
 
 void VolViewer::paintGL()
 {
+	// the times are those of the CPU submitting the work, the GPU finishes it later
+	QElapsedTimer frameTimer;
+	frameTimer.start();
+	frameStats.beginFrame();
+
+	// show the latest cut finished by the worker, the face lists only change here
+	if (cutWorker->swapBuffers())
+	{
+		frameStats.setOperation("cut", cutWorker->lastCutMs(), cutWorker->lastCutAllocations());
+	}
+	if (cutWorker->proxySwapCount() != proxySwapsShown)
+	{
+		proxySwapsShown = cutWorker->proxySwapCount();
+		frameStats.setOperation("proxy", cutWorker->lastProxyMs(), cutWorker->lastProxyAllocations());
+		setProxyCacheStats();
+	}
+
+	applyPendingInput();
+
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	loadCamera();
 	glPushMatrix();
 
+	QElapsedTimer meshTimer;
+	char label[32];
+
 	for (std::vector<TMeshLib::CVTMesh*>::iterator tIter = tmeshlist.begin(); tIter != tmeshlist.end(); tIter++)
 	{
 		TMeshLib::CVTMesh * currentMesh = *tIter;
+		meshTimer.start();
 
 		if (currentMesh->isFiber())
 		{
@@ -271,11 +346,15 @@ void VolViewer::paintGL()
 			}
 			drawMesh(currentMesh);
 		}
+
+		sprintf(label, "%s%d", currentMesh->isFiber() ? "fiber" : "tet", (int)(tIter - tmeshlist.begin()));
+		frameStats.addMesh(label, meshTimer.nsecsElapsed() / 1e6);
 	}
 
 	for (std::vector<HMeshLib::CVHMesh*>::iterator tIter = hmeshlist.begin(); tIter != hmeshlist.end(); tIter++)
 	{
 		HMeshLib::CVHMesh * currenhmesh = *tIter;
+		meshTimer.start();
 
 		if (isLightOn)
 		{
@@ -286,13 +365,283 @@ void VolViewer::paintGL()
 			glDisable(GL_LIGHTING);
 		}
 		drawMesh(currenhmesh);
+
+		sprintf(label, "hex%d", (int)(tIter - hmeshlist.begin()));
+		frameStats.addMesh(label, meshTimer.nsecsElapsed() / 1e6);
 	}
 
 	glPopMatrix();
+
+	// the overlay shows the last closed frame, its own work counts in this one
+	if (isStatsShown)
+	{
+		drawStats();
+	}
+
+	frameStats.endFrame(frameTimer.nsecsElapsed() / 1e6);
+
+	if (isStatsShown)
+	{
+		// written through the C stream buffer, without the flush of std::endl
+		frameStats.logLine(statsLog, sizeof(statsLog));
+		printf("%s\n", statsLog);
+	}
+}
+
+void VolViewer::drawStats()
+{
+	size_t numLines = frameStats.summary(statsLines, maxStatsLines);
+
+	glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT | GL_POLYGON_BIT);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_TEXTURE_2D);
+	glDisable(GL_CLIP_PLANE0);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	glColor3f(1.0, 1.0, 1.0);
+
+	for (size_t i = 0; i < numLines; i++)
+	{
+		// the text keeps its reserved capacity when it is emptied
+		statsText.resize(0);
+		statsText.append(QLatin1String(statsLines[i]));
+		renderText(10, 18 + 14 * (int)i, statsText, statsFont);
+	}
+
+	glPopAttrib();
+}
+
+void VolViewer::setProxyCacheStats()
+{
+	// the misses of all proxies, weighted by their triangles
+	double before = 0, after = 0, triangles = 0;
+	for (size_t t = 0; t < tmeshlist.size(); t++)
+	{
+		CSurfaceProxy & proxy = tmeshlist[t]->m_proxy;
+		before += proxy.m_acmrBefore * proxy.numTriangles();
+		after += proxy.m_acmrAfter * proxy.numTriangles();
+		triangles += proxy.numTriangles();
+	}
+	for (size_t h = 0; h < hmeshlist.size(); h++)
+	{
+		CSurfaceProxy & proxy = hmeshlist[h]->m_proxy;
+		before += proxy.m_acmrBefore * proxy.numTriangles();
+		after += proxy.m_acmrAfter * proxy.numTriangles();
+		triangles += proxy.numTriangles();
+	}
+
+	if (triangles > 0)
+	{
+		frameStats.setValue("proxy_acmr_before", before / triangles);
+		frameStats.setValue("proxy_acmr_after", after / triangles);
+	}
+}
+
+SurfaceBuffer * VolViewer::surfaceBuffer(const void * halffaces)
+{
+	std::map<const void*, SurfaceBuffer*>::iterator bIter = surfaceBuffers.find(halffaces);
+	if (bIter != surfaceBuffers.end())
+	{
+		return bIter->second;
+	}
+
+	SurfaceBuffer * buffer = new SurfaceBuffer();
+	buffer->setHiddenGroups(&hiddenGroups);
+	surfaceBuffers[halffaces] = buffer;
+	return buffer;
+}
+
+PointBuffer * VolViewer::pointBuffer(const void * mesh)
+{
+	std::map<const void*, PointBuffer*>::iterator bIter = pointBuffers.find(mesh);
+	if (bIter != pointBuffers.end())
+	{
+		return bIter->second;
+	}
+
+	PointBuffer * buffer = new PointBuffer();
+	pointBuffers[mesh] = buffer;
+	return buffer;
+}
+
+FiberBuffer * VolViewer::fiberBuffer(const void * mesh)
+{
+	std::map<const void*, FiberBuffer*>::iterator bIter = fiberBuffers.find(mesh);
+	if (bIter != fiberBuffers.end())
+	{
+		return bIter->second;
+	}
+
+	FiberBuffer * buffer = new FiberBuffer();
+	fiberBuffers[mesh] = buffer;
+	return buffer;
+}
+
+GlyphBuffer * VolViewer::glyphBuffer(const void * mesh)
+{
+	std::map<const void*, GlyphBuffer*>::iterator bIter = glyphBuffers.find(mesh);
+	if (bIter != glyphBuffers.end())
+	{
+		return bIter->second;
+	}
+
+	GlyphBuffer * buffer = new GlyphBuffer();
+	glyphBuffers[mesh] = buffer;
+	return buffer;
+}
+
+ProxyBuffer * VolViewer::proxyBuffer(const void * mesh)
+{
+	std::map<const void*, ProxyBuffer*>::iterator bIter = proxyBuffers.find(mesh);
+	if (bIter != proxyBuffers.end())
+	{
+		return bIter->second;
+	}
+
+	ProxyBuffer * buffer = new ProxyBuffer();
+	proxyBuffers[mesh] = buffer;
+	return buffer;
+}
+
+SectionBuffer * VolViewer::sectionBuffer(const void * mesh)
+{
+	std::map<const void*, SectionBuffer*>::iterator bIter = sectionBuffers.find(mesh);
+	if (bIter != sectionBuffers.end())
+	{
+		return bIter->second;
+	}
+
+	SectionBuffer * buffer = new SectionBuffer();
+	sectionBuffers[mesh] = buffer;
+	return buffer;
+}
+
+void VolViewer::clearBuffers()
+{
+	for (std::map<const void*, SurfaceBuffer*>::iterator bIter = surfaceBuffers.begin(); bIter != surfaceBuffers.end(); bIter++)
+	{
+		delete bIter->second;
+	}
+	surfaceBuffers.clear();
+
+	for (std::map<const void*, PointBuffer*>::iterator pIter = pointBuffers.begin(); pIter != pointBuffers.end(); pIter++)
+	{
+		delete pIter->second;
+	}
+	pointBuffers.clear();
+
+	for (std::map<const void*, FiberBuffer*>::iterator fIter = fiberBuffers.begin(); fIter != fiberBuffers.end(); fIter++)
+	{
+		delete fIter->second;
+	}
+	fiberBuffers.clear();
+
+	for (std::map<const void*, GlyphBuffer*>::iterator gIter = glyphBuffers.begin(); gIter != glyphBuffers.end(); gIter++)
+	{
+		delete gIter->second;
+	}
+	glyphBuffers.clear();
+
+	for (std::map<const void*, ProxyBuffer*>::iterator pIter = proxyBuffers.begin(); pIter != proxyBuffers.end(); pIter++)
+	{
+		delete pIter->second;
+	}
+	proxyBuffers.clear();
+
+	for (std::map<const void*, SectionBuffer*>::iterator sIter = sectionBuffers.begin(); sIter != sectionBuffers.end(); sIter++)
+	{
+		delete sIter->second;
+	}
+	sectionBuffers.clear();
+}
+
+SurfaceBuffer::TextureMode VolViewer::surfaceTexture() const
+{
+	// the texture environment set up by drawMesh for the draw mode
+	switch (meshDrawMode)
+	{
+	case DRAW_MODE::TEXTURE:
+		return SurfaceBuffer::REPLACE;
+	case DRAW_MODE::TEXTUREMODULATE:
+		return SurfaceBuffer::MODULATE;
+	default:
+		return SurfaceBuffer::UNTEXTURED;
+	}
 }
 
 void VolViewer::drawHalfFaces(TMeshLib::CVTMesh * mesh, std::vector<TMeshLib::CViewerHalfFace*> & HalfFaces)
 {
+	if (!isRetainedMode)
+	{
+		drawHalfFacesImmediate(mesh, HalfFaces);
+		return;
+	}
+
+	// while the view moves, the visible surface is replaced by its proxy once it is built, textures, hidden groups and
+	// shrunk elements need the full surface
+	if (isInteracting && &HalfFaces == &mesh->m_pHFaces_Below && surfaceTexture() == SurfaceBuffer::UNTEXTURED && hiddenGroups.empty() &&
+		meshDrawMode != DRAW_MODE::SHRINK)
+	{
+		ProxyBuffer * proxy = proxyBuffer(mesh);
+		if (proxy->update(mesh))
+		{
+			proxy->draw();
+			frameStats.addTriangles(proxy->numTriangles());
+			frameStats.addUpload(proxy->uploadedBytes());
+			return;
+		}
+	}
+
+	// the lists only change when the cut buffers are swapped, the buffer follows the versions of the mesh
+	SurfaceBuffer * buffer = surfaceBuffer(&HalfFaces);
+	buffer->setSmooth(meshDrawMode == DRAW_MODE::SMOOTH);
+	buffer->setShrunk(meshDrawMode == DRAW_MODE::SHRINK);
+	buffer->setShrinkFactor(shrinkFactor);
+	buffer->update(mesh, HalfFaces);
+
+	glBindTexture(GL_TEXTURE_2D, texName);
+	buffer->draw(matModelView, matProjection, isLightOn, surfaceTexture());
+	frameStats.addTriangles(buffer->numDrawnTriangles());
+	frameStats.addUpload(buffer->uploadedBytes());
+}
+
+void VolViewer::drawHalfFaces(HMeshLib::CVHMesh * hmesh, std::vector<HMeshLib::CHViewerHalfFace*> & HalfFaces)
+{
+	if (!isRetainedMode)
+	{
+		drawHalfFacesImmediate(hmesh, HalfFaces);
+		return;
+	}
+
+	if (isInteracting && &HalfFaces == &hmesh->m_pHFaces_Below && surfaceTexture() == SurfaceBuffer::UNTEXTURED && hiddenGroups.empty() &&
+		meshDrawMode != DRAW_MODE::SHRINK)
+	{
+		ProxyBuffer * proxy = proxyBuffer(hmesh);
+		if (proxy->update(hmesh))
+		{
+			proxy->draw();
+			frameStats.addTriangles(proxy->numTriangles());
+			frameStats.addUpload(proxy->uploadedBytes());
+			return;
+		}
+	}
+
+	SurfaceBuffer * buffer = surfaceBuffer(&HalfFaces);
+	buffer->setSmooth(meshDrawMode == DRAW_MODE::SMOOTH);
+	buffer->setShrunk(meshDrawMode == DRAW_MODE::SHRINK);
+	buffer->setShrinkFactor(shrinkFactor);
+	buffer->update(hmesh, HalfFaces);
+
+	glBindTexture(GL_TEXTURE_2D, texName);
+	buffer->draw(matModelView, matProjection, isLightOn, surfaceTexture());
+	frameStats.addTriangles(buffer->numDrawnTriangles());
+	frameStats.addUpload(buffer->uploadedBytes());
+}
+
+void VolViewer::drawHalfFacesImmediate(TMeshLib::CVTMesh * mesh, std::vector<TMeshLib::CViewerHalfFace*> & HalfFaces)
+{
+	// there are no vertex normals and centroids without the buffers, smooth and shrunk fall back to flat here
+	frameStats.addTriangles(HalfFaces.size());
 	glBindTexture(GL_TEXTURE_2D, texName);
 	glBegin(GL_TRIANGLES);
 	for (std::vector<TMeshLib::CViewerHalfFace*>::iterator hfIter = HalfFaces.begin(); hfIter != HalfFaces.end(); hfIter++)
@@ -301,28 +650,17 @@ void VolViewer::drawHalfFaces(TMeshLib::CVTMesh * mesh, std::vector<TMeshLib::CV
 		TMeshLib::CViewerHalfFace * pHF = *hfIter;
 		TMeshLib::CViewerFace * pF = mesh->HalfFaceFace(pHF);
 		TMeshLib::CViewerTet * pT = mesh->HalfFaceTet(pHF);
-		if (pF->selected())
-		{
-			glColor3f(0.0, 0.5, 1.0);
-		}
-		else if (pT->group() == 0 || pT->group() == 1)
+		if (hiddenGroups.count(pT->group()) != 0)
 		{
-			glColor3f(1.0, 0.5, 0.0);
-		}
-		else if (pT->group() == 2)
-		{
-			glColor3d(0.95, 0.05, 0.95);
-		}
-		else if (pT->group() == 3)
-		{
-			glColor3d(0.05, 0.95, 0.95);
+			continue;
 		}
+		glColor4ubv(pF->selected() ? CGroupColors::selected() : CGroupColors::color(pT->group()));
 
+		CPoint n = mesh->_halfface_normal(pHF);
 		for (TMeshLib::CVTMesh::HalfFaceVertexIterator fvIter(mesh, pHF); !fvIter.end(); ++fvIter)
 		{
 			TMeshLib::CViewerVertex * v = *fvIter;
 			CPoint pt = v->position();
-			CPoint n = pHF->normal();
 			CPoint2 uv = v->uv();
 			glNormal3d(n[0], n[1], n[2]);
 			glTexCoord2d(uv[0], uv[1]);
@@ -332,80 +670,209 @@ void VolViewer::drawHalfFaces(TMeshLib::CVTMesh * mesh, std::vector<TMeshLib::CV
 	glEnd();
 }
 
-void VolViewer::drawHalfFaces(HMeshLib::CVHMesh * hmesh, std::vector<HMeshLib::CHViewerHalfFace*> & HalfFaces)
+void VolViewer::drawHalfFacesImmediate(HMeshLib::CVHMesh * hmesh, std::vector<HMeshLib::CHViewerHalfFace*> & HalfFaces)
 {
+	// there are no vertex normals and centroids without the buffers, smooth and shrunk fall back to flat here
+	// a quad is two triangles on the GPU
+	frameStats.addTriangles(2 * HalfFaces.size());
 	glBindTexture(GL_TEXTURE_2D, texName);
 
+	// every quad is split along the diagonal from its first corner, as in the buffers
+	static const int quadTriangles[6] = { 0, 1, 2, 0, 2, 3 };
+
+	// hexes carry no group, they are all in group 0
+	if (hiddenGroups.count(0) != 0)
+	{
+		return;
+	}
+
+	glBegin(GL_TRIANGLES);
 	for (std::vector<HMeshLib::CHViewerHalfFace*>::iterator hfIter = HalfFaces.begin(); hfIter != HalfFaces.end(); hfIter++)
 	{
-		glBegin(GL_POLYGON);
 		HMeshLib::CHViewerHalfFace * pHF = *hfIter;
 		HMeshLib::CHViewerFace * pF = hmesh->HalfFaceFace(pHF);
 
-		if (pF->selected())
+		glColor4ubv(pF->selected() ? CGroupColors::selected() : CGroupColors::color(0));
+
+		HMeshLib::CHViewerVertex * corners[4];
+		int k = 0;
+		for (HMeshLib::CVHMesh::HalfFaceVertexIterator fvIter(hmesh, pHF); !fvIter.end() && k < 4; ++fvIter)
 		{
-			glColor3f(0.0, 0.5, 1.0);
+			corners[k++] = *fvIter;
 		}
-		else
+		if (k < 4)
 		{
-			glColor3f(1.0, 0.5, 0.0);
+			continue;
 		}
 
-		for (HMeshLib::CVHMesh::HalfFaceVertexIterator fvIter(hmesh, pHF); !fvIter.end(); ++fvIter)
+		CPoint n = hmesh->_halfface_normal(pHF);
+		for (int i = 0; i < 6; i++)
 		{
-			HMeshLib::CHViewerVertex * v = *fvIter;
+			HMeshLib::CHViewerVertex * v = corners[quadTriangles[i]];
 			CPoint pt = v->position();
-			CPoint n = pHF->normal();
 			CPoint2 uv = v->uv();
 			glNormal3d(n[0], n[1], n[2]);
 			glTexCoord2d(uv[0], uv[1]);
 			glVertex3d(pt[0], pt[1], pt[2]);
 		}
-		glEnd();
 	}
+	glEnd();
+}
 
+void VolViewer::drawHalfFaceOutlines(TMeshLib::CVTMesh * mesh, std::vector<TMeshLib::CViewerHalfFace*> & HalfFaces, const GLubyte * color)
+{
+	if (!isRetainedMode)
+	{
+		drawHalfFaceOutlinesImmediate(mesh, HalfFaces, color);
+		return;
+	}
+
+	// the buffer of the faces keeps their unique edges as well, a shared edge is drawn once
+	SurfaceBuffer * buffer = surfaceBuffer(&HalfFaces);
+	buffer->setShrunk(meshDrawMode == DRAW_MODE::SHRINK);
+	buffer->setShrinkFactor(shrinkFactor);
+	buffer->update(mesh, HalfFaces);
+	buffer->drawOutlines(matModelView, matProjection, color);
+	frameStats.addLines(2 * buffer->numDrawnEdges());
+	frameStats.addUpload(buffer->uploadedBytes());
 }
 
-void VolViewer::drawMeshPoints(TMeshLib::CVTMesh * mesh)
+void VolViewer::drawHalfFaceOutlines(HMeshLib::CVHMesh * hmesh, std::vector<HMeshLib::CHViewerHalfFace*> & HalfFaces, const GLubyte * color)
 {
-	for (TMeshLib::CVTMesh::MeshVertexIterator vIter(mesh); !vIter.end(); vIter++)
+	if (!isRetainedMode)
 	{
-		TMeshLib::CViewerVertex * pV = *vIter;
-		CPoint pos = pV->position();
-		glPointSize(6);
-		if (pV->selected())
+		drawHalfFaceOutlinesImmediate(hmesh, HalfFaces, color);
+		return;
+	}
+
+	SurfaceBuffer * buffer = surfaceBuffer(&HalfFaces);
+	buffer->setShrunk(meshDrawMode == DRAW_MODE::SHRINK);
+	buffer->setShrinkFactor(shrinkFactor);
+	buffer->update(hmesh, HalfFaces);
+	buffer->drawOutlines(matModelView, matProjection, color);
+	frameStats.addLines(2 * buffer->numDrawnEdges());
+	frameStats.addUpload(buffer->uploadedBytes());
+}
+
+void VolViewer::drawHalfFaceOutlinesImmediate(TMeshLib::CVTMesh * mesh, std::vector<TMeshLib::CViewerHalfFace*> & HalfFaces, const GLubyte * color)
+{
+	frameStats.addLines(6 * HalfFaces.size());
+
+	glBegin(GL_LINES);
+	if (color != NULL)
+	{
+		glColor4ubv(color);
+	}
+	for (std::vector<TMeshLib::CViewerHalfFace*>::iterator hfIter = HalfFaces.begin(); hfIter != HalfFaces.end(); hfIter++)
+	{
+		TMeshLib::CViewerHalfFace * pHF = *hfIter;
+		TMeshLib::CViewerFace * pF = mesh->HalfFaceFace(pHF);
+		TMeshLib::CViewerTet * pT = mesh->HalfFaceTet(pHF);
+		if (hiddenGroups.count(pT->group()) != 0)
 		{
-			glColor3d(1.0, 0.2, 0.1);
+			continue;
 		}
-		else
+		if (color == NULL)
+		{
+			glColor4ubv(pF->selected() ? CGroupColors::selected() : CGroupColors::color(pT->group()));
+		}
+
+		CPoint corners[3];
+		int k = 0;
+		for (TMeshLib::CVTMesh::HalfFaceVertexIterator fvIter(mesh, pHF); !fvIter.end() && k < 3; ++fvIter)
 		{
-			glColor3d(1.0, 0.5, 0.0);
+			corners[k++] = (*fvIter)->position();
+		}
+
+		CPoint n = mesh->_halfface_normal(pHF);
+		glNormal3d(n[0], n[1], n[2]);
+		for (int i = 0; i < k; i++)
+		{
+			CPoint & a = corners[i];
+			CPoint & b = corners[(i + 1) % k];
+			glVertex3d(a[0], a[1], a[2]);
+			glVertex3d(b[0], b[1], b[2]);
 		}
-		glBegin(GL_POINTS);
-		glVertex3d(pos[0], pos[1], pos[2]);
-		glEnd();
 	}
+	glEnd();
 }
 
-void VolViewer::drawMeshPoints(HMeshLib::CVHMesh * hmesh)
+void VolViewer::drawHalfFaceOutlinesImmediate(HMeshLib::CVHMesh * hmesh, std::vector<HMeshLib::CHViewerHalfFace*> & HalfFaces, const GLubyte * color)
 {
-	for (HMeshLib::CVHMesh::MeshVertexIterator vIter(hmesh); !vIter.end(); vIter++)
+	frameStats.addLines(8 * HalfFaces.size());
+	if (hiddenGroups.count(0) != 0)
 	{
-		HMeshLib::CHViewerVertex * pV = *vIter;
-		CPoint pos = pV->position();
-		glPointSize(6);
-		if (pV->selected())
+		return;
+	}
+
+	glBegin(GL_LINES);
+	if (color != NULL)
+	{
+		glColor4ubv(color);
+	}
+	for (std::vector<HMeshLib::CHViewerHalfFace*>::iterator hfIter = HalfFaces.begin(); hfIter != HalfFaces.end(); hfIter++)
+	{
+		HMeshLib::CHViewerHalfFace * pHF = *hfIter;
+		HMeshLib::CHViewerFace * pF = hmesh->HalfFaceFace(pHF);
+
+		if (color == NULL)
 		{
-			glColor3d(1.0, 0.2, 0.1);
+			glColor4ubv(pF->selected() ? CGroupColors::selected() : CGroupColors::color(0));
 		}
-		else
+
+		CPoint corners[4];
+		int k = 0;
+		for (HMeshLib::CVHMesh::HalfFaceVertexIterator fvIter(hmesh, pHF); !fvIter.end() && k < 4; ++fvIter)
 		{
-			glColor3d(1.0, 0.5, 0.0);
+			corners[k++] = (*fvIter)->position();
+		}
+
+		CPoint n = hmesh->_halfface_normal(pHF);
+		glNormal3d(n[0], n[1], n[2]);
+		for (int i = 0; i < k; i++)
+		{
+			CPoint & a = corners[i];
+			CPoint & b = corners[(i + 1) % k];
+			glVertex3d(a[0], a[1], a[2]);
+			glVertex3d(b[0], b[1], b[2]);
 		}
-		glBegin(GL_POINTS);
-		glVertex3d(pos[0], pos[1], pos[2]);
-		glEnd();
 	}
+	glEnd();
+}
+
+void VolViewer::drawMeshPoints(TMeshLib::CVTMesh * mesh)
+{
+	PointBuffer * buffer = pointBuffer(mesh);
+	buffer->update(mesh);
+	frameStats.addPoints(buffer->numPoints() + buffer->numSelected());
+	frameStats.addUpload(buffer->uploadedBytes());
+
+	glPointSize(6);
+	glColor3d(1.0, 0.5, 0.0);
+	buffer->drawPoints();
+
+	// the selected points are drawn again on top, the depth test passes for equal depths
+	glDepthFunc(GL_LEQUAL);
+	glColor3d(1.0, 0.2, 0.1);
+	buffer->drawSelected();
+	glDepthFunc(GL_LESS);
+}
+
+void VolViewer::drawMeshPoints(HMeshLib::CVHMesh * hmesh)
+{
+	PointBuffer * buffer = pointBuffer(hmesh);
+	buffer->update(hmesh);
+	frameStats.addPoints(buffer->numPoints() + buffer->numSelected());
+	frameStats.addUpload(buffer->uploadedBytes());
+
+	glPointSize(6);
+	glColor3d(1.0, 0.5, 0.0);
+	buffer->drawPoints();
+
+	glDepthFunc(GL_LEQUAL);
+	glColor3d(1.0, 0.2, 0.1);
+	buffer->drawSelected();
+	glDepthFunc(GL_LESS);
 }
 
 void VolViewer::drawSphere(CPoint center, double radius)
@@ -419,96 +886,125 @@ void VolViewer::drawSphere(CPoint center, double radius)
 
 void VolViewer::drawFiber(TMeshLib::CVTMesh * mesh)
 {
+	// the fibers are uploaded once, fiberMinLength only shortens the draw list
+	FiberBuffer * buffer = fiberBuffer(mesh);
+	buffer->update(mesh);
+	buffer->draw(fiberMinLength, matModelView, matProjection, viewPort);
+	frameStats.addLines(buffer->numDrawnPoints());
+	frameStats.addUpload(buffer->uploadedBytes());
+}
 
-	getGLMatrix();
+void VolViewer::drawVector(TMeshLib::CVTMesh * mesh)
+{
+	// the glyphs are computed once, the level of subsampling follows the zoom
+	GlyphBuffer * buffer = glyphBuffer(mesh);
+	buffer->update(mesh);
+	buffer->draw(matModelView, matProjection, viewPort);
+	// every arrow is five lines
+	frameStats.addLines(10 * buffer->numDrawnGlyphs());
+	frameStats.addUpload(buffer->uploadedBytes());
+}
 
-	glMatrixMode(GL_PROJECTION);
-	glLoadMatrixd(matProjection);
-	glMatrixMode(GL_MODELVIEW);
-	glLoadMatrixd(matModelView);
+void VolViewer::enableSectionClipPlane(CCrossSection & section)
+{
+	// keep the half space n * p <= d, the same side as the faces below the cut
+	GLdouble equation[4] = { -section.m_normal[0], -section.m_normal[1], -section.m_normal[2], section.m_d };
+	glClipPlane(GL_CLIP_PLANE0, equation);
+	glEnable(GL_CLIP_PLANE0);
+}
 
-	std::list<TMeshLib::CFiber*> fibers = mesh->fibers();
+void VolViewer::drawCrossSection(SectionBuffer * buffer)
+{
+	buffer->draw(hiddenGroups);
+	frameStats.addTriangles(buffer->numDrawnTriangles());
+	frameStats.addUpload(buffer->uploadedBytes());
+}
 
-	std::uniform_real_distribution<double> unif(0.0, 1.0);
-	std::default_random_engine dre;
+void VolViewer::drawCrossSectionImmediate(CCrossSection & section)
+{
+	CPoint n = section.m_normal;
 
-	for (std::list<TMeshLib::CFiber*>::iterator fIter = fibers.begin(); fIter != fibers.end(); fIter++)
+	glBegin(GL_TRIANGLES);
+	for (size_t f = 0; f < section.numPolygons(); f++)
 	{
-		TMeshLib::CFiber * pFiber = *fIter;
-		std::list<CPoint> pointList = pFiber->points();
-		if (pointList.size() < fiberMinLength)
+		// the polygon takes the color of the group of its element, like the faces around it
+		int group = section.m_polygonGroup[f];
+		if (hiddenGroups.count(group) != 0)
 		{
 			continue;
 		}
+		glColor4ubv(CGroupColors::color(group));
 
-		double r = unif(dre);
-		double g = unif(dre);
-		double b = unif(dre);
-		glColor3f(r, g, b);
-		glBegin(GL_LINE_STRIP);
-		for (std::list<CPoint>::iterator pIter = pointList.begin(); pIter != pointList.end(); pIter++)
+		// the polygons are convex, draw them as fans
+		int first = section.m_polygonStart[f];
+		frameStats.addTriangles(std::max(section.m_polygonStart[f + 1] - first - 2, 0));
+		for (int k = first + 1; k + 1 < section.m_polygonStart[f + 1]; k++)
 		{
-			CPoint p = *pIter;
-			glVertex3f(p[0], p[1], p[2]);
+			int corners[3] = { first, k, k + 1 };
+			for (int c = 0; c < 3; c++)
+			{
+				CSectionPoint & sp = section.m_points[corners[c]];
+				glNormal3d(n[0], n[1], n[2]);
+				glTexCoord2d(sp.m_uv[0], sp.m_uv[1]);
+				glVertex3d(sp.m_position[0], sp.m_position[1], sp.m_position[2]);
+			}
 		}
-		glEnd();
 	}
+	glEnd();
 }
 
-void VolViewer::drawVector()
+void VolViewer::drawSection(TMeshLib::CVTMesh * mesh)
 {
+	// the faces below a plane cut are clipped at the plane, the section closes the clipped volume,
+	// other cuts and planes missing the mesh have no section and their faces are drawn as they are
+	if (cutType != CUT_TYPE::PLANE || mesh->m_section.numPolygons() == 0)
+	{
+		drawHalfFaces(mesh, mesh->m_pHFaces_Below);
+		return;
+	}
 
-	getGLMatrix();
-
-	glMatrixMode(GL_PROJECTION);
-	glLoadMatrixd(matProjection);
-	glMatrixMode(GL_MODELVIEW);
-	glLoadMatrixd(matModelView);
-
-	glBegin(GL_LINES);
-	for (size_t t = 0; t < tmeshlist.size(); t++)
+	enableSectionClipPlane(mesh->m_section);
+	drawHalfFaces(mesh, mesh->m_pHFaces_Below);
+	glDisable(GL_CLIP_PLANE0);
+
+	if (!isRetainedMode)
 	{
-		TMeshLib::CVTMesh * mesh = tmeshlist[t];
+		drawCrossSectionImmediate(mesh->m_section);
+		return;
+	}
 
-		for (TMeshLib::CVTMesh::MeshTetIterator tIter(mesh); !tIter.end(); tIter++)
-		{
-			TMeshLib::CViewerTet * pT = *tIter;
+	// the section is uploaded once per cut
+	SectionBuffer * buffer = sectionBuffer(mesh);
+	buffer->update(mesh);
+	drawCrossSection(buffer);
+}
 
-			CPoint vectorTemp = pT->vector();
-			if (vectorTemp.norm() < 1.0)
-			{
-				continue;
-			}
-			std::cout << pT->id() << std::endl;
-			glColor3f(1.0, 0, 0);
-			CPoint tetCentral(0.0, 0.0, 0.0);
-			for (int j = 0; j < 4; j++)
-			{
-				TMeshLib::CViewerVertex * pV = mesh->TetVertex(pT, j);
-				tetCentral = tetCentral + 0.25 * pV->position();
-			}
-			//tetCentral = mesh->idVertex(5)->position();
-			glVertex3f(tetCentral[0], tetCentral[1], tetCentral[2]);
+void VolViewer::drawSection(HMeshLib::CVHMesh * mesh)
+{
+	if (cutType != CUT_TYPE::PLANE || mesh->m_section.numPolygons() == 0)
+	{
+		drawHalfFaces(mesh, mesh->m_pHFaces_Below);
+		return;
+	}
 
-			CPoint vector = pT->vector();
-			CPoint endPoint = tetCentral + 0.3 * vector;
-			glVertex3f(endPoint[0], endPoint[1], endPoint[2]);
-		}
+	enableSectionClipPlane(mesh->m_section);
+	drawHalfFaces(mesh, mesh->m_pHFaces_Below);
+	glDisable(GL_CLIP_PLANE0);
+
+	if (!isRetainedMode)
+	{
+		drawCrossSectionImmediate(mesh->m_section);
+		return;
 	}
 
-	glEnd();
+	// the section is uploaded once per cut
+	SectionBuffer * buffer = sectionBuffer(mesh);
+	buffer->update(mesh);
+	drawCrossSection(buffer);
 }
 
 void VolViewer::drawMesh(HMeshLib::CVHMesh * mesh)
 {
-
-	getGLMatrix();
-
-	glMatrixMode(GL_PROJECTION);
-	glLoadMatrixd(matProjection);
-	glMatrixMode(GL_MODELVIEW);
-	glLoadMatrixd(matModelView);
-
 	switch (meshDrawMode)
 	{
 	case DRAW_MODE::NONE:
@@ -521,17 +1017,20 @@ void VolViewer::drawMesh(HMeshLib::CVHMesh * mesh)
 
 	case DRAW_MODE::WIREFRAME:
 		glDisable(GL_TEXTURE_2D);
-		glPolygonMode(GL_FRONT, GL_LINE);
-		drawHalfFaces(mesh, mesh->m_pHFaces_Below);
+		glPolygonMode(GL_FRONT, GL_FILL);
+		drawHalfFaceOutlines(mesh, mesh->m_pHFaces_Below, NULL);
 		drawSelectedVertex(mesh);
 		break;
 
 	case DRAW_MODE::FLATLINES:
 		glDisable(GL_TEXTURE_2D);
-		glPolygonMode(GL_FRONT, GL_LINE);
-		drawHalfFaces(mesh, mesh->m_pHFaces_Above);
 		glPolygonMode(GL_FRONT, GL_FILL);
+		// the faces are pushed back so their own edges win the depth test
+		glEnable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(1.0, 1.0);
 		drawHalfFaces(mesh, mesh->m_pHFaces_Below);
+		glDisable(GL_POLYGON_OFFSET_FILL);
+		drawHalfFaceOutlines(mesh, mesh->m_pHFaces_Below, wireColor);
 		drawSelectedVertex(mesh);
 		break;
 
@@ -542,6 +1041,26 @@ void VolViewer::drawMesh(HMeshLib::CVHMesh * mesh)
 		drawSelectedVertex(mesh);
 		break;
 
+	case DRAW_MODE::SMOOTH:
+		// the surface buffer follows the draw mode and lights the faces with the normals of their vertices
+		glDisable(GL_TEXTURE_2D);
+		glPolygonMode(GL_FRONT, GL_FILL);
+		drawHalfFaces(mesh, mesh->m_pHFaces_Below);
+		drawSelectedVertex(mesh);
+		break;
+
+	case DRAW_MODE::SHRINK:
+		// every element kept by the cut with all its faces, moved toward its centroid together with its outline
+		glDisable(GL_TEXTURE_2D);
+		glPolygonMode(GL_FRONT, GL_FILL);
+		glEnable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(1.0, 1.0);
+		drawHalfFaces(mesh, mesh->m_pHFaces_Elements);
+		glDisable(GL_POLYGON_OFFSET_FILL);
+		drawHalfFaceOutlines(mesh, mesh->m_pHFaces_Elements, wireColor);
+		drawSelectedVertex(mesh);
+		break;
+
 	case DRAW_MODE::BOUNDARY:
 		glDisable(GL_TEXTURE_2D);
 		glPolygonMode(GL_FRONT, GL_FILL);
@@ -563,10 +1082,16 @@ void VolViewer::drawMesh(HMeshLib::CVHMesh * mesh)
 	case DRAW_MODE::VECTOR:
 		glDisable(GL_TEXTURE_2D);
 		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-		drawVector();
 		drawMeshPoints(mesh);
 		break;
 
+	case DRAW_MODE::SECTION:
+		glDisable(GL_TEXTURE_2D);
+		glPolygonMode(GL_FRONT, GL_FILL);
+		drawSection(mesh);
+		drawSelectedVertex(mesh);
+		break;
+
 	default:
 		break;
 	}
@@ -575,13 +1100,6 @@ void VolViewer::drawMesh(HMeshLib::CVHMesh * mesh)
 
 void VolViewer::drawMesh(TMeshLib::CVTMesh * mesh)
 {
-	getGLMatrix();
-
-	glMatrixMode(GL_PROJECTION);
-	glLoadMatrixd(matProjection);
-	glMatrixMode(GL_MODELVIEW);
-	glLoadMatrixd(matModelView);
-
 	switch (meshDrawMode)
 	{
 	case DRAW_MODE::NONE:
@@ -594,17 +1112,20 @@ void VolViewer::drawMesh(TMeshLib::CVTMesh * mesh)
 
 	case DRAW_MODE::WIREFRAME:
 		glDisable(GL_TEXTURE_2D);
-		glPolygonMode(GL_FRONT, GL_LINE);
-		drawHalfFaces(mesh, mesh->m_pHFaces_Below);
+		glPolygonMode(GL_FRONT, GL_FILL);
+		drawHalfFaceOutlines(mesh, mesh->m_pHFaces_Below, NULL);
 		drawSelectedVertex(mesh);
 		break;
 
 	case DRAW_MODE::FLATLINES:
 		glDisable(GL_TEXTURE_2D);
-		glPolygonMode(GL_FRONT, GL_LINE);
-		drawHalfFaces(mesh, mesh->m_pHFaces_Above);
 		glPolygonMode(GL_FRONT, GL_FILL);
+		// the faces are pushed back so their own edges win the depth test
+		glEnable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(1.0, 1.0);
 		drawHalfFaces(mesh, mesh->m_pHFaces_Below);
+		glDisable(GL_POLYGON_OFFSET_FILL);
+		drawHalfFaceOutlines(mesh, mesh->m_pHFaces_Below, wireColor);
 		drawSelectedVertex(mesh);
 		break;
 
@@ -615,6 +1136,26 @@ void VolViewer::drawMesh(TMeshLib::CVTMesh * mesh)
 		drawSelectedVertex(mesh);
 		break;
 
+	case DRAW_MODE::SMOOTH:
+		// the surface buffer follows the draw mode and lights the faces with the normals of their vertices
+		glDisable(GL_TEXTURE_2D);
+		glPolygonMode(GL_FRONT, GL_FILL);
+		drawHalfFaces(mesh, mesh->m_pHFaces_Below);
+		drawSelectedVertex(mesh);
+		break;
+
+	case DRAW_MODE::SHRINK:
+		// every element kept by the cut with all its faces, moved toward its centroid together with its outline
+		glDisable(GL_TEXTURE_2D);
+		glPolygonMode(GL_FRONT, GL_FILL);
+		glEnable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(1.0, 1.0);
+		drawHalfFaces(mesh, mesh->m_pHFaces_Elements);
+		glDisable(GL_POLYGON_OFFSET_FILL);
+		drawHalfFaceOutlines(mesh, mesh->m_pHFaces_Elements, wireColor);
+		drawSelectedVertex(mesh);
+		break;
+
 	case DRAW_MODE::BOUNDARY:
 		glDisable(GL_TEXTURE_2D);
 		glPolygonMode(GL_FRONT, GL_FILL);
@@ -636,10 +1177,17 @@ void VolViewer::drawMesh(TMeshLib::CVTMesh * mesh)
 	case DRAW_MODE::VECTOR:
 		glDisable(GL_TEXTURE_2D);
 		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-		drawVector();
+		drawVector(mesh);
 		drawMeshPoints(mesh);
 		break;
 
+	case DRAW_MODE::SECTION:
+		glDisable(GL_TEXTURE_2D);
+		glPolygonMode(GL_FRONT, GL_FILL);
+		drawSection(mesh);
+		drawSelectedVertex(mesh);
+		break;
+
 	default:
 		break;
 	}
@@ -685,58 +1233,44 @@ void VolViewer::initTexture()
 
 void VolViewer::drawSelectedVertex(TMeshLib::CVTMesh * mesh)
 {
-	for (TMeshLib::CVTMesh::MeshVertexIterator vIter(mesh); !vIter.end(); vIter++)
-	{
-		TMeshLib::CViewerVertex * pV = *vIter;
-		if (pV->selected())
-		{
-			CPoint pt = pV->position();
-			glPointSize(6);
-			glColor3f(0.0, 0.5, 1.0);
-			glBegin(GL_POINTS);
-			glVertex3d(pt[0], pt[1], pt[2]);
-			glEnd();
-		}
-	}
+	PointBuffer * buffer = pointBuffer(mesh);
+	buffer->update(mesh);
+	frameStats.addPoints(buffer->numSelected());
+	frameStats.addUpload(buffer->uploadedBytes());
+
+	glPointSize(6);
+	glColor3f(0.0, 0.5, 1.0);
+	buffer->drawSelected();
 }
 
 void VolViewer::drawSelectedVertex(HMeshLib::CVHMesh * mesh)
 {
-	for (HMeshLib::CVHMesh::MeshVertexIterator vIter(mesh); !vIter.end(); vIter++)
-	{
-		HMeshLib::CHViewerVertex * pV = *vIter;
-		if (pV->selected())
-		{
-			CPoint pt = pV->position();
-			glPointSize(6);
-			glColor3f(0.0, 0.5, 1.0);
-			glBegin(GL_POINTS);
-			glVertex3d(pt[0], pt[1], pt[2]);
-			glEnd();
-		}
-	}
+	PointBuffer * buffer = pointBuffer(mesh);
+	buffer->update(mesh);
+	frameStats.addPoints(buffer->numSelected());
+	frameStats.addUpload(buffer->uploadedBytes());
+
+	glPointSize(6);
+	glColor3f(0.0, 0.5, 1.0);
+	buffer->drawSelected();
 }
 
 void VolViewer::drawBoundaryHalfFaces(TMeshLib::CVTMesh * mesh)
 {
-	std::vector<TMeshLib::CViewerHalfFace *> halffaceList = mesh->m_pHFaces_Below;
+	std::vector<TMeshLib::CViewerHalfFace *> & halffaceList = mesh->belowBoundaryHalfFaces();
 	glBegin(GL_TRIANGLES);
 	for (std::vector<TMeshLib::CViewerHalfFace*>::iterator iter = halffaceList.begin(); iter != halffaceList.end(); iter++)
 	{
 		TMeshLib::CViewerHalfFace * pHF = *iter;
-		TMeshLib::CViewerHalfFace * pHD = mesh->HalfFaceDual(pHF);
-		if (pHD == NULL)
+		frameStats.addTriangles(1);
+		glColor3f(1.0, 0.0, 0.0);
+		CPoint n = mesh->_halfface_normal(pHF);
+		for (TMeshLib::CVTMesh::HalfFaceVertexIterator fvIter(mesh, pHF); !fvIter.end(); ++fvIter)
 		{
-			glColor3f(1.0, 0.0, 0.0);
-			for (TMeshLib::CVTMesh::HalfFaceVertexIterator fvIter(mesh, pHF); !fvIter.end(); ++fvIter)
-			{
-				TMeshLib::CViewerVertex * v = *fvIter;
-				CPoint pt = v->position();
-				CPoint n = pHF->normal();
-				CPoint2 uv = v->uv();
-				glNormal3d(n[0], n[1], n[2]);
-				glVertex3d(pt[0], pt[1], pt[2]);
-			}
+			TMeshLib::CViewerVertex * v = *fvIter;
+			CPoint pt = v->position();
+			glNormal3d(n[0], n[1], n[2]);
+			glVertex3d(pt[0], pt[1], pt[2]);
 		}
 	}
 	glEnd();
@@ -744,24 +1278,32 @@ void VolViewer::drawBoundaryHalfFaces(TMeshLib::CVTMesh * mesh)
 
 void VolViewer::drawBoundaryHalfFaces(HMeshLib::CVHMesh * mesh)
 {
-	std::vector<HMeshLib::CHViewerHalfFace *> halffaceList = mesh->m_pHFaces_Below;
+	std::vector<HMeshLib::CHViewerHalfFace *> & halffaceList = mesh->belowBoundaryHalfFaces();
 	glBegin(GL_TRIANGLES);
 	for (std::vector<HMeshLib::CHViewerHalfFace*>::iterator iter = halffaceList.begin(); iter != halffaceList.end(); iter++)
 	{
 		HMeshLib::CHViewerHalfFace * pHF = *iter;
-		HMeshLib::CHViewerHalfFace * pHD = mesh->HalfFaceDual(pHF);
-		if (pHD == NULL)
+		HMeshLib::CHViewerVertex * corners[4];
+		int k = 0;
+		for (HMeshLib::CVHMesh::HalfFaceVertexIterator fvIter(mesh, pHF); !fvIter.end() && k < 4; ++fvIter)
 		{
-			glColor3f(1.0, 0.0, 0.0);
-			for (HMeshLib::CVHMesh::HalfFaceVertexIterator fvIter(mesh, pHF); !fvIter.end(); ++fvIter)
-			{
-				HMeshLib::CHViewerVertex * v = *fvIter;
-				CPoint pt = v->position();
-				CPoint n = pHF->normal();
-				CPoint2 uv = v->uv();
-				glNormal3d(n[0], n[1], n[2]);
-				glVertex3d(pt[0], pt[1], pt[2]);
-			}
+			corners[k++] = *fvIter;
+		}
+		if (k < 4)
+		{
+			continue;
+		}
+
+		// the quad as two triangles, GL_TRIANGLES would pair its fourth corner with the next face
+		static const int quadTriangles[6] = { 0, 1, 2, 0, 2, 3 };
+		frameStats.addTriangles(2);
+		glColor3f(1.0, 0.0, 0.0);
+		CPoint n = mesh->_halfface_normal(pHF);
+		for (int i = 0; i < 6; i++)
+		{
+			CPoint pt = corners[quadTriangles[i]]->position();
+			glNormal3d(n[0], n[1], n[2]);
+			glVertex3d(pt[0], pt[1], pt[2]);
 		}
 	}
 	glEnd();
@@ -794,6 +1336,22 @@ void VolViewer::mousePressEvent(QMouseEvent * mouseEvent)
 	}
 }
 
+// keep the vertex whose direction from the near point is closest to the ray
+template<typename M, typename V>
+static void nearestToRay(M * mesh, V * pV, CPoint & nearPt, CPoint & ray, double & minAngle, V *& minVertex, M *& minMesh)
+{
+	CPoint vertVecFromStart = pV->position() - nearPt;
+
+	double dotProduct = vertVecFromStart * ray;
+	double angle = dotProduct / (vertVecFromStart.norm() * ray.norm());
+	if (abs(acos(angle)) < minAngle)
+	{
+		minAngle = abs(acos(angle));
+		minVertex = pV;
+		minMesh = mesh;
+	}
+}
+
 void VolViewer::selectBoundaryCutVertices(QPoint newPos)
 {
 
@@ -807,31 +1365,23 @@ void VolViewer::selectBoundaryCutVertices(QPoint newPos)
 	TMeshLib::CVTMesh * minTMesh = nullptr;
 	HMeshLib::CVHMesh * minHMesh = nullptr;
 
+	// only the boundary vertices and the vertices on the cut faces are candidates
 	for (size_t t = 0; t < tmeshlist.size(); t++)
 	{
 		TMeshLib::CVTMesh * tmesh = tmeshlist[t];
 
-		for (TMeshLib::CVTMesh::MeshVertexIterator vIter(tmesh); !vIter.end(); vIter++)
+		std::vector<TMeshLib::CViewerVertex*> & boundaryVertices = tmesh->boundaryVertices();
+		for (std::vector<TMeshLib::CViewerVertex*>::iterator vIter = boundaryVertices.begin(); vIter != boundaryVertices.end(); vIter++)
 		{
-			TMeshLib::CViewerVertex * pV = *vIter;
-
-			if (!pV->boundary() && !pV->cut())
-			{
-				continue;
-			}
-
-			CPoint pT = pV->position();
-			CPoint vertVecFromStart = pT - newNear;
+			nearestToRay(tmesh, *vIter, newNear, newRay, minAngle, minVertex, minTMesh);
+		}
 
-			double dotProduct = vertVecFromStart * newRay;
-			double angle = dotProduct / (vertVecFromStart.norm() * newRay.norm());
-			// std::cout << angle << std::endl;
-			// find the minimum
-			if (abs(acos(angle)) - 0.0 < minAngle)
+		std::vector<TMeshLib::CViewerFace*> & cutFaces = tmesh->m_cutFaces;
+		for (std::vector<TMeshLib::CViewerFace*>::iterator fIter = cutFaces.begin(); fIter != cutFaces.end(); fIter++)
+		{
+			for (TMeshLib::CVTMesh::FaceVertexIterator fvIter(tmesh, *fIter); !fvIter.end(); fvIter++)
 			{
-				minAngle = abs(acos(angle));
-				minVertex = pV;
-				minTMesh = tmesh;
+				nearestToRay(tmesh, *fvIter, newNear, newRay, minAngle, minVertex, minTMesh);
 			}
 		}
 	}
@@ -839,26 +1389,19 @@ void VolViewer::selectBoundaryCutVertices(QPoint newPos)
 	for (size_t h = 0; h < hmeshlist.size(); h++)
 	{
 		HMeshLib::CVHMesh * hmesh = hmeshlist[h];
-		for (HMeshLib::CVHMesh::MeshVertexIterator vIter(hmesh); !vIter.end(); vIter++)
-		{
-			HMeshLib::CHViewerVertex * pV = *vIter;
-			if (!pV->boundary() && !pV->cut())
-			{
-				continue;
-			}
 
-			CPoint pT = pV->position();
-			CPoint vertVecFromStart = pT - newNear;
+		std::vector<HMeshLib::CHViewerVertex*> & boundaryVertices = hmesh->boundaryVertices();
+		for (std::vector<HMeshLib::CHViewerVertex*>::iterator vIter = boundaryVertices.begin(); vIter != boundaryVertices.end(); vIter++)
+		{
+			nearestToRay(hmesh, *vIter, newNear, newRay, minHAngle, minHVertex, minHMesh);
+		}
 
-			double dotProduct = vertVecFromStart * newRay;
-			double angle = dotProduct / (vertVecFromStart.norm() * newRay.norm());
-			// std::cout << angle << std::endl;
-			// find the minimum
-			if (abs(acos(angle)) - 0.0 < minHAngle)
+		std::vector<HMeshLib::CHViewerFace*> & cutFaces = hmesh->m_cutFaces;
+		for (std::vector<HMeshLib::CHViewerFace*>::iterator fIter = cutFaces.begin(); fIter != cutFaces.end(); fIter++)
+		{
+			for (HMeshLib::CVHMesh::FaceVertexIterator fvIter(hmesh, *fIter); !fvIter.end(); fvIter++)
 			{
-				minHAngle = abs(acos(angle));
-				minHVertex = pV;
-				minHMesh = hmesh;
+				nearestToRay(hmesh, *fvIter, newNear, newRay, minHAngle, minHVertex, minHMesh);
 			}
 		}
 	}
@@ -879,6 +1422,7 @@ void VolViewer::selectBoundaryCutVertices(QPoint newPos)
 			minVertex->selected() = true;
 			minTMesh->selectedVertices().push_back(minVertex);
 		}
+		minTMesh->_touchSelection();
 	}
 	else
 	{
@@ -896,9 +1440,10 @@ void VolViewer::selectBoundaryCutVertices(QPoint newPos)
 			minHVertex->selected() = true;
 			minHMesh->selectedVertices().push_back(minHVertex);
 		}
+		minHMesh->_touchSelection();
 
 	}
-	updateGL();
+	update();
 }
 
 void VolViewer::selectAllCutFaces(QPoint newPos)
@@ -913,7 +1458,7 @@ void VolViewer::selectAllCutFaces(QPoint newPos)
 	for (size_t t = 0; t < tmeshlist.size(); t++)
 	{
 		TMeshLib::CVTMesh * mesh = tmeshlist[t];
-		std::vector<TMeshLib::CViewerFace*> cutFacesList = mesh->_getCutFaces();
+		std::vector<TMeshLib::CViewerFace*> & cutFacesList = mesh->_getCutFaces();
 
 		for (std::vector<TMeshLib::CViewerFace*>::iterator cFIter = cutFacesList.begin(); cFIter != cutFacesList.end(); cFIter++)
 		{
@@ -963,9 +1508,10 @@ void VolViewer::selectAllCutFaces(QPoint newPos)
 		}
 	}
 
+	minMesh->_touchSelection();
 	minMesh->_updateSelectedFaces();
 
-	updateGL();
+	update();
 }
 
 CPoint VolViewer::getRayVector(QPoint point, CPoint & nearPt, CPoint & farPt)
@@ -973,16 +1519,8 @@ CPoint VolViewer::getRayVector(QPoint point, CPoint & nearPt, CPoint & farPt)
 	GLdouble mousePosX = point.x();
 	GLdouble mousePosY = height() - point.y();
 
-	GLdouble objNearX, objNearY, objNearZ;
-	GLdouble objFarX, objFarY, objFarZ;
-
-	getGLMatrix();
-
-	gluUnProject(mousePosX, mousePosY, 0.0, matModelView, matProjection, viewPort, &objNearX, &objNearY, &objNearZ);
-	gluUnProject(mousePosX, mousePosY, 1.0, matModelView, matProjection, viewPort, &objFarX, &objFarY, &objFarZ);
-
-	nearPt[0] = objNearX; nearPt[1] = objNearY; nearPt[2] = objNearZ;
-	farPt[0] = objFarX; farPt[1] = objFarY; farPt[2] = objFarZ;
+	nearPt = camera.unproject(mousePosX, mousePosY, 0.0);
+	farPt = camera.unproject(mousePosX, mousePosY, 1.0);
 
 	CPoint rayVector = farPt - nearPt;
 
@@ -991,46 +1529,69 @@ CPoint VolViewer::getRayVector(QPoint point, CPoint & nearPt, CPoint & farPt)
 
 void VolViewer::mouseMoveEvent(QMouseEvent * mouseEvent)
 {
-	QPoint newMousePos = mouseEvent->pos();
-	// enable OpenGL Context
-	makeCurrent();
-	if (isLatestMouseOK)
+	// only the target of the motion is kept, applyPendingInput moves the camera once per frame
+	if (isLatestMouseOK && (mouseButton == Qt::LeftButton || mouseButton == Qt::RightButton))
+	{
+		isInteracting = true;
+		pendingMousePos = mouseEvent->pos();
+		isMousePending = true;
+		update();
+	}
+}
+
+void VolViewer::applyPendingInput()
+{
+	if (isMousePending)
 	{
 		switch (mouseButton)
 		{
 		case Qt::LeftButton:
 			// rotate the view
-			rotationView(newMousePos);
+			rotationView(pendingMousePos);
 			break;
 		case Qt::RightButton:
 			// translate the view
-			translateView(newMousePos);
+			translateView(pendingMousePos);
 			break;
 		default:
 			break;
 		}
+
+		latestMousePos = pendingMousePos;
+		isLatestMouseOK = arcball(latestMousePos, latestMouse3DPos);
+		isMousePending = false;
 	}
 
-	latestMousePos = newMousePos;
-	//std::cout << "starting debugging ..." << std::endl;
-	isLatestMouseOK = arcball(latestMousePos, latestMouse3DPos);
-	// update OpenGL, trigger re-draw
-	updateGL();
+	if (pendingWheel != 0.0)
+	{
+		translate(CPoint(0.0, 0.0, pendingWheel));
+		pendingWheel = 0.0;
+	}
 }
 
 void VolViewer::mouseReleaseEvent(QMouseEvent * /*mouseEvent*/)
 {
+	// the last motion belongs to the button being released
+	applyPendingInput();
+
 	mouseButton = Qt::NoButton;
 	isLatestMouseOK = false;
 	std::cout << "Mouse Release..." << std::endl;
+
+	// back to the full surface
+	if (isInteracting)
+	{
+		isInteracting = false;
+		update();
+	}
 }
 
 void VolViewer::wheelEvent(QWheelEvent * mouseEvent)
 {
 	// scroll the wheel to scale the view port
 	double moveAmount = -(double)mouseEvent->delta() / (120.0*2.0);
-	translate(CPoint(0.0, 0.0, moveAmount));
-	updateGL();
+	pendingWheel += moveAmount;
+	update();
 	mouseEvent->accept();
 }
 
@@ -1102,35 +1663,14 @@ void VolViewer::rotationView(QPoint newPos)
 
 void VolViewer::rotate(CPoint axis, double angle)
 {
-
-	getGLMatrix();
-
-	GLdouble translation0 = matModelView[0] * center[0] + matModelView[4] * center[1] + matModelView[8] * center[2] + matModelView[12];
-	GLdouble translation1 = matModelView[1] * center[0] + matModelView[5] * center[1] + matModelView[9] * center[2] + matModelView[13];
-	GLdouble translation2 = matModelView[2] * center[0] + matModelView[6] * center[1] + matModelView[10] * center[2] + matModelView[14];
-	CPoint transVector = CPoint(translation0, translation1, translation2);
-
-	// modify the modelview matrix
-	// first make it at the center of the screen
-	makeCurrent();
-	glLoadIdentity();
-	glTranslated(transVector[0], transVector[1], transVector[2]);
-	// then rotate it
-	glRotated(angle, axis[0], axis[1], axis[2]);
-	// move back to the center
-	glTranslated(-transVector[0], -transVector[1], -transVector[2]);
-	// update the matrix
-	glMultMatrixd(matModelView);
-	glGetDoublev(GL_MODELVIEW_MATRIX, matModelView);
+	// about the center of the scene, wherever it is on the screen
+	camera.rotate(axis, angle);
 }
 
 // translate the view
 void VolViewer::translateView(QPoint newPos)
 {
-	getGLMatrix();
-
-	double zVal = -(matModelView[2] * center[0] + matModelView[6] * center[1] + matModelView[10] * center[2] + matModelView[14]) /
-		(matModelView[3] * center[0] + matModelView[7] * center[1] + matModelView[11] * center[2] + matModelView[15]);
+	double zVal = camera.pivotDepth();
 	double screenAspect = width() / height();
 	double top = tan(fovy() / 2.0f * PI / 180.0f) * zNear;
 	double right = screenAspect * top;
@@ -1145,18 +1685,14 @@ void VolViewer::translateView(QPoint newPos)
 
 void VolViewer::translate(CPoint transVector)
 {
-
-	getGLMatrix();
-
-	makeCurrent();
-	glLoadIdentity();
-	glTranslated(-transVector[0], -transVector[1], -transVector[2]);
-	glMultMatrixd(matModelView);
-	glGetDoublev(GL_MODELVIEW_MATRIX, matModelView);
+	camera.translate(transVector);
 }
 
 void VolViewer::loadFile(const char * meshfile, std::string fileExt)
 {
+	QElapsedTimer timer;
+	timer.start();
+	size_t allocations = AllocCounter::count();
 
 	VOLUME_TYPE currentVolType;
 
@@ -1221,24 +1757,39 @@ void VolViewer::loadFile(const char * meshfile, std::string fileExt)
 	CPlane p(CPoint(0.0, 0.0, 1), z_mid);
 	cutDistance = z_mid;
 
+	frameStats.setOperation("load", timer.nsecsElapsed() / 1e6, AllocCounter::count() - allocations);
+
 	if (currentVolType == VOLUME_TYPE::TET)
 	{
 		TMeshLib::CVTMesh * tmesh = tmeshlist[tmeshlist.size() - 1];
-		tmesh->_halfface_normal();
+		tmesh->_index();
+		timer.restart();
+		allocations = AllocCounter::count();
 		tmesh->_cut(p);
+		frameStats.setOperation("cut", timer.nsecsElapsed() / 1e6, AllocCounter::count() - allocations);
 		tmesh->_labelBoundary();
+		cutWorker->requestProxy(tmeshlist, hmeshlist);
 	}
 	else if (currentVolType == VOLUME_TYPE::HEX)
 	{
 		HMeshLib::CVHMesh * hmesh = hmeshlist[hmeshlist.size() - 1];
-		hmesh->_halfface_normal();
+		hmesh->_index();
+		timer.restart();
+		allocations = AllocCounter::count();
 		hmesh->_cut(p);
+		frameStats.setOperation("cut", timer.nsecsElapsed() / 1e6, AllocCounter::count() - allocations);
 		hmesh->_labelBoundary();
+		cutWorker->requestProxy(tmeshlist, hmeshlist);
 	}
 
 	isMeshLoaded = true;
 
-	updateGL();
+	if (groupPanel != NULL)
+	{
+		groupPanel->setGroups(meshGroups(), hiddenGroups);
+	}
+
+	update();
 }
 
 void VolViewer::loadFromMainWin(std::string outFilename, std::string outExt)
@@ -1266,18 +1817,43 @@ void VolViewer::loadFromMainWin(std::string outFilename, std::string outExt)
 
 void VolViewer::newScene()
 {
+	cutWorker->waitForIdle();
+
+	// the viewer owns the meshes, a batch run loads hundreds of them
+	for (size_t t = 0; t < tmeshlist.size(); t++)
+	{
+		delete tmeshlist[t];
+	}
+	for (size_t h = 0; h < hmeshlist.size(); h++)
+	{
+		delete hmeshlist[h];
+	}
 	tmeshlist.clear();
 	hmeshlist.clear();
 
+	makeCurrent();
+	clearBuffers();
+
+	// the groups of the next scene start visible, the panel lists none until it is loaded
+	hiddenGroups.clear();
+	if (groupPanel != NULL)
+	{
+		groupPanel->setGroups(meshGroups(), hiddenGroups);
+	}
+
 	windowTitle = "VolumeViewerQt";
 
+	// there is no main window when rendering in batch mode
 	foreach(QWidget *widget, qApp->topLevelWidgets())
 	{
 		MainWindow * mainWin = qobject_cast<MainWindow*>(widget);
-		mainWin->setWindowTitle(windowTitle);
+		if (mainWin != NULL)
+		{
+			mainWin->setWindowTitle(windowTitle);
+		}
 	}
 
-	updateGL();
+	update();
 }
 
 void VolViewer::openMesh()
@@ -1402,76 +1978,244 @@ void VolViewer::saveMesh()
 		}
 	}
 
-	for (size_t h = 0; h < hmeshlist.size(); h++)
+	for (size_t h = 0; h < hmeshlist.size(); h++)
+	{
+		QString saveFilename = QFileDialog::getSaveFileName(this,
+			tr("Save Hex Mesh File"),
+			tr("../models/"),
+			tr("Hex Mesh Files (*.hm);;"
+			"All Files (*.*)"));
+		QFileInfo * saveFileInfo = new QFileInfo(saveFilename);
+		std::string saveFileExt = saveFileInfo->suffix().toStdString();
+		if (!saveFilename.isEmpty())
+		{
+			QByteArray byteArray = saveFilename.toUtf8();
+			const char * _saveFilename = byteArray.constData();
+			saveFile(hmeshlist[h], _saveFilename, saveFileExt);
+		}
+	}
+}
+
+void VolViewer::saveFile(TMeshLib::CVTMesh * mesh, const char * meshfile, std::string sExt)
+{
+	if (sExt == "tet")
+	{
+		mesh->_write(meshfile);
+	}
+	else if (sExt == "t")
+	{
+		mesh->_write_t(meshfile);
+	}
+}
+
+void VolViewer::saveFile(HMeshLib::CVHMesh * mesh, const char * meshfile, std::string sExt)
+{
+	if (sExt == "hm")
+	{
+		mesh->_write_hm(meshfile);
+	}
+}
+
+void VolViewer::exportVisibleMesh()
+{
+	if (tmeshlist.size() == 0 && hmeshlist.size() == 0) return;
+
+	ExportDialog * exportDiag = new ExportDialog(this);
+	int r = exportDiag->exec();
+
+	if (r == 0)
+	{
+		return;
+	}
+
+	QString exportFilename = QFileDialog::getSaveFileName(this,
+		tr("Save Mesh File"),
+		tr("../models/"),
+		tr("Triangle Mesh Files (*.m);;"
+		"Triangle, Quad Mesh (*.obj);;"
+		"Quad Mesh (*.qm);;"
+		"Quad Mesh (*.ply);;"));
+
+	QFileInfo * exportFileInfo = new QFileInfo(exportFilename);
+	std::string exportFileExt = exportFileInfo->suffix().toStdString();
+	if (!exportFilename.isEmpty())
+	{
+		QByteArray byteArray = exportFilename.toUtf8();
+		const char * _exportFilename = byteArray.constData();
+		exportVisibleSurface(_exportFilename, exportFileExt, r);
+	}
+}
+
+void VolViewer::showProfile()
+{
+	if (profilePanel == NULL)
+	{
+		profilePanel = new ProfilePanel(this);
+		connect(profilePanel, SIGNAL(computeRequested(int, int)), this, SLOT(computeProfiles(int, int)));
+	}
+
+	profilePanel->show();
+	profilePanel->raise();
+	profilePanel->compute();
+}
+
+void VolViewer::showGroups()
+{
+	if (groupPanel == NULL)
+	{
+		groupPanel = new GroupPanel(this);
+		connect(groupPanel, SIGNAL(groupToggled(int, bool)), this, SLOT(setGroupVisible(int, bool)));
+	}
+
+	groupPanel->setGroups(meshGroups(), hiddenGroups);
+	groupPanel->show();
+	groupPanel->raise();
+}
+
+void VolViewer::showShrink()
+{
+	if (shrinkPanel == NULL)
+	{
+		shrinkPanel = new ShrinkPanel(this);
+		connect(shrinkPanel, SIGNAL(shrinkChanged(double)), this, SLOT(setShrinkFactor(double)));
+	}
+
+	shrinkPanel->setShrink(shrinkFactor);
+	shrinkPanel->show();
+	shrinkPanel->raise();
+}
+
+void VolViewer::setShrinkFactor(double factor)
+{
+	// a uniform of the surface shader, nothing is rebuilt or uploaded
+	shrinkFactor = factor;
+	update();
+}
+
+void VolViewer::setGroupVisible(int group, bool visible)
+{
+	// the buffers skip the subtrees of the hidden groups, nothing is rebuilt
+	if (visible)
+	{
+		hiddenGroups.erase(group);
+	}
+	else
+	{
+		hiddenGroups.insert(group);
+	}
+	update();
+}
+
+std::set<int> VolViewer::meshGroups()
+{
+	std::set<int> groups;
+	for (size_t i = 0; i < tmeshlist.size(); i++)
 	{
-		QString saveFilename = QFileDialog::getSaveFileName(this,
-			tr("Save Hex Mesh File"),
-			tr("../models/"),
-			tr("Hex Mesh Files (*.hm);;"
-			"All Files (*.*)"));
-		QFileInfo * saveFileInfo = new QFileInfo(saveFilename);
-		std::string saveFileExt = saveFileInfo->suffix().toStdString();
-		if (!saveFilename.isEmpty())
+		if (!tmeshlist[i]->isFiber())
 		{
-			QByteArray byteArray = saveFilename.toUtf8();
-			const char * _saveFilename = byteArray.constData();
-			saveFile(hmeshlist[h], _saveFilename, saveFileExt);
+			groups.insert(tmeshlist[i]->m_arrays.m_groups.begin(), tmeshlist[i]->m_arrays.m_groups.end());
 		}
 	}
+	if (!hmeshlist.empty())
+	{
+		groups.insert(0);
+	}
+	return groups;
 }
 
-void VolViewer::saveFile(TMeshLib::CVTMesh * mesh, const char * meshfile, std::string sExt)
+void VolViewer::computeProfiles(int axis, int samples)
 {
-	if (sExt == "tet")
+	CPoint n(0.0, 0.0, 0.0);
+	if (axis == ProfilePanel::AXIS_CUT)
 	{
-		mesh->_write(meshfile);
+		n = cutPlane.normal();
 	}
-	else if (sExt == "t")
+	else
 	{
-		mesh->_write_t(meshfile);
+		n[axis] = 1.0;
 	}
-}
+	n = n / n.norm();
 
-void VolViewer::saveFile(HMeshLib::CVHMesh * mesh, const char * meshfile, std::string sExt)
-{
-	if (sExt == "hm")
+	// the profiles share their offsets, so they can be compared and exported side by side
+	double offsetMin = 1e+10;
+	double offsetMax = -1e+10;
+	for (size_t i = 0; i < tmeshlist.size(); i++)
 	{
-		mesh->_write_hm(meshfile);
+		CProfileSweep::range(tmeshlist[i]->m_arrays, n, offsetMin, offsetMax);
+	}
+	for (size_t i = 0; i < hmeshlist.size(); i++)
+	{
+		CProfileSweep::range(hmeshlist[i]->m_arrays, n, offsetMin, offsetMax);
+	}
+
+	std::vector<CProfile> & profiles = profilePanel->profiles();
+	profiles.clear();
+	if (offsetMin <= offsetMax)
+	{
+		profiles.resize(tmeshlist.size() + hmeshlist.size());
+		for (size_t i = 0; i < tmeshlist.size(); i++)
+		{
+			tmeshlist[i]->_profile(n, offsetMin, offsetMax, samples, profiles[i]);
+		}
+		for (size_t i = 0; i < hmeshlist.size(); i++)
+		{
+			hmeshlist[i]->_profile(n, offsetMin, offsetMax, samples, profiles[tmeshlist.size() + i]);
+		}
 	}
+
+	profilePanel->updatePlot();
 }
 
-void VolViewer::exportVisibleMesh()
+void VolViewer::compareFrameTimes()
 {
 	if (tmeshlist.size() == 0 && hmeshlist.size() == 0) return;
 
-	ExportDialog * exportDiag = new ExportDialog(this);
-	int r = exportDiag->exec();
+	const int frames = 50;
+	double msPerFrame[2];
+	bool wasRetainedMode = isRetainedMode;
 
-	if (r == 0)
+	makeCurrent();
+	for (int mode = 0; mode < 2; mode++)
 	{
-		return;
-	}
+		isRetainedMode = (mode == 1);
 
-	QString exportFilename = QFileDialog::getSaveFileName(this,
-		tr("Save Mesh File"),
-		tr("../models/"),
-		tr("Triangle Mesh Files (*.m);;"
-		"Triangle, Quad Mesh (*.obj);;"
-		"Quad Mesh (*.qm);;"
-		"Quad Mesh (*.ply);;"));
+		// the first frame builds the buffers and is not timed, the swap is left out so vsync does not cap the result
+		paintGL();
+		glFinish();
 
-	QFileInfo * exportFileInfo = new QFileInfo(exportFilename);
-	std::string exportFileExt = exportFileInfo->suffix().toStdString();
-	if (!exportFilename.isEmpty())
-	{
-		QByteArray byteArray = exportFilename.toUtf8();
-		const char * _exportFilename = byteArray.constData();
-		exportVisibleSurface(_exportFilename, exportFileExt, r);
+		QElapsedTimer timer;
+		timer.start();
+		for (int i = 0; i < frames; i++)
+		{
+			paintGL();
+		}
+		glFinish();
+		msPerFrame[mode] = timer.nsecsElapsed() / 1e6 / frames;
 	}
+	isRetainedMode = wasRetainedMode;
+
+	std::cout << "immediate mode: " << msPerFrame[0] << " ms per frame, buffered: " << msPerFrame[1] << " ms per frame" << std::endl;
+	QMessageBox::information(this, tr("Frame Time"),
+		tr("Immediate mode: %1 ms per frame\nBuffered: %2 ms per frame").arg(msPerFrame[0], 0, 'f', 2).arg(msPerFrame[1], 0, 'f', 2));
+
+	update();
 }
 
 void VolViewer::exportVisibleSurface(const char * surface_file, std::string sExt, int exportOpt)
 {
+	CPlane plane;
+	if (exportOpt == 5 && !sectionPlane(plane))
+	{
+		QMessageBox::information(this, tr("Export"), tr("The exact cross section is only computed for plane cuts."));
+		return;
+	}
+
+	// export the surface of the latest requested cut
+	cutWorker->waitForIdle();
+
+	QElapsedTimer timer;
+	timer.start();
+	size_t allocations = AllocCounter::count();
 
 	if (sExt == "m")
 	{
@@ -1490,6 +2234,10 @@ void VolViewer::exportVisibleSurface(const char * surface_file, std::string sExt
 				break;
 			case 4:
 				tmeshlist[0]->_write_cut_surface_m(surface_file);
+				break;
+			case 5:
+				tmeshlist[0]->_write_section_m(surface_file, plane);
+				break;
 			default:
 				break;
 			}
@@ -1510,6 +2258,10 @@ void VolViewer::exportVisibleSurface(const char * surface_file, std::string sExt
 			case 3:
 				hmeshlist[0]->_write_above_surface_qm(surface_file);
 				break;
+			case 5:
+				// the polygons of the section are split into triangles, written with the same Vertex and Face lines
+				hmeshlist[0]->_write_section_m(surface_file, plane);
+				break;
 			default:
 				break;
 			}
@@ -1534,6 +2286,9 @@ void VolViewer::exportVisibleSurface(const char * surface_file, std::string sExt
 			case 4:
 				tmeshlist[0]->_write_cut_surface_obj(surface_file);
 				break;
+			case 5:
+				tmeshlist[0]->_write_section_obj(surface_file, plane);
+				break;
 			default:
 				break;
 			}
@@ -1551,11 +2306,19 @@ void VolViewer::exportVisibleSurface(const char * surface_file, std::string sExt
 			case 3:
 				hmeshlist[0]->_write_above_surface_obj(surface_file);
 				break;
+			case 5:
+				hmeshlist[0]->_write_section_obj(surface_file, plane);
+				break;
 			default:
 				break;
 			}
 		}
 	}
+
+	frameStats.setOperation("export", timer.nsecsElapsed() / 1e6, AllocCounter::count() - allocations);
+
+	// waiting dropped the proxies under construction
+	cutWorker->requestProxy(tmeshlist, hmeshlist);
 };
 
 void VolViewer::enterSelectionMode()
@@ -1592,6 +2355,7 @@ void VolViewer::quitSelectionCutFaceMode()
 
 void VolViewer::xCut()
 {
+	cutType = CUT_TYPE::PLANE;
 	cutDistance = x_mid;
 	cutPlane = CPlane(CPoint(1.0, 0, 0), cutDistance);
 	CPoint pNormal = cutPlane.normal();
@@ -1599,22 +2363,12 @@ void VolViewer::xCut()
 	std::cout << "CutPlane " << "Normal=(" << pNormal[0] << " " << pNormal[1] << " " << pNormal[2] << ") ";
 	std::cout << "d=" << distance << std::endl;
 
-	for (std::vector<TMeshLib::CVTMesh*>::iterator tIter = tmeshlist.begin(); tIter != tmeshlist.end(); tIter++)
-	{
-		TMeshLib::CVTMesh * tmesh = *tIter;
-		tmesh->_cut(cutPlane);
-	}
-
-	for (std::vector<HMeshLib::CVHMesh*>::iterator hIter = hmeshlist.begin(); hIter != hmeshlist.end(); hIter++)
-	{
-		HMeshLib::CVHMesh * hmesh = *hIter;
-		hmesh->_cut(cutPlane);
-	}
-	updateGL();
+	cutMeshes();
 }
 
 void VolViewer::yCut()
 {
+	cutType = CUT_TYPE::PLANE;
 	cutDistance = y_mid;
 	cutPlane = CPlane(CPoint(0, 1.0, 0), cutDistance);
 	CPoint pNormal = cutPlane.normal();
@@ -1622,23 +2376,12 @@ void VolViewer::yCut()
 	std::cout << "CutPlane " << "Normal=(" << pNormal[0] << " " << pNormal[1] << " " << pNormal[2] << ") ";
 	std::cout << "d=" << distance << std::endl;
 
-	for (std::vector<TMeshLib::CVTMesh*>::iterator tIter = tmeshlist.begin(); tIter != tmeshlist.end(); tIter++)
-	{
-		TMeshLib::CVTMesh * tmesh = *tIter;
-		tmesh->_cut(cutPlane);
-	}
-
-	for (std::vector<HMeshLib::CVHMesh*>::iterator hIter = hmeshlist.begin(); hIter != hmeshlist.end(); hIter++)
-	{
-		HMeshLib::CVHMesh * hmesh = *hIter;
-		hmesh->_cut(cutPlane);
-	}
-
-	updateGL();
+	cutMeshes();
 }
 
 void VolViewer::zCut()
 {
+	cutType = CUT_TYPE::PLANE;
 	cutDistance = z_mid;
 	cutPlane = CPlane(CPoint(0, 0, 1.0), cutDistance);
 	CPoint pNormal = cutPlane.normal();
@@ -1646,23 +2389,18 @@ void VolViewer::zCut()
 	std::cout << "CutPlane " << "Normal=(" << pNormal[0] << " " << pNormal[1] << " " << pNormal[2] << ") ";
 	std::cout << "d=" << distance << std::endl;
 
-	for (std::vector<TMeshLib::CVTMesh*>::iterator tIter = tmeshlist.begin(); tIter != tmeshlist.end(); tIter++)
-	{
-		TMeshLib::CVTMesh * tmesh = *tIter;
-		tmesh->_cut(cutPlane);
-	}
-
-	for (std::vector<HMeshLib::CVHMesh*>::iterator hIter = hmeshlist.begin(); hIter != hmeshlist.end(); hIter++)
-	{
-		HMeshLib::CVHMesh * hmesh = *hIter;
-		hmesh->_cut(cutPlane);
-	}
-
-	updateGL();
+	cutMeshes();
 }
 
 void VolViewer::plusMove()
 {
+	if (cutType == CUT_TYPE::SPHERE || cutType == CUT_TYPE::CYLINDER || cutType == CUT_TYPE::POINT)
+	{
+		cutRadius += radius / 30.0;
+		cutMeshes();
+		return;
+	}
+
 	CPoint pNormal = cutPlane.normal();
 	if (pNormal * CPoint(1, 0, 0) != 0.0)
 	{
@@ -1683,23 +2421,18 @@ void VolViewer::plusMove()
 	std::cout << "CutPlane " << "Normal=(" << pNormal[0] << " " << pNormal[1] << " " << pNormal[2] << ") ";
 	std::cout << "d=" << distance << std::endl;
 
-	for (std::vector<TMeshLib::CVTMesh*>::iterator tIter = tmeshlist.begin(); tIter != tmeshlist.end(); tIter++)
-	{
-		TMeshLib::CVTMesh * tmesh = *tIter;
-		tmesh->_cut(cutPlane);
-	}
-
-	for (std::vector<HMeshLib::CVHMesh*>::iterator hIter = hmeshlist.begin(); hIter != hmeshlist.end(); hIter++)
-	{
-		HMeshLib::CVHMesh * hmesh = *hIter;
-		hmesh->_cut(cutPlane);
-	}
-
-	updateGL();
+	cutMeshes();
 }
 
 void VolViewer::minusMove()
 {
+	if (cutType == CUT_TYPE::SPHERE || cutType == CUT_TYPE::CYLINDER || cutType == CUT_TYPE::POINT)
+	{
+		cutRadius = std::max(0.0, cutRadius - radius / 30.0);
+		cutMeshes();
+		return;
+	}
+
 	CPoint pNormal = cutPlane.normal();
 	if (pNormal * CPoint(1, 0, 0) != 0.0)
 	{
@@ -1720,20 +2453,236 @@ void VolViewer::minusMove()
 	std::cout << "CutPlane " << "Normal=(" << pNormal[0] << " " << pNormal[1] << " " << pNormal[2] << ") ";
 	std::cout << "d=" << distance << std::endl;
 
-	for (std::vector<TMeshLib::CVTMesh*>::iterator tIter = tmeshlist.begin(); tIter != tmeshlist.end(); tIter++)
+	cutMeshes();
+};
+
+void VolViewer::cutMeshes()
+{
+	// the surface of every type lives on the stack, the worker keeps its own copy
+	switch (cutType)
+	{
+	case CUT_TYPE::PLANE:
+	{
+		CImplicitPlane plane(cutPlane);
+		requestCut(plane);
+		break;
+	}
+	case CUT_TYPE::SPHERE:
+	case CUT_TYPE::POINT:
+	{
+		CImplicitSphere sphere(cutCenter, cutRadius);
+		requestCut(sphere);
+		break;
+	}
+	case CUT_TYPE::CYLINDER:
+	{
+		CImplicitCylinder cylinder(cutCenter, cutPlane.normal(), cutRadius);
+		requestCut(cylinder);
+		break;
+	}
+	case CUT_TYPE::SLAB:
 	{
-		TMeshLib::CVTMesh * tmesh = *tIter;
-		tmesh->_cut(cutPlane);
+		// the slab keeps a tenth of the radius of the scene, cutRadius, on both sides of the cut plane
+		CImplicitSlab slab(cutPlane.normal(), cutDistance - cutRadius, cutDistance + cutRadius);
+		requestCut(slab);
+		break;
+	}
+	default:
+		break;
 	}
+}
+
+void VolViewer::requestCut(CImplicitSurface & surface)
+{
+	surface.inverted() = isCutInverted;
 
-	for (std::vector<HMeshLib::CVHMesh*>::iterator hIter = hmeshlist.begin(); hIter != hmeshlist.end(); hIter++)
+	// the cut is computed in the background, the view is repainted once it is ready
+	cutWorker->requestCut(surface, tmeshlist, hmeshlist);
+}
+
+bool VolViewer::sectionPlane(CPlane & plane)
+{
+	// only a plane cut has a section, it is oriented the way requestCut orients the cut
+	if (cutType != CUT_TYPE::PLANE)
 	{
-		HMeshLib::CVHMesh * hmesh = *hIter;
-		hmesh->_cut(cutPlane);
+		return false;
 	}
 
-	updateGL();
-};
+	CImplicitPlane surface(cutPlane);
+	surface.inverted() = isCutInverted;
+	return surface.isPlane(plane);
+}
+
+void VolViewer::setCutPlane(CPoint normal, double d)
+{
+	cutType = CUT_TYPE::PLANE;
+	cutDistance = d;
+	cutPlane = CPlane(normal / normal.norm(), cutDistance);
+
+	cutMeshes();
+}
+
+bool VolViewer::setViewPreset(std::string preset)
+{
+	// the axis and angles rotating the default view, which looks down the z axis, onto the preset
+	CPoint axis0(0, 1, 0), axis1(1, 0, 0);
+	double angle0 = 0, angle1 = 0;
+
+	if (preset == "front")
+	{
+	}
+	else if (preset == "back")
+	{
+		angle0 = 180;
+	}
+	else if (preset == "left")
+	{
+		angle0 = 90;
+	}
+	else if (preset == "right")
+	{
+		angle0 = -90;
+	}
+	else if (preset == "top")
+	{
+		angle1 = 90;
+	}
+	else if (preset == "bottom")
+	{
+		angle1 = -90;
+	}
+	else if (preset == "iso")
+	{
+		angle0 = -45;
+		angle1 = 35.264;
+	}
+	else
+	{
+		return false;
+	}
+
+	initializeOffscreen();
+	setScene();
+	if (angle0 != 0)
+	{
+		rotate(axis0, angle0);
+	}
+	if (angle1 != 0)
+	{
+		rotate(axis1, angle1);
+	}
+	return true;
+}
+
+QImage VolViewer::renderImage(int width, int height)
+{
+	initializeOffscreen();
+
+	// the image shows the latest requested cut
+	cutWorker->waitForIdle();
+	resize(width, height);
+
+	if (!QGLFramebufferObject::hasOpenGLFramebufferObjects())
+	{
+		fprintf(stderr, "Error in rendering offscreen, framebuffer objects are not supported\n");
+		return QImage();
+	}
+
+	QGLFramebufferObject fbo(width, height, QGLFramebufferObject::Depth);
+	fbo.bind();
+
+	glViewport(0, 0, width, height);
+	camera.setViewport(0, 0, width, height);
+	updateProjectionMatrix();
+
+	paintGL();
+	glFinish();
+
+	fbo.release();
+	return fbo.toImage();
+}
+
+void VolViewer::sphereCut()
+{
+	cutType = CUT_TYPE::SPHERE;
+	cutCenter = center;
+	cutRadius = radius / 2.0;
+
+	cutMeshes();
+}
+
+void VolViewer::cylinderCut()
+{
+	// the axis is the normal of the current cut plane
+	cutType = CUT_TYPE::CYLINDER;
+	cutCenter = center;
+	cutRadius = radius / 2.0;
+
+	cutMeshes();
+}
+
+void VolViewer::slabCut()
+{
+	cutType = CUT_TYPE::SLAB;
+	cutRadius = radius / 10.0;
+
+	cutMeshes();
+}
+
+void VolViewer::pointCut()
+{
+	// the region is centered at the latest selected vertex
+	CPoint point;
+	bool isPointSelected = false;
+
+	for (size_t t = 0; t < tmeshlist.size(); t++)
+	{
+		if (tmeshlist[t]->selectedVertices().size() > 0)
+		{
+			point = tmeshlist[t]->selectedVertices().back()->position();
+			isPointSelected = true;
+		}
+	}
+	for (size_t h = 0; h < hmeshlist.size(); h++)
+	{
+		if (hmeshlist[h]->selectedVertices().size() > 0)
+		{
+			point = hmeshlist[h]->selectedVertices().back()->position();
+			isPointSelected = true;
+		}
+	}
+
+	if (!isPointSelected)
+	{
+		QMessageBox::information(this, tr("Point Cut"), tr("Select a vertex to center the region at first."));
+		return;
+	}
+
+	bool ok;
+	double r = QInputDialog::getDouble(this, tr("Input the radius of the region"), tr("Radius"), radius / 4.0, 0.0, 100.0 * radius, 4, &ok);
+	if (!ok)
+	{
+		return;
+	}
+
+	cutType = CUT_TYPE::POINT;
+	cutCenter = point;
+	cutRadius = r;
+
+	cutMeshes();
+}
+
+void VolViewer::invertCutOn()
+{
+	isCutInverted = true;
+	cutMeshes();
+}
+
+void VolViewer::invertCutOff()
+{
+	isCutInverted = false;
+	cutMeshes();
+}
 
 void VolViewer::cutVolume()
 {
@@ -1811,6 +2760,9 @@ void VolViewer::mergeVolume()
 		return;
 	}
 
+	// the vertices are moved below, no cut may be running on them
+	cutWorker->waitForIdle();
+
 	if (hmeshlist.size() >= 2)
 	{
 		HMeshLib::CVHMesh * hmesh0 = hmeshlist[0];
@@ -1847,6 +2799,8 @@ void VolViewer::mergeVolume()
 
 		hmesh0->selectedVertices().clear();
 		hmesh1->selectedVertices().clear();
+		hmesh0->_touchSelection();
+		hmesh1->_touchSelection();
 	}
 	else if (hmeshlist.size() == 1) // merge the selected vertices in one volume
 	{
@@ -1869,13 +2823,21 @@ void VolViewer::mergeVolume()
 		}
 
 		hmesh->selectedVertices().clear();
+		hmesh->_touchSelection();
 	}
 	else if (tmeshlist.size() >= 2)
 	{
 
 	}
 
-	updateGL();
+	// the moved vertices need to be copied into the arrays again
+	for (size_t h = 0; h < hmeshlist.size(); h++)
+	{
+		hmeshlist[h]->_index();
+	}
+	cutWorker->requestProxy(tmeshlist, hmeshlist);
+
+	update();
 };
 
 void VolViewer::clearSelectedVF()
@@ -1890,6 +2852,7 @@ void VolViewer::clearSelectedVF()
 			pV->selected() = false;
 		}
 		mesh->selectedVertices().clear();
+		mesh->_touchSelection();
 	}
 
 	for (size_t h = 0; h < hmeshlist.size(); h++)
@@ -1902,21 +2865,54 @@ void VolViewer::clearSelectedVF()
 			pV->selected() = false;
 		}
 		hmesh->selectedVertices().clear();
+		hmesh->_touchSelection();
+	}
+
+	update();
+}
+
+void VolViewer::statsOn()
+{
+	isStatsShown = true;
+	update();
+}
+
+void VolViewer::statsOff()
+{
+	isStatsShown = false;
+	update();
+}
+
+void VolViewer::exportFrameStats()
+{
+	if (frameStats.numFrames() == 0)
+	{
+		QMessageBox::information(this, tr("Frame Statistics"), tr("No frame has been drawn yet."));
+		return;
+	}
+
+	QString statsFile = QFileDialog::getSaveFileName(this, tr("Export frame statistics"), tr("../models/"), tr("CSV files (*.csv)"));
+	if (statsFile.isEmpty())
+	{
+		return;
 	}
 
-	updateGL();
+	if (!frameStats.writeCSV(statsFile.toStdString().c_str()))
+	{
+		QMessageBox::warning(this, tr("Frame Statistics"), tr("Cannot write %1").arg(statsFile));
+	}
 }
 
 void VolViewer::lightOn()
 {
 	isLightOn = true;
-	updateGL();
+	update();
 }
 
 void VolViewer::lightOff()
 {
 	isLightOn = false;
-	updateGL();
+	update();
 }
 
 void VolViewer::rotationViewOn()
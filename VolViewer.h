@@ -11,9 +11,23 @@
 #include <QDialog>
 
 #include <string>
+#include <map>
+#include <set>
 
 #include "ExportDialog.h"
 #include "MergeDialog.h"
+#include "CutWorker.h"
+#include "ProfilePanel.h"
+#include "GroupPanel.h"
+#include "ShrinkPanel.h"
+#include "SurfaceBuffer.h"
+#include "PointBuffer.h"
+#include "FiberBuffer.h"
+#include "GlyphBuffer.h"
+#include "ProxyBuffer.h"
+#include "SectionBuffer.h"
+#include "FrameStats.h"
+#include "Camera.h"
 
 #include "OpenGLHeader.h"
 #include "..\MeshLib\core\bmp\RgbImage.h"
@@ -30,10 +44,12 @@
 
 using namespace MeshLib;
 
-enum class DRAW_MODE { NONE, POINTS, WIREFRAME, FLATLINES, FLAT, SMOOTH, TEXTURE, TEXTUREMODULATE, BOUNDARY, VECTOR };
+enum class DRAW_MODE { NONE, POINTS, WIREFRAME, FLATLINES, FLAT, SMOOTH, SHRINK, TEXTURE, TEXTUREMODULATE, BOUNDARY, VECTOR, SECTION };
 
 enum class VOLUME_TYPE {TET, HEX, FIBER};
 
+enum class CUT_TYPE { PLANE, SPHERE, CYLINDER, SLAB, POINT };
+
 class VolViewer : public QGLWidget
 {
 	Q_OBJECT 
@@ -53,6 +69,15 @@ public:
 	void loadTextMesh();
 	void loadFromMainWin(std::string, std::string);
 
+	// cut all meshes with the plane normal * p = d
+	void setCutPlane(CPoint normal, double d);
+	// look at the scene from front, back, left, right, top, bottom or iso, returns false for an unknown preset
+	bool setViewPreset(std::string preset);
+	// render the scene into an offscreen framebuffer of width x height, the widget does not need to be shown
+	QImage renderImage(int width, int height);
+	// the statistics of the frames drawn so far
+	const FrameStats & stats() const { return frameStats; };
+
 public slots:
 
 	void newScene();
@@ -84,13 +109,38 @@ public slots:
 	void plusMove();
 	void minusMove();
 
+	void sphereCut();
+	void cylinderCut();
+	void slabCut();
+	void pointCut();
+
+	void invertCutOn();
+	void invertCutOff();
+
 	void cutVolume();
 	void clearSelectedVF();
 
+	void showProfile();
+	void computeProfiles(int axis, int samples);
+
+	void showGroups();
+	void setGroupVisible(int group, bool visible);
+
+	void showShrink();
+	void setShrinkFactor(double factor);
+
+	void compareFrameTimes();	//!< time the immediate mode and the buffered drawing of the current view
+
+	void statsOn();
+	void statsOff();
+	void exportFrameStats();	//!< save the percentiles of the frame statistics as a CSV file
+
 private:
 
 	void init();
 	void initializeGL();
+	// initialize the GL state of a widget which is rendered without being shown
+	void initializeOffscreen();
 	void initTexture();
 
 	QSize sizeHint() const;
@@ -99,7 +149,8 @@ private:
 	void setScene();
 	void updateProjectionMatrix();
 	void makeWholeSceneVisible();
-	void getGLMatrix();
+	// load the matrices of the camera for the frame
+	void loadCamera();
 
 	void paintGL();
 
@@ -123,17 +174,57 @@ private:
 	void drawSelectedVertex(HMeshLib::CVHMesh * hmesh);
 	void drawBoundaryHalfFaces(TMeshLib::CVTMesh * tmesh);
 	void drawBoundaryHalfFaces(HMeshLib::CVHMesh * hmesh);
-	void drawVector();
+	void drawVector(TMeshLib::CVTMesh * mesh);
+
+	void drawSection(TMeshLib::CVTMesh * tmesh);
+	void drawSection(HMeshLib::CVHMesh * hmesh);
+	// the cap of the clipped volume, from the buffer of the section, or immediately for the timing comparison
+	void drawCrossSection(SectionBuffer * buffer);
+	void drawCrossSectionImmediate(CCrossSection & section);
+	void enableSectionClipPlane(CCrossSection & section);
 
 	void drawHalfFaces(TMeshLib::CVTMesh * mesh, std::vector<TMeshLib::CViewerHalfFace*> & HalfFaces);
 
 	void drawHalfFaces(HMeshLib::CVHMesh * mesh, std::vector<HMeshLib::CHViewerHalfFace*> & HalfFaces);
 
+	void drawHalfFacesImmediate(TMeshLib::CVTMesh * mesh, std::vector<TMeshLib::CViewerHalfFace*> & HalfFaces);
+	void drawHalfFacesImmediate(HMeshLib::CVHMesh * mesh, std::vector<HMeshLib::CHViewerHalfFace*> & HalfFaces);
+
+	// the edges of the half faces as lines, without the diagonals the quads are triangulated along,
+	// in the colors of the faces or in color if not NULL
+	void drawHalfFaceOutlines(TMeshLib::CVTMesh * mesh, std::vector<TMeshLib::CViewerHalfFace*> & HalfFaces, const GLubyte * color);
+	void drawHalfFaceOutlines(HMeshLib::CVHMesh * mesh, std::vector<HMeshLib::CHViewerHalfFace*> & HalfFaces, const GLubyte * color);
+	void drawHalfFaceOutlinesImmediate(TMeshLib::CVTMesh * mesh, std::vector<TMeshLib::CViewerHalfFace*> & HalfFaces, const GLubyte * color);
+	void drawHalfFaceOutlinesImmediate(HMeshLib::CVHMesh * mesh, std::vector<HMeshLib::CHViewerHalfFace*> & HalfFaces, const GLubyte * color);
+
+	// the overlay of the frame statistics in the top left corner
+	void drawStats();
+	// the vertex cache misses per triangle of the proxies, before and after their reordering
+	void setProxyCacheStats();
+
+	// the GPU buffer of a half face list, created on first use
+	SurfaceBuffer * surfaceBuffer(const void * halffaces);
+	// how the surface buffers apply the texture in the current draw mode
+	SurfaceBuffer::TextureMode surfaceTexture() const;
+	// the GPU buffer of the vertices of a mesh, created on first use
+	PointBuffer * pointBuffer(const void * mesh);
+	// the GPU buffer of the fibers of a mesh, created on first use
+	FiberBuffer * fiberBuffer(const void * mesh);
+	// the GPU buffer of the vector glyphs of a mesh, created on first use
+	GlyphBuffer * glyphBuffer(const void * mesh);
+	// the GPU buffer of the coarse proxy of a mesh, created on first use
+	ProxyBuffer * proxyBuffer(const void * mesh);
+	// the GPU buffer of the cross section of a mesh, created on first use
+	SectionBuffer * sectionBuffer(const void * mesh);
+	void clearBuffers();
+
 	float fovy() const { return 45.0f; }
 
 	void mousePressEvent(QMouseEvent * mouseEvent);
 	void mouseMoveEvent(QMouseEvent * mouseEvent);
 	void mouseReleaseEvent(QMouseEvent * mouseEvent);
+	// move the camera by the mouse motion and the wheel steps gathered since the last frame
+	void applyPendingInput();
 	void wheelEvent(QWheelEvent * mouseEvent);
 
 	bool arcball(QPoint screenPos, CPoint &new3Dpos);
@@ -148,6 +239,12 @@ private:
 
 	CPoint getRayVector(QPoint point, CPoint & nearPt, CPoint & farPt);
 
+	void cutMeshes();
+	// set the side of the surface and queue the cut of all meshes along it
+	void requestCut(CImplicitSurface & surface);
+	// the plane of the section of the current cut, false if the cut is not a plane
+	bool sectionPlane(CPlane & plane);
+
 private:
 
 	float zNear;
@@ -191,6 +288,8 @@ private:
 
 	QString windowTitle;
 
+	// the view and projection live on the CPU, the arrays are filled from it once per frame
+	Camera camera;
 	GLdouble matModelView[16], matProjection[16];
 	GLint viewPort[4];
 
@@ -204,6 +303,60 @@ private:
 	CPlane cutPlane;
 	double cutDistance;
 
+	// the surface the volume is cut along, the plane or a region around cutCenter
+	CUT_TYPE cutType;
+	CPoint cutCenter;
+	double cutRadius;
+	bool isCutInverted;
+
+	// computes the cuts in the background
+	CutWorker * cutWorker;
+
+	// area and volume profiles, created when first shown
+	ProfilePanel * profilePanel;
+
+	// the groups left out of the drawing of the surfaces, and the panel toggling them, created when first shown
+	std::set<int> hiddenGroups;
+	GroupPanel * groupPanel;
+
+	// the size the elements keep in the shrink mode, and the panel setting it, created when first shown
+	double shrinkFactor;
+	ShrinkPanel * shrinkPanel;
+	// the groups of the tets of all meshes, hexes are group 0
+	std::set<int> meshGroups();
+
+	// the half face lists are drawn from GPU buffers kept across frames, keyed by the address of the list
+	bool isRetainedMode;
+	std::map<const void*, SurfaceBuffer*> surfaceBuffers;
+	std::map<const void*, PointBuffer*> pointBuffers;
+	std::map<const void*, FiberBuffer*> fiberBuffers;
+	std::map<const void*, GlyphBuffer*> glyphBuffers;
+	std::map<const void*, ProxyBuffer*> proxyBuffers;
+	std::map<const void*, SectionBuffer*> sectionBuffers;
+
+	// the view is being rotated or translated, the visible surfaces are drawn from their proxies
+	bool isInteracting;
+
+	// input coalesced between two frames, repaints are scheduled with update() and merged by Qt
+	QPoint pendingMousePos;
+	bool isMousePending;
+	double pendingWheel;
+
+	// initializeGL has run on the context of the widget
+	bool isGLInitialized;
+
+	// the work of every frame and the time of the last load, cut and export, shown as an overlay
+	FrameStats frameStats;
+	bool isStatsShown;
+	// the overlay is formatted into these every frame, so showing it does not allocate
+	static const size_t maxStatsLines = 32;
+	char statsLines[maxStatsLines][FrameStats::lineLength];
+	char statsLog[4096];
+	QString statsText;
+	QFont statsFont;
+	// the proxy builds of the worker already counted in the statistics
+	int proxySwapsShown;
+
 	// fibers with length less than fiberMinLength will not be drawn
 	int fiberMinLength;
 };
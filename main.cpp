@@ -1,9 +1,18 @@
 #include "MainWindow.h"
+#include "BatchRenderer.h"
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
     QApplication VolumeViewer(argc, argv);
+
+	// render the images of a job file, or check the steady state frames, without showing any window
+	if (VolumeViewer.arguments().contains("--batch") || VolumeViewer.arguments().contains("--check-allocations"))
+	{
+		BatchRenderer batch;
+		return batch.run(VolumeViewer.arguments());
+	}
+
     MainWindow mainWin;
 	mainWin.setGeometry(100, 100, mainWin.sizeHint().width(), mainWin.sizeHint().height());
 	mainWin.resize(mainWin.sizeHint());